@@ -0,0 +1,52 @@
+/*
+ * app.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_APP_H_
+#define INC_APP_H_
+
+#include "frame.h"
+#include "ring_buffer.h"
+
+
+/* User Configuration */
+#define SAMPLE_RING_SIZE				1024	// 36 samples (TIM2 count, full scale and raw burst), power of 2
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t samples;				// sent, as text or binary
+	uint32_t spi_dropped;			// data ready with the SPI transaction queue full, never read
+	bool streaming;					// data ready interrupt on, COMMAND_START / COMMAND_STOP
+	bool flash;						// MT25QL512 answered at init, flash_log.c is on it
+} app_stats;
+
+
+/* Variables */
+// format sent to the USB VCP, output_text keeps the original '&' separated line
+extern output_format tx_format;
+// raw bursts waiting for the main loop, sample_ring.dropped counts the lost ones
+extern ring_buffer sample_ring;
+
+
+/* Functions */
+// after the peripherals are initialized
+void app_init(void);
+// ICM INT1 data ready, called from the EXTI interrupt
+void app_data_ready(void);
+// one main loop pass: wait for a sample, time stamp it, format it and queue it for the USB VCP,
+// false if the pass ran the commands or the stream is stopped, without a sample
+bool app_process(void);
+// bytes received on the USB VCP, called from the USB interrupt
+void app_usb_receive(const uint8_t* buf, uint32_t len);
+// main loop: start or stop the data ready interrupt
+void app_set_streaming(bool on);
+// main loop: the prof.c results, as text lines or FRAME_TYPE_TEXT frames
+void app_send_profile(void);
+void app_get_stats(app_stats* stats);
+
+#endif /* INC_APP_H_ */
@@ -0,0 +1,134 @@
+/*
+ * command.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_COMMAND_H_
+#define INC_COMMAND_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Commands from the PC, FRAME_TYPE_COMMAND frames on the USB VCP OUT endpoint (frame.h),
+ * payload: uint8 command id, then the arguments, all little endian.
+ * Every command except COMMAND_SYNC_REPLY is answered with a FRAME_TYPE_RESPONSE frame carrying
+ * the sequence number of the command, payload: uint8 command id, uint8 COMMAND_STATUS_*, then the result.
+ *
+ *   id    command                 arguments                               result
+ *   0x01  COMMAND_START           -                                       -
+ *   0x02  COMMAND_STOP            -                                       -
+ *   0x03  COMMAND_SET_ODR         uint32 sample rate, mHz                 uint32 sample rate set, mHz, the nearest one
+ *   0x04  COMMAND_SET_SCALE       uint8 accel_full_scale,                 -
+ *                                 uint8 gyro_full_scale, 0xFF: unchanged
+ *   0x05  COMMAND_SET_FORMAT      uint8 output_format                     -
+ *   0x06  COMMAND_GET_STATS       -                                       command_stats_payload below
+ *   0x07  COMMAND_SYNC_TIME       uint64 PC time, us since 1970, 0: none  -
+ *   0x08  COMMAND_SYNC_REPLY      uint16 seq, uint64 t2, uint64 t3        none, see timesync.h
+ *   0x09  COMMAND_SET_TIME_ZONE   ASCII rule or preset name, see tz.h     -
+ *   0x0A  COMMAND_PROFILE         -                                       -, the prof.c results follow as text
+ *   0x0B  COMMAND_PROFILE_RESET   -                                       -
+ *   0x0C  COMMAND_SET_BANDWIDTH   uint32 gyro, uint32 accel LPF           uint32 gyro, uint32 accel bandwidth set, mHz
+ *                                 bandwidth, mHz, 0xFFFFFFFF: unchanged
+ *   0x0D  COMMAND_GET_CONFIG      -                                       gyro then accel: uint32 sample rate (mHz),
+ *                                                                         uint8 full scale, uint32 LPF bandwidth (mHz)
+ *   0x0E  COMMAND_SET_LOGGING     uint8 0: stop, 1: start the flash log   -
+ *   0x0F  COMMAND_GET_LOG_STATS   -                                       command_log_stats_payload below
+ *   0x10  COMMAND_FIND_LOG        uint32 from, uint32 to, seconds since   uint32 first block, uint32 its sequence number,
+ *                                 1970 UTC, both included                 uint32 blocks, uint32 first second of the first
+ *                                                                         block, uint32 last second of the last block
+ *   0x11  COMMAND_DUMP            uint32 flash address, uint32 length,    uint32 address, uint32 length of the dump,
+ *                                 0: only stop the dump running           clamped to the end of the flash
+ *
+ * The gyroscope and the accelerometer are given the same sample rate, the data ready interrupt follows it.
+ * The LPF set is the narrowest one with at least the bandwidth asked for, see icm20948_gyro_configure().
+ *
+ * COMMAND_GET_STATS result, COMMAND_STATS_LEN bytes:
+ *   uint8 streaming, uint8 output_format, uint32 samples sent, uint32 samples dropped (sample_ring full or SPI queue full),
+ *   uint32 frames queued, uint32 frames dropped (usb_stream), uint32 SPI errors,
+ *   uint32 RTC seconds, uint32 rejected RTC seconds (timebase),
+ *   uint32 sync rounds, int32 offset (us), uint32 round trip (us), int32 calibration (ppb), uint32 last sync (unix time),
+ *   uint32 commands, uint32 rejected command frames
+ *
+ * COMMAND_GET_LOG_STATS result, COMMAND_LOG_STATS_LEN bytes, flash_log_stats of flash_log.h:
+ *   uint8 running, uint32 records, uint32 dropped records, uint32 pages, uint32 blocks opened, uint32 subsector erases,
+ *   uint32 errors, uint32 used blocks, uint32 head block, uint16 staging high water (pages),
+ *   uint32 committed (number of the first record not on the flash yet), uint32 checkpoints,
+ *   uint16 torn pages found by the last mount, uint16 flash reads of the last mount
+ *   COMMAND_STATUS_FAILED without a flash.
+ *
+ * COMMAND_FIND_LOG gives the blocks of the flash log holding records stamped in the range, consecutive in the ring
+ * (the block after FLASH_LOG_BLOCKS - 1 is 0), found in the time index of flash_log.c. The block at
+ * FLASH_LOG_BASE + block * FLASH_LOG_BLOCK_SIZE is still the one found while its header has the sequence number.
+ *   COMMAND_STATUS_FAILED without a flash.
+ *
+ * COMMAND_DUMP sends the flash as it is in FRAME_TYPE_DUMP frames after the response, see flash_dump.h, replacing
+ * the dump running. The blocks of the flash log are at FLASH_LOG_BASE + block * FLASH_LOG_BLOCK_SIZE.
+ *   COMMAND_STATUS_BAD_ARGS for an address past the end of the flash, COMMAND_STATUS_FAILED without a flash
+ *   or in text output.
+ *
+ * The frames are only queued by the USB interrupt, with the TIM2 count at reception for COMMAND_SYNC_REPLY,
+ * they are decoded and run by the main loop.
+ */
+
+/* User Configuration */
+#define COMMAND_QUEUE_SIZE				512		// bytes of received frames, power of 2
+#define COMMAND_MAX_ARGS				64		// longest argument list
+#define COMMAND_MAX_RESULT				64		// longest result
+
+
+/* Defines */
+#define COMMAND_START					0x01
+#define COMMAND_STOP					0x02
+#define COMMAND_SET_ODR					0x03
+#define COMMAND_SET_SCALE				0x04
+#define COMMAND_SET_FORMAT				0x05
+#define COMMAND_GET_STATS				0x06
+#define COMMAND_SYNC_TIME				0x07
+#define COMMAND_SYNC_REPLY				0x08
+#define COMMAND_SET_TIME_ZONE			0x09
+#define COMMAND_PROFILE					0x0A
+#define COMMAND_PROFILE_RESET			0x0B
+#define COMMAND_SET_BANDWIDTH			0x0C
+#define COMMAND_GET_CONFIG				0x0D
+#define COMMAND_SET_LOGGING				0x0E
+#define COMMAND_GET_LOG_STATS			0x0F
+#define COMMAND_FIND_LOG				0x10
+#define COMMAND_DUMP					0x11
+
+#define COMMAND_STATUS_OK				0x00
+#define COMMAND_STATUS_UNKNOWN			0x01	// no such command
+#define COMMAND_STATUS_BAD_ARGS			0x02	// wrong argument length or value
+#define COMMAND_STATUS_FAILED			0x03	// valid, but it could not be done
+
+#define COMMAND_STATS_LEN				58
+#define COMMAND_CONFIG_LEN				18
+#define COMMAND_LOG_STATS_LEN			47
+#define COMMAND_LOG_RANGE_LEN			20
+#define COMMAND_DUMP_LEN				8
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t frames;				// complete frames queued by the USB interrupt
+	uint32_t dropped;				// not queued, too long or the queue was full
+	uint32_t rejected;				// malformed, bad CRC or not a command
+	uint32_t commands;				// run
+} command_stats;
+
+
+/* Functions */
+void command_init(void);
+// USB interrupt: bytes received on the OUT endpoint, ticks is the TIM2 count at reception
+void command_receive(const uint8_t* buf, uint32_t len, uint32_t ticks);
+// any context: frames are waiting
+bool command_pending(void);
+// main loop: run the queued commands and send the responses
+void command_process(void);
+void command_get_stats(command_stats* stats);
+
+#endif /* INC_COMMAND_H_ */
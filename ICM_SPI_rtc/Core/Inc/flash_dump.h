@@ -0,0 +1,65 @@
+/*
+ * flash_dump.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_FLASH_DUMP_H_
+#define INC_FLASH_DUMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "mt25ql512.h"
+
+
+/*
+ * Bulk read back of the MT25QL512 over the USB VCP, started with COMMAND_DUMP (command.h).
+ *
+ * The bytes are sent as they are in the flash, FRAME_TYPE_DUMP frames of FLASH_DUMP_CHUNK bytes (frame.h)
+ * carrying their flash address. After the last frame of every FLASH_DUMP_BLOCK_SIZE block, and after the
+ * last frame of the dump, a FRAME_TYPE_DUMP_CRC frame gives the CRC of the block and the bytes left.
+ * A block starts at a multiple of FLASH_DUMP_BLOCK_SIZE, the first one at the start address of the dump.
+ *
+ * Resuming: the PC keeps the blocks whose CRC matched. When the dump is cut, the cable pulled or the
+ * PC application stopped, it sends COMMAND_DUMP again from the end of the last good block.
+ * The device keeps nothing between two dumps, a dump stops once the USB is not configured.
+ *
+ * The dump runs alongside the samples and the flash log: the samples share the IN endpoint,
+ * and the dump waits while the flash programs or erases.
+ */
+
+/* User Configuration */
+#define FLASH_DUMP_CHUNK				1024	// bytes of flash per FRAME_TYPE_DUMP frame
+
+
+/* Defines */
+#define FLASH_DUMP_BLOCK_SIZE			MT25QL512_SECTOR_SIZE	// bytes per FRAME_TYPE_DUMP_CRC frame
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t dumps;					// started
+	uint32_t aborted;				// stopped by the USB
+	uint32_t frames;				// FRAME_TYPE_DUMP frames queued
+	uint32_t blocks;				// FRAME_TYPE_DUMP_CRC frames queued
+	uint32_t flash_waits;			// passes with a buffer free but the flash busy
+	uint32_t address;				// next byte to read
+	uint32_t left;					// bytes not read yet, 0: no dump running
+} flash_dump_stats;
+
+
+/* Functions */
+void flash_dump_init(void);
+// dump length bytes from address on, clamped to the end of the flash, a running dump is replaced
+// false if address is past the end of the flash
+bool flash_dump_start(uint32_t address, uint32_t length);
+void flash_dump_stop(void);
+// any context: a dump is running and can queue its next frame now
+bool flash_dump_pending(void);
+// main loop: fill the free USB bulk buffer
+void flash_dump_process(void);
+void flash_dump_get_stats(flash_dump_stats* stats);
+
+#endif /* INC_FLASH_DUMP_H_ */
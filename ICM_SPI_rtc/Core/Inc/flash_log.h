@@ -0,0 +1,192 @@
+/*
+ * flash_log.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_FLASH_LOG_H_
+#define INC_FLASH_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "icm20948.h"
+#include "mt25ql512.h"
+
+
+/*
+ * Sample log on the MT25QL512, append only, all fields little endian.
+ *
+ * The log is a ring of FLASH_LOG_BLOCKS blocks of 64 KB, written in order of their sequence number.
+ * A block is erased just before it is reused, so every block is erased once per turn of the ring
+ * and the oldest block is the one given up when the ring is full.
+ *
+ * Device:
+ *   sector 0    checkpoint region, 16 subsectors of FLASH_LOG_CHECKPOINT_SLOTS slots
+ *   sector 1..  the blocks of the ring
+ *
+ * A flash_log_checkpoint is programmed into the next free slot every time a block is opened. The subsectors are
+ * filled in turn, one is erased just before its first slot is used, so the newest checkpoint is never erased.
+ * At mount the newest checkpoint is found with a binary search, the headers of the blocks opened and erased
+ * since are then followed for FLASH_LOG_RECOVERY_BLOCKS blocks at most: the time to mount does not depend on
+ * how full the log is. All the block headers are scanned only without a checkpoint.
+ *
+ * Time index: the first and last second of every block in the ring are kept in RAM (SRAM2), in block order, so
+ * the blocks holding a time range are found with two binary searches (flash_log_find()). The span of a block is
+ * final when the next one is opened, it goes to the flash with the checkpoint of that one; the region holds the
+ * last 1920 checkpoints at least, more than the ring has blocks, so the mount finds every span there. A block
+ * whose checkpoint was lost to a power cut has its span read back from its pages.
+ * The search takes the time to only go forward: a block stamped before the one preceding it (the RTC set back)
+ * may be missed.
+ *
+ * Block, 256 pages of 256 bytes:
+ *   page 0      flash_log_block_header, programmed when the block is opened
+ *   page 1..255 data pages, programmed once each, in order
+ *
+ * Data page:
+ *   offset  size  field
+ *   0       8     timestamp of the first record, microseconds since 1970-01-01 UTC
+ *   8       4     number of the first record, counts every record since the log was created
+ *   12      1     records in the page, FLASH_LOG_RECORDS_PER_PAGE at most
+ *   13      1     0
+ *   14      2     CRC-16/CCITT-FALSE of bytes 0..13 and of the records
+ *   16      24*n  flash_log_record
+ *
+ * A page is not always full: one waiting for more than FLASH_LOG_FLUSH_MS is programmed as it is.
+ * The die temperature is not logged.
+ *
+ * A record is committed once its page is programmed. A page torn by a power loss fails its CRC, it is skipped
+ * and its records were never committed; the log goes on at the page after it.
+ */
+
+/* User Configuration */
+#define FLASH_LOG_CHECKPOINT_BASE		0		// byte address of the checkpoint region, one sector
+#define FLASH_LOG_BASE					0x10000	// byte address of the first block
+#define FLASH_LOG_BLOCKS				1023	// the rest of the device
+#define FLASH_LOG_RECOVERY_BLOCKS		4		// blocks followed past the checkpoint before all headers are scanned
+#define FLASH_LOG_STAGING_PAGES			24		// full pages waiting in RAM for the flash, 240 ms at 1 kHz: a 64 KB erase
+#define FLASH_LOG_FLUSH_MS				1000	// a partly filled page waits this long at most
+
+
+/* Defines */
+#define FLASH_LOG_BLOCK_SIZE			MT25QL512_SECTOR_SIZE
+#define FLASH_LOG_PAGE_SIZE				MT25QL512_PAGE_SIZE
+#define FLASH_LOG_PAGES					(FLASH_LOG_BLOCK_SIZE / FLASH_LOG_PAGE_SIZE)
+#define FLASH_LOG_PAGE_HEADER_LEN		16
+#define FLASH_LOG_RECORD_LEN			24
+#define FLASH_LOG_RECORDS_PER_PAGE		((FLASH_LOG_PAGE_SIZE - FLASH_LOG_PAGE_HEADER_LEN) / FLASH_LOG_RECORD_LEN)
+
+#define FLASH_LOG_CHECKPOINT_SUBSECTORS	(MT25QL512_SECTOR_SIZE / MT25QL512_SUBSECTOR_SIZE)
+#define FLASH_LOG_CHECKPOINT_SLOT_SIZE	32
+#define FLASH_LOG_CHECKPOINT_SLOTS		(MT25QL512_SUBSECTOR_SIZE / FLASH_LOG_CHECKPOINT_SLOT_SIZE)
+
+#define FLASH_LOG_MAGIC					0x474F4C49u		// "ILOG"
+#define FLASH_LOG_CHECKPOINT_MAGIC		0x504B4349u		// "ICKP"
+#define FLASH_LOG_VERSION				3
+
+#define FLASH_LOG_NO_TIME				0xFFFFFFFFu		// flash_log_span of a block without a good page
+
+
+/* Typedefs */
+// naturally aligned, no padding: the layout in flash is the layout in memory
+typedef struct
+{
+	uint32_t magic;					// FLASH_LOG_MAGIC
+	uint32_t seq;					// block sequence number, +1 for every block opened
+	uint32_t erase_count;			// erases of this block, for the wear statistics
+	uint32_t first_record;			// number of the first record written into the block
+	uint8_t version;				// FLASH_LOG_VERSION
+	uint8_t reserved;
+	uint16_t crc;					// CRC-16/CCITT-FALSE of the bytes above
+} flash_log_block_header;
+
+typedef struct
+{
+	uint32_t magic;					// FLASH_LOG_CHECKPOINT_MAGIC
+	uint32_t seq;					// checkpoint number, +1 for every checkpoint
+	uint32_t head_seq;				// sequence number of the block opened last
+	uint32_t tail_seq;				// and of the oldest block
+	uint32_t first_s;				// span of the block before the head, flash_log_span
+	uint32_t last_s;
+	uint16_t head_block;
+	uint16_t tail_block;
+	uint8_t version;				// FLASH_LOG_VERSION
+	uint8_t reserved;
+	uint16_t crc;					// CRC-16/CCITT-FALSE of the bytes above
+} flash_log_checkpoint;
+
+typedef struct
+{
+	uint64_t timestamp_us;
+	uint32_t first_record;
+	uint8_t count;
+	uint8_t reserved;
+	uint16_t crc;
+} flash_log_page_header;
+
+typedef struct
+{
+	uint32_t offset_us;				// from the page timestamp
+	int16_t accel[3];				// LSB, as icm20948_raw_sample
+	int16_t gyro[3];
+	int16_t mag[3];
+	uint8_t scale;					// accel_fs << 4 | gyro_fs, as FRAME_FIELD_SCALE
+	uint8_t flags;					// ICM20948_SAMPLE_*
+} flash_log_record;
+
+// seconds since 1970-01-01 UTC of the first and of the last record of a block
+typedef struct
+{
+	uint32_t first_s;
+	uint32_t last_s;
+} flash_log_span;
+
+// blocks holding records of a time range, consecutive in the ring
+typedef struct
+{
+	uint32_t first_block;
+	uint32_t first_seq;				// sequence number of first_block
+	uint32_t blocks;				// 0: none
+	uint32_t first_s;				// first second of the first block
+	uint32_t last_s;				// last second of the last block
+} flash_log_range;
+
+typedef struct
+{
+	uint32_t records;				// appended
+	uint32_t dropped_records;		// lost, the staging buffer was full
+	uint32_t pages;					// programmed
+	uint32_t blocks;				// opened
+	uint32_t erases;				// 4 KB subsector and 64 KB block erases
+	uint32_t errors;				// failed programs and erases, retried
+	uint32_t used_blocks;			// blocks holding data, the open one included
+	uint32_t head_block;			// block being written
+	uint32_t committed;				// number of the first record not programmed yet, the ones before are safe
+	uint32_t checkpoints;			// programmed
+	uint16_t torn_pages;			// pages at the end of the log failing their CRC at mount
+	uint16_t mount_reads;			// headers, slots and pages read by the last mount
+	uint16_t spans_rebuilt;			// time spans the last mount read from the pages, no checkpoint had them
+	uint16_t staged;				// pages waiting now
+	uint16_t staging_high_water;	// most pages ever waiting
+	bool running;
+} flash_log_stats;
+
+
+/* Functions */
+// find the end of the log from the last checkpoint, false if there is no flash
+bool flash_log_init(void);
+// start or stop appending, stopping programs the partly filled page
+void flash_log_enable(bool on);
+// main loop: one sample, false if it was not logged
+bool flash_log_append(uint64_t timestamp_us, const icm20948_raw_sample* sample);
+// main loop: program the pages staged so far, open and erase blocks, never waits for the flash
+void flash_log_process(void);
+// the partly filled page is staged now
+void flash_log_flush(void);
+// nothing staged and the flash idle
+bool flash_log_idle(void);
+// blocks with records from from_s to to_s inclusive, seconds since 1970, false if there is no flash
+bool flash_log_find(uint32_t from_s, uint32_t to_s, flash_log_range* range);
+void flash_log_get_stats(flash_log_stats* stats);
+
+#endif /* INC_FLASH_LOG_H_ */
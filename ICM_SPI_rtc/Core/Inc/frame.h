@@ -0,0 +1,117 @@
+/*
+ * frame.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_FRAME_H_
+#define INC_FRAME_H_
+
+#include <stdint.h>
+#include "icm20948.h"
+#include "time.h"
+
+
+/* Output formats sent over the USB VCP */
+typedef enum
+{
+	output_text = 0,			// one '&' separated ASCII line per sample
+	output_binary = 1			// one COBS framed binary record per sample
+} output_format;
+
+
+/*
+ * Binary frame, version 1, all fields little endian:
+ *
+ *   offset  size  field
+ *   0       1     version, FRAME_VERSION
+ *   1       1     type, FRAME_TYPE_*
+ *   2       2     sequence number, wraps at 65535
+ *   4       2     field mask, FRAME_FIELD_*
+ *   6       8     timestamp, microseconds since 1970-01-01 UTC
+ *   14      ..    payload, FRAME_TYPE_SAMPLE: the fields of the mask in bit order
+ *                           FRAME_TYPE_TEXT: ASCII text, sequence number and field mask are 0
+ *                           FRAME_TYPE_LOG: log.c records, sequence number and field mask are 0
+ *                           FRAME_TYPE_SYNC: timesync.c request, the sequence number is the exchange number,
+ *                           the timestamp is t1, the payload the result of the last round:
+ *                           int32 offset (us), uint32 round trip (us), int32 RTC calibration (ppb)
+ *                           FRAME_TYPE_COMMAND: PC to device, the sequence number is chosen by the PC,
+ *                           the field mask and the timestamp are 0, the payload is described in command.h
+ *                           FRAME_TYPE_RESPONSE: answer to a command, with its sequence number, see command.h
+ *                           FRAME_TYPE_DUMP: flash_dump.c, the sequence number counts the frames of the dump, the
+ *                           field mask and the timestamp are 0, the payload: uint32 flash address, the bytes read there
+ *                           FRAME_TYPE_DUMP_CRC: end of a block of the dump, sequence number, field mask and timestamp
+ *                           are 0, the payload: uint32 address of the block, uint32 its length,
+ *                           uint16 CRC-16/CCITT-FALSE of its bytes, uint32 bytes of the dump left after it
+ *   ..      2     CRC-16/CCITT-FALSE of all the bytes above
+ *
+ * The frame is COBS encoded and terminated by a 0x00 byte, so a 0x00 always marks a frame boundary.
+ */
+#define FRAME_VERSION					1
+
+#define FRAME_TYPE_SAMPLE				0x01
+#define FRAME_TYPE_TEXT					0x02	// diagnostics, e.g. the profiling results
+#define FRAME_TYPE_LOG					0x03	// binary log records, see log.h
+#define FRAME_TYPE_SYNC					0x04	// time sync request, see timesync.h
+#define FRAME_TYPE_COMMAND				0x05	// received on the OUT endpoint, see command.h
+#define FRAME_TYPE_RESPONSE				0x06
+#define FRAME_TYPE_DUMP					0x07	// raw flash data, see flash_dump.h
+#define FRAME_TYPE_DUMP_CRC				0x08
+
+#define FRAME_FIELD_ACCEL				0x0001	// 3 x int16, LSB
+#define FRAME_FIELD_GYRO				0x0002	// 3 x int16, LSB
+#define FRAME_FIELD_MAG					0x0004	// 3 x int16, LSB, only when the ak09916 has a new measurement
+#define FRAME_FIELD_TEMP				0x0008	// int16, LSB
+#define FRAME_FIELD_SCALE				0x0010	// uint8, accel_fs << 4 | gyro_fs
+
+#define FRAME_HEADER_LEN				14
+#define FRAME_CRC_LEN					2
+#define FRAME_MAX_PAYLOAD				(3 * 6 + 2 + 1)
+#define FRAME_MAX_TEXT					200		// FRAME_TYPE_TEXT and FRAME_TYPE_LOG payload
+#define FRAME_MAX_LEN					(FRAME_HEADER_LEN + FRAME_MAX_PAYLOAD + FRAME_CRC_LEN)
+// COBS adds one byte per 254 bytes plus one, and the 0x00 delimiter
+#define FRAME_MAX_ENCODED_LEN			(FRAME_MAX_LEN + FRAME_MAX_LEN / 254 + 2)
+
+#define FRAME_MAX_TEXT_ENCODED_LEN		(FRAME_HEADER_LEN + FRAME_MAX_TEXT + FRAME_CRC_LEN + 3)
+
+#define FRAME_SYNC_PAYLOAD				12
+#define FRAME_SYNC_ENCODED_LEN			(FRAME_HEADER_LEN + FRAME_SYNC_PAYLOAD + FRAME_CRC_LEN + 2)
+
+#define FRAME_DUMP_HEADER_LEN			4		// address in front of the data
+#define FRAME_DUMP_CRC_PAYLOAD			14
+// FRAME_TYPE_DUMP frame with n bytes of data
+#define FRAME_DUMP_ENCODED_LEN(n)		(FRAME_HEADER_LEN + FRAME_DUMP_HEADER_LEN + (n) + FRAME_CRC_LEN + \
+		(FRAME_HEADER_LEN + FRAME_DUMP_HEADER_LEN + (n) + FRAME_CRC_LEN) / 254 + 2)
+#define FRAME_DUMP_CRC_ENCODED_LEN		(FRAME_HEADER_LEN + FRAME_DUMP_CRC_PAYLOAD + FRAME_CRC_LEN + 2)
+
+#define FRAME_TEXT_MAX_LEN				512
+
+
+/* Functions */
+// One encoded sample, returns the number of bytes written to out (FRAME_MAX_ENCODED_LEN at most)
+uint16_t frame_encode_sample(uint8_t* out, uint16_t seq, uint64_t timestamp_us, const icm20948_raw_sample* sample);
+// One encoded FRAME_TYPE_TEXT or FRAME_TYPE_LOG frame, at most FRAME_MAX_TEXT bytes of the payload,
+// returns the number of bytes written to out
+uint16_t frame_encode_message(uint8_t* out, uint8_t type, uint64_t timestamp_us, const void* payload, uint16_t len);
+// One encoded FRAME_TYPE_SYNC request, returns the number of bytes written to out (FRAME_SYNC_ENCODED_LEN)
+uint16_t frame_encode_sync(uint8_t* out, uint16_t seq, uint64_t t1_us, int32_t offset_us, uint32_t delay_us, int32_t calib_ppb);
+// One encoded FRAME_TYPE_RESPONSE frame, at most FRAME_MAX_TEXT - 2 bytes of result,
+// returns the number of bytes written to out (FRAME_MAX_TEXT_ENCODED_LEN at most)
+uint16_t frame_encode_response(uint8_t* out, uint16_t seq, uint64_t timestamp_us, uint8_t command, uint8_t status,
+		const uint8_t* result, uint16_t len);
+// One encoded FRAME_TYPE_DUMP frame, data is read once, straight into out,
+// returns the number of bytes written to out (FRAME_DUMP_ENCODED_LEN(len) at most)
+uint16_t frame_encode_dump(uint8_t* out, uint16_t seq, uint32_t address, const uint8_t* data, uint16_t len);
+// COBS decode one received frame without its 0x00 delimiter and check it,
+// returns the length without the CRC, 0 if it is malformed, of an other version or the CRC does not match
+uint16_t frame_decode(const uint8_t* in, uint16_t len, uint8_t* out);
+// The original text line, returns the string length
+uint16_t frame_encode_text(char* out, uint16_t size, const time_data* time_info, const icm20948_raw_sample* sample);
+
+uint16_t crc16_ccitt(const uint8_t* data, uint16_t len, uint16_t crc);
+// COBS without the 0x00 delimiter, decode returns 0 on a malformed input
+uint16_t cobs_encode(const uint8_t* in, uint16_t len, uint8_t* out);
+uint16_t cobs_decode(const uint8_t* in, uint16_t len, uint8_t* out);
+
+#endif /* INC_FRAME_H_ */
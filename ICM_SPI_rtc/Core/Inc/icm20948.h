@@ -18,11 +18,31 @@
 #define ICM20948_SPI_CS_PIN_PORT		GPIOA
 #define ICM20948_SPI_CS_PIN_NUMBER		GPIO_PIN_4
 
+#define AK09916_SLV4_TIMEOUT			20		// ms, I2C_SLV4 single transfer
+
+// SPI1 DMA transport
+#define ICM20948_XFER_QUEUE_LEN			8		// pending transactions, one slot is kept free
+#define ICM20948_DMA_BUF_LEN			512		// longest register access, one FIFO drain
+#define ICM20948_SPI_TIMEOUT			1000	// ms, blocking accesses
+
+// Sensor configuration at init, see icm20948_sensor_config
+#define ICM20948_GYRO_ODR_MHZ			102273	// 1.125 kHz / 11
+#define ICM20948_GYRO_FULL_SCALE		_2000dps
+#define ICM20948_GYRO_BANDWIDTH_MHZ		196600	// DLPF 196.6 Hz
+#define ICM20948_ACCEL_ODR_MHZ			102273
+#define ICM20948_ACCEL_FULL_SCALE		_16g
+#define ICM20948_ACCEL_BANDWIDTH_MHZ	246000	// DLPF 246.0 Hz
+
 
 /* Defines */
 #define READ							0x80
 #define WRITE							0x00
 
+// Output Data Rate = 1.125kHz / (1 + divider), with the digital LPF enabled
+#define ICM20948_ODR_BASE_MHZ			1125000
+#define ICM20948_GYRO_MAX_DIVIDER		0xFF	// GYRO_SMPLRT_DIV, 8 bits
+#define ICM20948_ACCEL_MAX_DIVIDER		0x0FFF	// ACCEL_SMPLRT_DIV_1 ~ 2, 12 bits
+
 
 /* Typedefs */
 typedef enum
@@ -56,6 +76,13 @@ typedef struct
 	float z;
 } axises;
 
+typedef struct
+{
+	int16_t x;
+	int16_t y;
+	int16_t z;
+} raw_axises;
+
 typedef enum
 {
 	power_down_mode = 0,
@@ -76,8 +103,43 @@ typedef struct{
 	float x_magnet;
 	float y_magnet;
 	float z_magnet;
+	float temperature;
 }icm_20948_data;
 
+// One sample as read from the sensor, converted to units only where a consumer needs it
+#define ICM20948_SAMPLE_MAG_NEW			0x01	// mag holds a new ak09916 measurement
+
+typedef struct
+{
+	raw_axises accel;				// LSB, 1 g = accel_lsb_per_g[accel_fs]
+	raw_axises gyro;				// LSB, 1 dps = gyro_lsb_per_dps[gyro_fs]
+	raw_axises mag;					// LSB, AK09916_UT_PER_LSB
+	int16_t temperature;			// LSB, ICM20948_TEMP_LSB_PER_DEGC from 21 degC
+	uint8_t gyro_fs;				// gyro_full_scale
+	uint8_t accel_fs;				// accel_full_scale
+	uint8_t flags;					// ICM20948_SAMPLE_*
+} icm20948_raw_sample;
+
+// Output data rate, full-scale range and digital LPF bandwidth of the gyroscope or the accelerometer
+typedef struct
+{
+	uint32_t odr_mhz;					// output data rate, mHz
+	uint8_t full_scale;					// gyro_full_scale or accel_full_scale
+	uint32_t bandwidth_mhz;				// digital LPF 3 dB bandwidth, mHz
+} icm20948_sensor_config;
+
+// SPI transaction counters, one transaction is one CS-low window
+typedef struct
+{
+	uint32_t transactions;
+	uint32_t bank_selects;				// REG_BANK_SEL writes
+	uint32_t bank_selects_skipped;		// REG_BANK_SEL writes saved by the bank cache
+	uint32_t errors;					// failed or timed out transactions
+} icm20948_spi_stats;
+
+// SPI1 DMA transaction done, called from the DMA interrupt. len is 0 if the transfer failed.
+typedef void (*icm20948_xfer_cb)(uint8_t* buf, uint16_t len, void* ctx);
+
 /* Main Functions */
 
 // sensor init function.
@@ -99,6 +161,47 @@ bool ak09916_mag_read_uT(axises* data);
 
 //uint8_t read_all_data(icm_20948_data* data);
 icm_20948_data read_all_data(void);
+void icm20948_read_raw_sample(icm20948_raw_sample* sample);
+
+// Raw data ready pulse on INT1, one per sample
+void icm20948_data_ready_enable();
+void icm20948_data_ready_disable();
+
+// FIFO streaming: accelerometer, gyroscope, temperature and I2C_SLV0 records
+void icm20948_fifo_enable();
+void icm20948_fifo_disable();
+void icm20948_fifo_reset();
+uint16_t icm20948_fifo_count();
+uint16_t icm20948_fifo_read(icm20948_raw_sample* samples, uint16_t max_samples, bool* overflow);
+
+// Sensor configuration: the nearest output data rate, the given full scale and the narrowest digital LPF
+// with at least the bandwidth asked for, the widest otherwise. The configuration set is copied to actual
+// if it is not NULL. false if the rate is 0 or the full scale out of range, nothing is changed then.
+bool icm20948_gyro_configure(const icm20948_sensor_config* target, icm20948_sensor_config* actual);
+bool icm20948_accel_configure(const icm20948_sensor_config* target, icm20948_sensor_config* actual);
+void icm20948_get_config(icm20948_sensor_config* gyro, icm20948_sensor_config* accel);
+// accel_fs << 4 | gyro_fs of the bursts read from now on, interrupt safe: a range change takes effect
+// in the SPI completion of its register write, so a burst completing later was read with the new range
+uint8_t icm20948_full_scale(void);
+
+// Non-blocking register access on SPI1 DMA, queued behind the blocking accesses.
+// The CPU can format and send the previous sample while the next one is read.
+bool icm20948_read_async(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx);
+bool icm20948_write_async(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx);
+bool icm20948_read_all_data_async(uint8_t* raw, icm20948_xfer_cb cb, void* ctx);
+bool icm20948_spi_busy();
+
+// The current user bank is cached, REG_BANK_SEL is only written when the bank changes
+void icm20948_bank_cache_invalidate();
+void icm20948_get_spi_stats(icm20948_spi_stats* stats);
+void icm20948_reset_spi_stats();
+
+// Unpack one ICM20948_BURST_LEN block (burst read or FIFO record) measured with the icm20948_full_scale()
+// selection full_scale, integer only
+void icm20948_parse_raw_sample(const uint8_t* raw, uint8_t full_scale, icm20948_raw_sample* result);
+// Convert into standard units
+void icm20948_raw_to_data(const icm20948_raw_sample* raw, icm_20948_data* result);
+void icm20948_parse_sample(const uint8_t* raw, icm_20948_data* result);
 
 /* Sub Functions */
 bool icm20948_who_am_i();
@@ -126,9 +229,13 @@ void icm20948_accel_low_pass_filter(uint8_t config); // 0 - 7
 
 // Output Data Rate = 1.125kHz / (1 + divider)
 void icm20948_gyro_sample_rate_divider(uint8_t divider);
-void icm20948_accel_sample_rate_divider(uint16_t divider);
+void icm20948_accel_sample_rate_divider(uint16_t divider); // 0 - 4095
 void ak09916_operation_mode_setting(operation_mode mode);
 
+// I2C_SLV0 keeps mirroring ak09916 ST1 ~ ST2 into EXT_SLV_SENS_DATA_00 ~ 08
+void ak09916_auto_poll_enable();
+void ak09916_auto_poll_disable();
+
 // Calibration before select full scale.
 void icm20948_gyro_calibration();
 void icm20948_accel_calibration();
@@ -141,6 +248,7 @@ void icm20948_accel_full_scale_select(accel_full_scale full_scale);
 /* ICM-20948 Registers */
 #define ICM20948_ID						0xEA
 #define REG_BANK_SEL					0x7F
+#define REG_BANK_UNKNOWN				0xFF	// not a userbank value, forces a REG_BANK_SEL write
 
 // USER BANK 0
 #define B0_WHO_AM_I						0x00
@@ -289,6 +397,18 @@ void icm20948_accel_full_scale_select(accel_full_scale full_scale);
 #define MAG_TS1							0x33
 #define MAG_TS2							0x34
 
+// Burst read: ACCEL_XOUT_H ~ TEMP_OUT_L followed by ST1 ~ ST2 mirrored by I2C_SLV0
+#define AK09916_MIRROR_LEN				(MAG_ST2 - MAG_ST1 + 1)
+#define ICM20948_BURST_LEN				(B0_EXT_SLV_SENS_DATA_08 - B0_ACCEL_XOUT_H + 1)
+
+// Unit conversion of raw samples
+#define AK09916_UT_PER_LSB				0.15f
+#define ICM20948_TEMP_LSB_PER_DEGC		333.87f
+
+// FIFO: one record has the same layout as the burst read
+#define ICM20948_FIFO_SIZE				512
+#define ICM20948_FIFO_MAX_RECORDS		(ICM20948_FIFO_SIZE / ICM20948_BURST_LEN)
+
 
 
 #endif /* INC_ICM20948_H_ */
@@ -0,0 +1,111 @@
+/*
+ * log.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_LOG_H_
+#define INC_LOG_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/* Severity levels */
+#define LOG_LEVEL_NONE					0
+#define LOG_LEVEL_ERROR					1
+#define LOG_LEVEL_WARN					2
+#define LOG_LEVEL_INFO					3
+#define LOG_LEVEL_DEBUG					4
+
+
+/* User Configuration */
+// messages above LOG_LEVEL are removed at compile time, together with the evaluation of their arguments
+#ifndef LOG_LEVEL
+#ifdef DEBUG
+#define LOG_LEVEL						LOG_LEVEL_INFO
+#else
+#define LOG_LEVEL						LOG_LEVEL_WARN
+#endif
+#endif
+
+#define LOG_RING_SIZE					1024	// bytes, power of 2
+#define LOG_MAX_ARGS					6
+
+
+/*
+ * Messages, the format strings never reach the flash: the record only carries the message id,
+ * the host formats it again from this list (python/frame_decoder.py parses it, ids count from 0 in this order).
+ * Integer arguments only, %d/%i print them as signed.
+ */
+#define LOG_MESSAGES(X) \
+	X(LOG_ICM_WHO_AM_I,			"icm20948 who am i is 0x%x, identity verified") \
+	X(LOG_ICM_ID_MISMATCH,		"icm20948 who am i is 0x%x, expected 0x%x") \
+	X(LOG_AK_WHO_AM_I,			"ak09916 who am i is 0x%x, identity verified") \
+	X(LOG_AK_ID_MISMATCH,		"ak09916 who am i is 0x%x, expected 0x%x") \
+	X(LOG_MAG_NOT_READY,		"ak09916 data is not ready") \
+	X(LOG_MAG_OVERFLOW,			"ak09916 data is overflow") \
+	X(LOG_MAG_RAW,				"magnetometer: %d, %d, %d LSB") \
+	X(LOG_ACCEL_MG,				"accelerometer: %d, %d, %d mg") \
+	X(LOG_GYRO_MDPS,			"gyroscope: %d, %d, %d mdps") \
+	X(LOG_MAG_NT,				"magnetometer: %d, %d, %d nT") \
+	X(LOG_RTC_DATE,				"RTC date is %04u/%02u/%02u") \
+	X(LOG_RTC_TIME,				"UTC time is %02u:%02u:%02u") \
+	X(LOG_UNIX_TIME,			"unix timestamp: %u") \
+	X(LOG_LOCAL_TIME,			"local time: %04u-%02u-%02u %02u:%02u:%02u") \
+	X(LOG_ELAPSED,				"elapsed time: %02u:%02u") \
+	X(LOG_SYNC_ROUND,			"time sync: offset %d us, round trip %u us, calibration %d ppb") \
+	X(LOG_TZ_SET,				"time zone: standard time %d s, summer time %d s east of UTC") \
+	X(LOG_TZ_INVALID,			"time zone rule rejected") \
+	X(LOG_FLASH_ID,				"mt25ql512 id %02x %02x %02x, identity verified") \
+	X(LOG_FLASH_ID_MISMATCH,	"mt25ql512 id %02x %02x %02x, expected 20 ba 20") \
+	X(LOG_FLASH_TIMEOUT,		"mt25ql512 command 0x%02x timed out") \
+	X(LOG_FLASH_FAILED,			"mt25ql512 command 0x%02x failed, flag status 0x%02x")
+
+
+/* Typedefs */
+#define LOG_ENUM(id, fmt)				id,
+typedef enum
+{
+	LOG_MESSAGES(LOG_ENUM)
+	LOG_COUNT
+} log_id;
+#undef LOG_ENUM
+
+/*
+ * Record in the RAM ring, little endian:
+ *   uint16 message id, uint8 level, uint8 number of arguments,
+ *   uint32 HAL_GetTick() in ms, uint32 arguments
+ */
+#define LOG_HEADER_LEN					8
+#define LOG_MAX_RECORD_LEN				(LOG_HEADER_LEN + 4 * LOG_MAX_ARGS)
+
+
+/* Macros */
+// LOG_WARN(LOG_MAG_OVERFLOW); LOG_INFO(LOG_ICM_WHO_AM_I, id);
+#define LOG_AT(level, id, ...) \
+	do { \
+		if((level) <= LOG_LEVEL) \
+		{ \
+			const uint32_t log_args_[] = { 0, ##__VA_ARGS__ }; \
+			log_write((id), (level), &log_args_[1], sizeof(log_args_) / sizeof(uint32_t) - 1); \
+		} \
+	} while(0)
+
+#define LOG_ERROR(...)					LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)					LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)					LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)					LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+
+/* Functions */
+void log_init(void);
+// any context, a full ring drops the record
+void log_write(log_id id, uint8_t level, const uint32_t* args, uint8_t nargs);
+// consumer: whole records only, up to max bytes, log_consume() once they have been sent
+uint16_t log_peek(uint8_t* out, uint16_t max);
+void log_consume(uint16_t len);
+uint32_t log_dropped(void);
+
+#endif /* INC_LOG_H_ */
@@ -57,6 +57,9 @@ void Error_Handler(void);
 /* USER CODE END EFP */
 
 /* Private defines -----------------------------------------------------------*/
+#define ICM_INT_Pin GPIO_PIN_1
+#define ICM_INT_GPIO_Port GPIOA
+#define ICM_INT_EXTI_IRQn EXTI1_IRQn
 #define SPI1_CS_Pin GPIO_PIN_4
 #define SPI1_CS_GPIO_Port GPIOA
 #define LED_Pin GPIO_PIN_13
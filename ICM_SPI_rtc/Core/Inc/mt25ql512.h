@@ -0,0 +1,119 @@
+/*
+ * mt25ql512.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_MT25QL512_H_
+#define INC_MT25QL512_H_
+
+#include "quadspi.h"		// header from stm32cubemx code generate
+#include <stdbool.h>
+#include <stdint.h>
+
+/* User Configuration */
+#define MT25QL512_QSPI					(&hqspi)
+
+#define MT25QL512_TIMEOUT				10		// ms, commands and data phases
+#define MT25QL512_PROGRAM_TIMEOUT		5		// ms, page program, 1.8 ms max
+#define MT25QL512_SUBSECTOR_TIMEOUT		500		// ms, 4 KB erase, 400 ms max
+#define MT25QL512_SECTOR_TIMEOUT		1200	// ms, 64 KB erase, 1 s max
+#define MT25QL512_RESET_TIMEOUT			1200	// ms, a reset during an erase finishes the erase first
+#define MT25QL512_POLL_INTERVAL			256		// QSPI clock cycles between two flag status reads, 6.4 us
+#define MT25QL512_MAPPED_TIMEOUT		64		// QSPI clock cycles without a read before nCS is released
+
+
+/* Defines */
+#define MT25QL512_SIZE					0x04000000u		// 64 MB
+#define MT25QL512_PAGE_SIZE				256
+#define MT25QL512_SUBSECTOR_SIZE		4096
+#define MT25QL512_SECTOR_SIZE			65536
+
+// memory-mapped window, MT25QL512_SIZE bytes
+#define MT25QL512_MAPPED_BASE			QSPI_BASE
+
+// READ ID, JEDEC
+#define MT25QL512_MANUFACTURER_ID		0x20	// Micron
+#define MT25QL512_MEMORY_TYPE			0xBA	// 3 V
+#define MT25QL512_CAPACITY				0x20	// 512 Mb
+
+// Commands, extended SPI protocol. The 4-byte address variants are used, they do not depend on the address mode.
+#define MT25QL512_RESET_ENABLE			0x66
+#define MT25QL512_RESET_MEMORY			0x99
+#define MT25QL512_READ_ID				0x9F
+#define MT25QL512_READ_STATUS			0x05
+#define MT25QL512_READ_FLAG_STATUS		0x70
+#define MT25QL512_CLEAR_FLAG_STATUS		0x50
+#define MT25QL512_WRITE_ENABLE			0x06
+#define MT25QL512_WRITE_DISABLE			0x04
+#define MT25QL512_ENTER_4B_ADDRESS		0xB7
+#define MT25QL512_EXIT_4B_ADDRESS		0xE9
+#define MT25QL512_READ					0x03	// 1-1-1, 3 or 4 byte address as the address mode
+#define MT25QL512_READ_4B				0x13	// 1-1-1
+#define MT25QL512_QUAD_IO_READ_4B		0xEC	// 1-4-4, MT25QL512_QUAD_IO_READ_DUMMY dummy cycles
+#define MT25QL512_PAGE_PROGRAM			0x02	// 1-1-1, 3 or 4 byte address as the address mode
+#define MT25QL512_PAGE_PROGRAM_4B		0x12	// 1-1-1
+#define MT25QL512_QUAD_IO_PROGRAM_4B	0x3E	// 1-4-4
+#define MT25QL512_SUBSECTOR_ERASE		0x20	// 4 KB, 3 or 4 byte address as the address mode
+#define MT25QL512_SUBSECTOR_ERASE_4B	0x21	// 4 KB
+#define MT25QL512_SECTOR_ERASE			0xD8	// 64 KB, 3 or 4 byte address as the address mode
+#define MT25QL512_SECTOR_ERASE_4B		0xDC	// 64 KB
+
+#define MT25QL512_QUAD_IO_READ_DUMMY	10		// default of the nonvolatile configuration register
+
+// status register
+#define MT25QL512_SR_WIP				0x01	// program or erase in progress
+#define MT25QL512_SR_WEL				0x02	// write enable latch
+
+// flag status register, the errors stay set until CLEAR FLAG STATUS
+#define MT25QL512_FSR_READY				0x80
+#define MT25QL512_FSR_ERASE_ERROR		0x20
+#define MT25QL512_FSR_PROGRAM_ERROR		0x10
+#define MT25QL512_FSR_PROTECTION_ERROR	0x02
+#define MT25QL512_FSR_4B_ADDRESS		0x01
+#define MT25QL512_FSR_ERRORS			(MT25QL512_FSR_ERASE_ERROR | MT25QL512_FSR_PROGRAM_ERROR | MT25QL512_FSR_PROTECTION_ERROR)
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t pages;					// page programs
+	uint32_t bytes;					// bytes programmed
+	uint32_t subsector_erases;
+	uint32_t sector_erases;
+	uint32_t errors;				// refused commands, flag status errors, timeouts
+} mt25ql512_stats;
+
+// program or erase done, called from the QUADSPI interrupt, ok is false if the device reported an error
+typedef void (*mt25ql512_done_cb)(bool ok, void* ctx);
+
+
+/* Functions */
+// reset the device and check its id, false if it does not answer as an MT25QL512
+bool mt25ql512_init(void);
+void mt25ql512_read_id(uint8_t id[3]);
+
+// Program and erase run in the background: the data phase on DMA, then the QUADSPI polls the flag status
+// register on its own and interrupts once the device is ready. One operation at a time, started from the
+// main loop, which is also the only reader of the memory-mapped window.
+// program within one page, data must stay valid until the callback runs
+bool mt25ql512_program_async(uint32_t addr, const uint8_t* data, uint16_t len, mt25ql512_done_cb cb, void* ctx);
+// erase the MT25QL512_SUBSECTOR_SIZE or MT25QL512_SECTOR_SIZE block holding addr
+bool mt25ql512_erase_async(uint32_t addr, uint32_t size, mt25ql512_done_cb cb, void* ctx);
+bool mt25ql512_busy(void);
+// main loop: an operation running past its timeout is aborted, its callback runs with ok false
+void mt25ql512_poll(void);
+
+// blocking versions, not to be used from an interrupt
+bool mt25ql512_program(uint32_t addr, const uint8_t* data, uint32_t len);
+bool mt25ql512_erase(uint32_t addr, uint32_t size);
+
+// Reads go through the memory-mapped window (quad I/O fast read), entered on the first read after a
+// program or erase. NULL / false while an operation is running.
+const uint8_t* mt25ql512_mapped(uint32_t addr);
+bool mt25ql512_read(uint32_t addr, uint8_t* buf, uint32_t len);
+
+void mt25ql512_get_stats(mt25ql512_stats* stats);
+
+#endif /* INC_MT25QL512_H_ */
@@ -0,0 +1,93 @@
+/*
+ * prof.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_PROF_H_
+#define INC_PROF_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "main.h"
+
+
+/* User Configuration */
+// the probes are only built into the Debug configuration, Release compiles them to nothing
+#ifdef DEBUG
+#define PROF_ENABLED					1
+#else
+#define PROF_ENABLED					0
+#endif
+
+#define PROF_BUCKETS					16		// histogram buckets, powers of 2 of the cycle count
+#define PROF_BUCKET_SHIFT				6		// bucket 0: < 64 cycles, bucket i: < 64 << i cycles, the last one: everything longer
+#define PROF_LINE_LEN					200		// longest prof_format() line
+
+
+/* Typedefs */
+// one probe per pipeline stage
+typedef enum
+{
+	PROF_WAIT = 0,				// main loop asleep, waiting for a sample
+	PROF_SPI_READ,				// data ready interrupt to SPI1 DMA burst complete
+	PROF_PARSE,					// icm20948_parse_raw_sample()
+	PROF_READ_TIME,				// read_time()
+	PROF_ENCODE,				// frame_encode_sample() / frame_encode_text()
+	PROF_USB_WRITE,				// usb_stream_write(), including a CDC_Transmit_FS() kick
+	PROF_PROCESS,				// app_process() without PROF_WAIT
+	PROF_COUNT
+} prof_probe;
+
+typedef struct
+{
+	uint32_t start;				// CYCCNT at prof_begin()
+	uint32_t count;
+	uint32_t min;				// cycles
+	uint32_t max;
+	uint64_t sum;
+	uint32_t hist[PROF_BUCKETS];
+} prof_stats;
+
+
+/* Macros */
+#if PROF_ENABLED
+#define PROF_INIT()						prof_init()
+#define PROF_BEGIN(probe)				prof_begin(probe)
+#define PROF_END(probe)					prof_end(probe)
+#else
+#define PROF_INIT()						((void)0)
+#define PROF_BEGIN(probe)				((void)0)
+#define PROF_END(probe)					((void)0)
+#endif
+
+
+#if PROF_ENABLED
+extern prof_stats prof_data[PROF_COUNT];
+
+/* Functions */
+void prof_init(void);
+void prof_reset(void);
+void prof_record(prof_probe probe, uint32_t cycles);
+// Copy of one probe, consistent even while the interrupts keep recording
+void prof_get(prof_probe probe, prof_stats* stats);
+// One text line for a probe, returns the string length
+uint16_t prof_format(prof_probe probe, char* out, uint16_t size);
+
+static inline uint32_t prof_cycles(void)
+{
+	return DWT->CYCCNT;
+}
+// A probe can begin in one context and end in another, but must not be nested with itself
+static inline void prof_begin(prof_probe probe)
+{
+	prof_data[probe].start = DWT->CYCCNT;
+}
+static inline void prof_end(prof_probe probe)
+{
+	prof_record(probe, DWT->CYCCNT - prof_data[probe].start);
+}
+#endif
+
+#endif /* INC_PROF_H_ */
@@ -0,0 +1,50 @@
+/*
+ * ring_buffer.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_RING_BUFFER_H_
+#define INC_RING_BUFFER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Single producer, single consumer byte ring.
+ * One context writes, one context reads, e.g. an interrupt and the main loop,
+ * no interrupt masking is needed as each index is only written by one side.
+ * The indices run freely and wrap at 65536, so the size must be a power of 2, 32768 at most.
+ */
+typedef struct
+{
+	uint8_t* buf;
+	uint16_t size;
+	volatile uint16_t head;		// written by the producer only
+	volatile uint16_t tail;		// written by the consumer only
+
+	// producer side statistics
+	uint32_t dropped;			// writes rejected for lack of space
+	uint32_t dropped_bytes;
+	uint16_t high_water;		// most bytes ever queued
+} ring_buffer;
+
+
+/* Functions */
+bool ring_init(ring_buffer* ring, uint8_t* buf, uint16_t size);
+
+// producer, all or nothing
+bool ring_write(ring_buffer* ring, const uint8_t* data, uint16_t len);
+
+// consumer
+uint16_t ring_peek(ring_buffer* ring, uint8_t* data, uint16_t max);
+void ring_consume(ring_buffer* ring, uint16_t len);
+uint16_t ring_read(ring_buffer* ring, uint8_t* data, uint16_t max);
+
+// either side
+uint16_t ring_used(const ring_buffer* ring);
+uint16_t ring_free(const ring_buffer* ring);
+
+#endif /* INC_RING_BUFFER_H_ */
@@ -35,6 +35,14 @@ extern "C" {
 extern RTC_HandleTypeDef hrtc;
 
 /* USER CODE BEGIN Private defines */
+/* Backup registers, kept with the running calendar through a reset while VDD or VBAT is present */
+#define RTC_BKUP_MAGIC_REG			RTC_BKP_DR0		// RTC_BKUP_MAGIC once MX_RTC_Init() has set the calendar
+#define RTC_BKUP_SYNC_TIME_REG		RTC_BKP_DR1		// unix time of the last time sync round, 0: never synced
+#define RTC_BKUP_SYNC_OFFSET_REG	RTC_BKP_DR2		// offset of that round, microseconds, int32
+#define RTC_BKUP_SYNC_DELAY_REG		RTC_BKP_DR3		// round trip of that round, microseconds
+#define RTC_BKUP_CALIB_REG			RTC_BKP_DR4		// RTC smooth calibration, RTCCLK pulses per 32 s, int32
+#define RTC_BKUP_PHASE_REG			RTC_BKP_DR5		// timebase phase correction below one sub-second, microseconds, int32
+#define RTC_BKUP_MAGIC				0x52544331u		// "RTC1", change it with the layout
 
 /* USER CODE END Private defines */
 
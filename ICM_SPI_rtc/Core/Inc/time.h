@@ -45,16 +45,11 @@ __packed typedef struct
 typedef struct{
     uint32_t unix_timestamp;
     nmea_time utc_time;
-    nmea_time uk_time;
+    nmea_time local_time;       // time zone of tz.c
     uint32_t elapsed_minutes;
     uint32_t elapsed_seconds;
 }time_data;
 
-//Current UK time
-typedef struct {
-    nmea_time local_time;
-} NMEA_Result;
-
 typedef struct t_xtime {
   int year; int month;  int day;
   int hour; int minute;  int second;
@@ -68,7 +63,6 @@ typedef struct t_xtime {
 #define ONEDAYTOSENCOND (24 * 60 * 60)    // day second conversion
 #define ONEMINUTETOSENCOND 60             // minute second conversion
 
-extern NMEA_Result NMEA_result;
 extern RTC_TimeTypeDef sTime;
 extern RTC_DateTypeDef sDate;
 
@@ -84,6 +78,13 @@ unsigned int  xDate2Seconds(_xtime *time);
 //UNIX to UTC has been converted to desired time zone
 void xSeconds2Date(unsigned long seconds,_xtime *time );
 uint32_t ConvertDateToSecond(const uint8_t *date);
+// constant time conversions between a date and the days since 1970-01-01
+int32_t days_from_civil(int32_t year, uint32_t month, uint32_t day);
+void civil_from_days(int32_t days, nmea_time* time);
+int isLeapYear(int year);
+int daysInMonth(int month, int year);
 time_data read_time(uint32_t startTime);
+// set the RTC calendar, whole seconds
+HAL_StatusTypeDef set_rtc_time(uint32_t unix_time);
 
 #endif /* INC_TIME_H_ */
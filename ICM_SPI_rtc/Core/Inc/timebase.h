@@ -0,0 +1,52 @@
+/*
+ * timebase.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_TIMEBASE_H_
+#define INC_TIMEBASE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "tim.h"
+
+
+/* User Configuration */
+#define TIMEBASE_TICK_HZ				1000000		// TIM2 nominal rate, MX_TIM2_Init()
+#define TIMEBASE_TOLERANCE				(TIMEBASE_TICK_HZ / 16)	// accepted deviation of one measured RTC second
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t seconds;				// RTC second boundaries seen
+	uint32_t rejected;				// measured second out of TIMEBASE_TOLERANCE, e.g. after the RTC was set
+	uint32_t ticks_per_second;		// TIM2 ticks in the last RTC second
+	bool locked;					// at least one measured second, before that the rate is nominal
+	int32_t offset_us;				// software part of the timebase_correct() phase corrections
+} timebase_stats;
+
+
+/* Functions */
+void timebase_init(void);
+// RTC alarm A, every second
+void timebase_rtc_second(void);
+// main loop, after a second boundary: anchors the TIM2 count to the unix time of the boundary
+void timebase_update(void);
+// after the RTC has been set, the anchor is rebuilt from the RTC sub-seconds
+void timebase_reset(void);
+// main loop, move the timestamps by us (|us| < 1 s): the RTC is shifted, the rest is applied in software
+void timebase_correct(int32_t us);
+// microseconds since 1970-01-01 UTC of a TIM2 count latched with timebase_ticks()
+uint64_t timebase_us(uint32_t ticks);
+void timebase_get_stats(timebase_stats* stats);
+
+// any context, a few cycles
+static inline uint32_t timebase_ticks(void)
+{
+	return __HAL_TIM_GET_COUNTER(&htim2);
+}
+
+#endif /* INC_TIMEBASE_H_ */
@@ -0,0 +1,70 @@
+/*
+ * timesync.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_TIMESYNC_H_
+#define INC_TIMESYNC_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * NTP style exchange with the PC, over the USB VCP, the device asks:
+ *
+ *   device -> PC   FRAME_TYPE_SYNC frame, sequence number n, timestamp t1 (device time when sent)
+ *   PC -> device   COMMAND_SYNC_REPLY (command.h), n, t2: PC time the request was read, t3: PC time the reply is written,
+ *                  microseconds since 1970-01-01 UTC
+ *   t4             device time the reply arrived, TIM2 latched in the USB interrupt
+ *
+ *   offset = ((t2 - t1) + (t3 - t4)) / 2, PC minus device
+ *   delay  = (t4 - t1) - (t3 - t2), round trip
+ *
+ * Binary output only, python/frame_decoder.py answers when it reads a serial port.
+ * The last round and the RTC smooth calibration are kept in RTC backup registers (rtc.h), a reset does not lose them.
+ */
+
+/* User Configuration */
+#define TIMESYNC_START_MS				2000	// first round after power on, the timebase is locked by then
+#define TIMESYNC_INTERVAL_MS			32000	// between rounds, one RTC smooth calibration cycle
+#define TIMESYNC_SETTLE_MS				3000	// next round after the RTC calendar was set
+#define TIMESYNC_BURST					8		// exchanges per round, the one with the shortest round trip is used
+#define TIMESYNC_SPACING_MS				125		// between the exchanges of a round
+#define TIMESYNC_MAX_DELAY_US			20000	// longer round trips are not used
+#define TIMESYNC_STEP_US				900000	// larger offsets set the RTC calendar, smaller ones shift it
+#define TIMESYNC_DRIFT_MIN_US			2000	// phase corrected since the last calibration, before the drift is estimated
+#define TIMESYNC_DRIFT_MAX_S			3600	// or this long
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t requests;
+	uint32_t replies;
+	uint32_t rounds;				// with a usable exchange
+	uint32_t steps;					// RTC calendar set
+	uint32_t calibrations;			// RTC smooth calibration changed
+	int32_t offset_us;				// last round, PC minus device, before the correction
+	uint32_t delay_us;				// round trip of that exchange
+	int32_t calib_ppb;				// RTC smooth calibration, positive: sped up
+	bool synced;					// at least one round since the reset
+	uint32_t last_sync;				// unix time of the last round, kept through a reset, 0: never
+} timesync_stats;
+
+
+/* Functions */
+void timesync_init(void);
+// main loop: true when a request is due, the caller sends it right away with frame_encode_sync()
+bool timesync_request(uint16_t* seq, uint64_t* t1_us);
+// main loop: use the replies, correct the RTC at the end of a round
+void timesync_process(void);
+// main loop: reply to request seq, ticks is the TIM2 count at reception
+void timesync_receive(uint16_t seq, uint64_t t2_us, uint64_t t3_us, uint32_t ticks);
+// main loop: start a round now, the RTC is set first if pc_us (PC time, 0: unknown) is TIMESYNC_STEP_US away or more
+void timesync_now(uint64_t pc_us);
+void timesync_get_stats(timesync_stats* stats);
+
+#endif /* INC_TIMESYNC_H_ */
@@ -0,0 +1,62 @@
+/*
+ * tz.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_TZ_H_
+#define INC_TZ_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/*
+ * Time zone rules in the POSIX TZ format, std offset [dst [offset] [,start[/time],end[/time]]]:
+ *
+ *   "GMT0BST,M3.5.0/1,M10.5.0"          UK, summer time from 01:00 on the last Sunday of March to 02:00 on the last Sunday of October
+ *   "CET-1CEST,M3.5.0,M10.5.0/3"        central Europe
+ *   "EST5EDT,M3.2.0,M11.1.0"            US eastern
+ *   "<+0530>-5:30"                      India, no summer time
+ *
+ * The offset is the one to add to local time to get UTC, west of Greenwich is positive. The dst offset is one hour
+ * less than std when left out. A rule day is Mm.w.d (day d, 0: Sunday, of week w, 5: last, of month m), Jn (1 ~ 365,
+ * February 29 is never counted) or n (0 ~ 365), the time is the local time it starts at, 02:00 when left out.
+ * A dst name without rules takes the US rules. The names of tz_presets[] can be used in place of the rule.
+ */
+
+/* User Configuration */
+#define TZ_DEFAULT						"GMT0BST,M3.5.0/1,M10.5.0"	// at power on, UK time as before
+#define TZ_RULE_LEN						48		// longest rule, with the terminating '\0'
+
+
+/* Typedefs */
+typedef struct
+{
+	const char* name;
+	const char* rule;
+} tz_preset;
+
+typedef struct
+{
+	int32_t std_offset;				// seconds east of UTC, standard time
+	int32_t dst_offset;				// summer time, the same as std_offset without one
+	int32_t offset;					// current one
+	uint32_t next_change;			// unix time the offset changes, UINT32_MAX: never
+} tz_info;
+
+extern const tz_preset tz_presets[];
+
+
+/* Functions */
+void tz_init(void);
+// main loop: a preset name or a POSIX TZ rule, the current zone is kept if it does not parse
+bool tz_set(const char* rule);
+// local time of a unix time, one compare and an add until the next offset change
+uint32_t tz_local(uint32_t unix_time);
+// rule of the current zone
+const char* tz_get_rule(void);
+void tz_get_info(tz_info* info);
+
+#endif /* INC_TZ_H_ */
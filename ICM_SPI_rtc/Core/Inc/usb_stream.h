@@ -0,0 +1,71 @@
+/*
+ * usb_stream.h
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef INC_USB_STREAM_H_
+#define INC_USB_STREAM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "usbd_cdc.h"
+
+
+/* User Configuration */
+#define USB_STREAM_RING_SIZE			4096	// bytes queued for the USB VCP, power of 2
+#define USB_STREAM_XFER_LEN				1024	// longest CDC_Transmit_FS() transfer, multiple of 64
+// default batching, changed at run time with usb_stream_set_batch()
+#define USB_STREAM_FLUSH_BYTES			512		// send once this much is queued
+#define USB_STREAM_DEADLINE_MS			10		// or once the oldest byte waited this long, 0: send right away
+#define USB_STREAM_BULK_LEN				1088	// bulk buffer, 17 packets: a flash_dump.c frame and a block CRC
+
+#define USB_STREAM_PACKET_LEN			CDC_DATA_FS_MAX_PACKET_SIZE
+
+
+/* Typedefs */
+typedef struct
+{
+	uint32_t frames;				// accepted into the ring
+	uint32_t dropped_frames;		// rejected, the ring was full
+	uint32_t dropped_bytes;
+	uint32_t transfers;				// CDC_Transmit_FS() calls
+	uint32_t deadline_transfers;	// of which sent because of the latency deadline
+	uint32_t bytes;					// bytes handed to the USB stack
+	uint16_t queued;				// bytes waiting now
+	uint16_t high_water;			// most bytes ever waiting
+	uint32_t bulk_transfers;		// bulk buffers sent, their bytes are counted in bytes
+	uint32_t bulk_cancelled;		// dropped before they were sent
+} usb_stream_stats;
+
+
+/* Functions */
+void usb_stream_init(void);
+
+// producer, main loop
+bool usb_stream_write(const uint8_t* data, uint16_t len);
+
+// consumer, CDC_TransmitCplt_FS() and the main loop for the deadline
+void usb_stream_tx_complete(void);
+void usb_stream_poll(void);
+// main loop, send what is queued without waiting for the batch
+void usb_stream_flush(void);
+
+void usb_stream_set_batch(uint16_t bytes, uint16_t ms);
+
+// Bulk buffers, main loop: frames written in place and sent as one transfer each, between two frames of the ring.
+// There are two, one is sent while the other one is filled.
+// a free buffer of USB_STREAM_BULK_LEN bytes, NULL while both are queued or in flight
+uint8_t* usb_stream_bulk_buffer(void);
+// queue the buffer usb_stream_bulk_buffer() returned, len bytes of it
+void usb_stream_bulk_send(uint16_t len);
+// drop the buffers not sent yet
+void usb_stream_bulk_cancel(void);
+// the host configured the device, false once the cable is pulled
+bool usb_stream_connected(void);
+
+void usb_stream_get_stats(usb_stream_stats* stats);
+void usb_stream_reset_stats(void);
+
+#endif /* INC_USB_STREAM_H_ */
@@ -0,0 +1,337 @@
+/**
+ * @file app.c
+ * @brief Acquisition pipeline, from the ICM20948 data ready interrupt to the USB VCP
+ *
+ * 1. The data ready interrupt latches the TIM2 count and starts a SPI1 DMA burst read of one sample.
+ * 2. The DMA callback queues the TIM2 count, the full-scale selection and the raw burst in sample_ring.
+ * 3. The main loop sleeps until a burst is queued, time stamps it (timebase.c), formats it
+ *    as a text line or a binary frame and queues it for the USB VCP.
+ *
+ * Every stage is timed by a prof.c probe in the Debug configuration, COMMAND_PROFILE sends the results.
+ * The log.c records are sent after the samples, one batch per pass.
+ * In binary output the time sync requests of timesync.c go out between the samples.
+ * The commands received on the USB VCP (command.h) run between the samples too, the wait for the next
+ * sample ends when one arrives, and once per millisecond while the stream is stopped.
+ * A flash dump (flash_dump.c) fills its next USB buffer as soon as one is free, between the samples as well.
+ *
+ * Kept out of main.c so that the same code runs on the board and in the host build (Host/).
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "app.h"
+#include "icm20948.h"
+#include "time.h"
+#include "usb_stream.h"
+#include "prof.h"
+#include "log.h"
+#include "timebase.h"
+#include "timesync.h"
+#include "tz.h"
+#include "command.h"
+#include "mt25ql512.h"
+#include "flash_log.h"
+#include "flash_dump.h"
+
+
+//organized data for future sending, including the time data and sensor data
+typedef struct {
+    time_data time_info;
+    icm20948_raw_sample sensor_data;
+} combined_data;
+
+output_format tx_format = output_binary;
+ring_buffer sample_ring;
+
+//the SPI1 DMA read lands here, the callback copies it into sample_ring before the next read completes
+static uint8_t raw_burst[ICM20948_BURST_LEN];
+//sample_ring record: the TIM2 count at data ready, the icm20948_full_scale() the burst was read with, then the burst
+//a range change does not reach the samples already queued
+#define SAMPLE_RECORD_LEN				(sizeof(uint32_t) + 1 + ICM20948_BURST_LEN)
+static uint8_t sample_ring_buf[SAMPLE_RING_SIZE];
+
+static uint8_t tx_buffer[FRAME_TEXT_MAX_LEN];
+static uint16_t tx_seq;
+static uint64_t tx_timestamp_us;
+static app_stats pipeline_stats;
+
+//get start time for getting the elapsed time later
+static uint32_t start_time;
+
+
+static void raw_sample_done(uint8_t* buf, uint16_t len, void* ctx);
+static bool wait_for_sample(uint32_t* ticks, uint8_t* full_scale, uint8_t* burst);
+static void send_log(void);
+static void send_sync(void);
+
+
+/**
+ * @brief Initialize the sensors and start the data ready interrupt
+ * @return None.
+ */
+void app_init(void)
+{
+	PROF_INIT();
+	log_init();
+	ring_init(&sample_ring, sample_ring_buf, sizeof(sample_ring_buf));
+	usb_stream_init();
+	timebase_init();
+	timesync_init();
+	tz_init();
+	command_init();
+	flash_dump_init();
+	memset(&pipeline_stats, 0, sizeof(pipeline_stats));
+	start_time = HAL_GetTick();
+
+	pipeline_stats.flash = mt25ql512_init() && flash_log_init();
+
+	//initialize ICM gyroscope, accelerometer and magnetometer peripherals and configuration
+	icm20948_init();
+	ak09916_init();
+
+	//every sample is read once, by the data ready interrupt
+	app_set_streaming(true);
+}
+/**
+ * @brief ICM raw data ready: read the new sample on SPI1 DMA right away
+ * @return None.
+ */
+void app_data_ready(void)
+{
+	//first, the latency of the interrupt is the jitter of the timestamp
+	uint32_t ticks = timebase_ticks();
+
+	PROF_BEGIN(PROF_SPI_READ);
+	//SPI queue full: the sample is lost, the probe records nothing and the next data ready starts it again
+	if(!icm20948_read_all_data_async(raw_burst, raw_sample_done, (void*)(uintptr_t)ticks))
+		pipeline_stats.spi_dropped++;
+}
+/**
+ * @brief Fetch one sample, combine it with the time information and send it over USB
+ * The CPU sleeps until the data ready interrupt has read a new sample or a command has been received.
+ * @return true if a sample was sent.
+ */
+bool app_process(void)
+{
+	combined_data dataToSend;
+	uint8_t burst[ICM20948_BURST_LEN];
+	uint32_t ticks;
+	uint16_t tx_len;
+	uint8_t full_scale;
+	bool sample;
+
+	PROF_BEGIN(PROF_WAIT);
+	sample = wait_for_sample(&ticks, &full_scale, burst);
+	PROF_END(PROF_WAIT);
+
+	if(sample)
+	{
+		PROF_BEGIN(PROF_PROCESS);
+		PROF_BEGIN(PROF_PARSE);
+		icm20948_parse_raw_sample(burst, full_scale, &dataToSend.sensor_data);
+		PROF_END(PROF_PARSE);
+
+		PROF_BEGIN(PROF_READ_TIME);
+		dataToSend.time_info = read_time(start_time);
+		timebase_update();
+		tx_timestamp_us = timebase_us(ticks);
+		PROF_END(PROF_READ_TIME);
+
+		PROF_BEGIN(PROF_ENCODE);
+		switch(tx_format)
+		{
+		case output_binary:
+			tx_len = frame_encode_sample(tx_buffer, tx_seq++, tx_timestamp_us, &dataToSend.sensor_data);
+			break;
+		case output_text:
+		default:
+			tx_len = frame_encode_text((char*)tx_buffer, sizeof(tx_buffer), &dataToSend.time_info, &dataToSend.sensor_data);
+			break;
+		}
+		PROF_END(PROF_ENCODE);
+
+		//queued, the USB transfer complete callback sends it once the endpoint is free
+		PROF_BEGIN(PROF_USB_WRITE);
+		usb_stream_write(tx_buffer, tx_len);
+		PROF_END(PROF_USB_WRITE);
+
+		//and kept on the flash, staged in RAM until the flash takes it
+		flash_log_append(tx_timestamp_us, &dataToSend.sensor_data);
+		PROF_END(PROF_PROCESS);
+		pipeline_stats.samples++;
+	}
+	else
+		timebase_update();
+
+	send_log();
+	timesync_process();
+	send_sync();
+	command_process();
+	flash_dump_process();
+	flash_log_process();
+
+	return sample;
+}
+/**
+ * @brief Bytes received on the USB VCP, called from CDC_Receive_FS() in the USB interrupt
+ * Queued for the main loop as command frames, see command.h.
+ * @return None.
+ */
+void app_usb_receive(const uint8_t* buf, uint32_t len)
+{
+	//first, t4 of a time sync reply
+	command_receive(buf, len, timebase_ticks());
+}
+/**
+ * @brief Start or stop the data ready interrupt, the samples already read are still sent
+ * @return None.
+ */
+void app_set_streaming(bool on)
+{
+	if(on)
+		icm20948_data_ready_enable();
+	else
+	{
+		icm20948_data_ready_disable();
+		flash_log_flush();
+	}
+	pipeline_stats.streaming = on;
+}
+/**
+ * @brief One line per probe, as text or as FRAME_TYPE_TEXT frames so that a binary stream stays decodable
+ * @return None.
+ */
+void app_send_profile(void)
+{
+#if PROF_ENABLED
+	char line[PROF_LINE_LEN];
+	uint8_t frame[FRAME_MAX_TEXT_ENCODED_LEN];
+	uint16_t len;
+	int i;
+
+	for(i = 0; i < PROF_COUNT; i++)
+	{
+		len = prof_format(i, line, sizeof(line));
+		if(tx_format == output_binary)
+		{
+			len = frame_encode_message(frame, FRAME_TYPE_TEXT, tx_timestamp_us, line, len);
+			usb_stream_write(frame, len);
+		}
+		else
+			usb_stream_write((uint8_t*)line, len);
+	}
+#endif
+}
+/**
+ * @brief Copy the pipeline counters
+ * @return None.
+ */
+void app_get_stats(app_stats* stats_out)
+{
+	*stats_out = pipeline_stats;
+}
+
+
+/* Static Functions */
+//SPI1 DMA completion of the sample burst read, queue it for the main loop with the TIM2 count passed in ctx
+//a full ring drops the sample, sample_ring.dropped counts them
+static void raw_sample_done(uint8_t* buf, uint16_t len, void* ctx)
+{
+	uint8_t record[SAMPLE_RECORD_LEN];
+	uint32_t ticks = (uint32_t)(uintptr_t)ctx;
+
+	//failed or aborted read, counted in the SPI errors
+	if(len == 0)
+		return;
+
+	PROF_END(PROF_SPI_READ);
+	memcpy(record, &ticks, sizeof(ticks));
+	record[sizeof(ticks)] = icm20948_full_scale();
+	memcpy(record + sizeof(ticks) + 1, buf, ICM20948_BURST_LEN);
+	ring_write(&sample_ring, record, sizeof(record));
+}
+//Sleep until a sample has been queued, a command received or a dump buffer freed, any interrupt wakes the core up
+//to check again
+//the SysTick wake up also flushes the USB batch once its deadline has passed
+static bool wait_for_sample(uint32_t* ticks, uint8_t* full_scale, uint8_t* burst)
+{
+	uint8_t record[SAMPLE_RECORD_LEN];
+
+	__disable_irq();
+	while(ring_used(&sample_ring) < SAMPLE_RECORD_LEN && !command_pending() && !flash_dump_pending())
+	{
+		__WFI();
+		__enable_irq();
+		usb_stream_poll();
+		__disable_irq();
+		// stopped: one pass per wake up, for the commands, the log and the time sync
+		if(!pipeline_stats.streaming)
+			break;
+	}
+	__enable_irq();
+
+	if(ring_used(&sample_ring) < SAMPLE_RECORD_LEN)
+		return false;
+
+	ring_read(&sample_ring, record, sizeof(record));
+	memcpy(ticks, record, sizeof(*ticks));
+	*full_scale = record[sizeof(*ticks)];
+	memcpy(burst, record + sizeof(*ticks) + 1, ICM20948_BURST_LEN);
+	return true;
+}
+//Time sync request, when one is due: sent at once, t1 is taken just before
+static void send_sync(void)
+{
+	uint8_t frame[FRAME_SYNC_ENCODED_LEN];
+	timesync_stats stats;
+	uint64_t t1;
+	uint16_t seq;
+
+	if(tx_format != output_binary || !timesync_request(&seq, &t1))
+		return;
+
+	timesync_get_stats(&stats);
+	usb_stream_write(frame, frame_encode_sync(frame, seq, t1, stats.offset_us, stats.delay_us, stats.calib_ppb));
+	usb_stream_flush();
+}
+//Send the oldest log records that fit in one frame, they stay queued while the USB stream is full
+//text output has no framing for binary records, they are sent as "log,<tick>,<level>,<id>,<args>" lines
+static void send_log(void)
+{
+	uint8_t records[FRAME_MAX_TEXT];
+	uint8_t frame[FRAME_MAX_TEXT_ENCODED_LEN];
+	char* line = (char*)frame;
+	uint16_t len, pos, line_len;
+	uint32_t word;
+	int i;
+
+	len = log_peek(records, sizeof(records));
+	if(len == 0)
+		return;
+
+	if(tx_format == output_binary)
+	{
+		if(!usb_stream_write(frame, frame_encode_message(frame, FRAME_TYPE_LOG, tx_timestamp_us, records, len)))
+			return;
+		log_consume(len);
+		return;
+	}
+
+	for(pos = 0; pos < len; pos += LOG_HEADER_LEN + records[pos + 3] * 4)
+	{
+		memcpy(&word, &records[pos + 4], 4);
+		line_len = snprintf(line, sizeof(frame), "log,%lu,%u,%u", (unsigned long)word, records[pos + 2],
+				records[pos] | records[pos + 1] << 8);
+		for(i = 0; i < records[pos + 3]; i++)
+		{
+			memcpy(&word, &records[pos + LOG_HEADER_LEN + 4 * i], 4);
+			line_len += snprintf(line + line_len, sizeof(frame) - line_len, ",%lu", (unsigned long)word);
+		}
+		line_len += snprintf(line + line_len, sizeof(frame) - line_len, "\r\n");
+		if(!usb_stream_write((uint8_t*)line, line_len))
+			break;
+		log_consume(LOG_HEADER_LEN + records[pos + 3] * 4);
+	}
+}
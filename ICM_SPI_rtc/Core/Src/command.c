@@ -0,0 +1,430 @@
+/**
+ * @file command.c
+ * @brief Commands from the PC on the USB VCP OUT endpoint, answered with binary responses
+ *
+ * 1. The USB interrupt only splits the received bytes on 0x00 and queues every COBS encoded frame
+ *    with the TIM2 count it arrived at in command_queue, the same lock-free ring as the samples.
+ * 2. The main loop decodes and checks the frames (frame_decode()), runs the commands and queues
+ *    a FRAME_TYPE_RESPONSE frame for each, in front of the samples that are not sent yet.
+ *
+ * The commands and their arguments are listed in command.h.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "command.h"
+#include "app.h"
+#include "frame.h"
+#include "usb_stream.h"
+#include "icm20948.h"
+#include "timebase.h"
+#include "timesync.h"
+#include "tz.h"
+#include "prof.h"
+#include "flash_log.h"
+#include "flash_dump.h"
+
+
+// queue record: uint32 TIM2 count, uint16 length, COBS encoded frame
+#define COMMAND_RECORD_HEADER			6
+#define COMMAND_FRAME_MAX				(FRAME_HEADER_LEN + 1 + COMMAND_MAX_ARGS + FRAME_CRC_LEN + 1)
+
+static ring_buffer command_queue;
+static uint8_t command_queue_buf[COMMAND_QUEUE_SIZE];
+static command_stats stats;
+
+//frame being received, USB interrupt only
+static uint8_t rx_record[COMMAND_RECORD_HEADER + COMMAND_FRAME_MAX];
+static uint16_t rx_len;					// COMMAND_FRAME_MAX + 1: too long, dropped at the 0x00
+
+
+static void run(uint16_t seq, uint8_t id, const uint8_t* args, uint16_t len, uint32_t ticks);
+static uint16_t get_stats(uint8_t* p);
+static uint8_t* put_config(uint8_t* p, const icm20948_sensor_config* config);
+static uint16_t get_log_stats(uint8_t* p);
+static uint16_t get_u16(const uint8_t* p);
+static uint32_t get_u32(const uint8_t* p);
+static uint64_t get_u64(const uint8_t* p);
+static uint8_t* put_u32(uint8_t* p, uint32_t val);
+
+
+/**
+ * @brief Empty the queue
+ * @return None.
+ */
+void command_init(void)
+{
+	ring_init(&command_queue, command_queue_buf, sizeof(command_queue_buf));
+	memset(&stats, 0, sizeof(stats));
+	rx_len = 0;
+}
+/**
+ * @brief Bytes received on the OUT endpoint, called from the USB interrupt
+ * Complete frames are queued as they are, a frame can span several packets.
+ * @return None.
+ */
+void command_receive(const uint8_t* buf, uint32_t len, uint32_t ticks)
+{
+	uint16_t frame_len;
+	uint32_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		if(buf[i] != 0x00)
+		{
+			if(rx_len < COMMAND_FRAME_MAX)
+				rx_record[COMMAND_RECORD_HEADER + rx_len++] = buf[i];
+			else
+				rx_len = COMMAND_FRAME_MAX + 1;
+			continue;
+		}
+
+		// a 0x00 on its own only resynchronises
+		if(rx_len == 0)
+			continue;
+		frame_len = rx_len;
+		rx_len = 0;
+		if(frame_len > COMMAND_FRAME_MAX)
+		{
+			stats.dropped++;
+			continue;
+		}
+
+		// the time the frame was complete, t4 of a time sync reply
+		memcpy(rx_record, &ticks, sizeof(ticks));
+		memcpy(rx_record + sizeof(ticks), &frame_len, sizeof(frame_len));
+		if(ring_write(&command_queue, rx_record, COMMAND_RECORD_HEADER + frame_len))
+			stats.frames++;
+		else
+			stats.dropped++;
+	}
+}
+/**
+ * @brief Frames are waiting for command_process()
+ * @return true if the queue is not empty.
+ */
+bool command_pending(void)
+{
+	return ring_used(&command_queue) != 0;
+}
+/**
+ * @brief Run every queued command
+ * @return None.
+ */
+void command_process(void)
+{
+	uint8_t record[COMMAND_RECORD_HEADER + COMMAND_FRAME_MAX];
+	uint8_t frame[COMMAND_FRAME_MAX];
+	uint32_t ticks;
+	uint16_t len, n;
+
+	while(ring_peek(&command_queue, record, COMMAND_RECORD_HEADER) == COMMAND_RECORD_HEADER)
+	{
+		memcpy(&ticks, record, sizeof(ticks));
+		memcpy(&len, record + sizeof(ticks), sizeof(len));
+		ring_read(&command_queue, record, COMMAND_RECORD_HEADER + len);
+
+		n = frame_decode(record + COMMAND_RECORD_HEADER, len, frame);
+		if(n <= FRAME_HEADER_LEN || frame[1] != FRAME_TYPE_COMMAND)
+		{
+			stats.rejected++;
+			continue;
+		}
+
+		run(frame[2] | frame[3] << 8, frame[FRAME_HEADER_LEN], frame + FRAME_HEADER_LEN + 1, n - FRAME_HEADER_LEN - 1, ticks);
+	}
+}
+/**
+ * @brief Copy the command counters
+ * @return None.
+ */
+void command_get_stats(command_stats* stats_out)
+{
+	*stats_out = stats;
+}
+
+
+/* Static Functions */
+//run one command and queue its response, a bad argument length is refused before anything is changed
+static void run(uint16_t seq, uint8_t id, const uint8_t* args, uint16_t len, uint32_t ticks)
+{
+	uint8_t result[COMMAND_MAX_RESULT];
+	uint8_t response[FRAME_MAX_TEXT_ENCODED_LEN];
+	char rule[TZ_RULE_LEN];
+	uint16_t result_len = 0;
+	uint8_t status = COMMAND_STATUS_OK;
+	bool profile = false;
+	icm20948_sensor_config gyro, accel;
+	app_stats app;
+	flash_log_range range;
+	flash_dump_stats dump;
+
+	stats.commands++;
+
+	switch(id)
+	{
+	case COMMAND_START:
+	case COMMAND_STOP:
+		if(len != 0)
+			status = COMMAND_STATUS_BAD_ARGS;
+		else
+			app_set_streaming(id == COMMAND_START);
+		break;
+
+	case COMMAND_SET_ODR:
+		icm20948_get_config(&gyro, &accel);
+		if(len != 4 || (gyro.odr_mhz = get_u32(args)) == 0)
+		{
+			status = COMMAND_STATUS_BAD_ARGS;
+			break;
+		}
+		// the accelerometer divider goes further, it takes the rate the gyroscope got
+		icm20948_gyro_configure(&gyro, &gyro);
+		accel.odr_mhz = gyro.odr_mhz;
+		icm20948_accel_configure(&accel, &accel);
+		put_u32(result, gyro.odr_mhz);
+		result_len = 4;
+		break;
+
+	case COMMAND_SET_SCALE:
+		if(len != 2 || (args[0] > _16g && args[0] != 0xFF) || (args[1] > _2000dps && args[1] != 0xFF))
+		{
+			status = COMMAND_STATUS_BAD_ARGS;
+			break;
+		}
+		if(args[0] != 0xFF)
+			icm20948_accel_full_scale_select(args[0]);
+		if(args[1] != 0xFF)
+			icm20948_gyro_full_scale_select(args[1]);
+		break;
+
+	case COMMAND_SET_BANDWIDTH:
+		if(len != 8)
+		{
+			status = COMMAND_STATUS_BAD_ARGS;
+			break;
+		}
+		icm20948_get_config(&gyro, &accel);
+		if(get_u32(args) != UINT32_MAX)
+		{
+			gyro.bandwidth_mhz = get_u32(args);
+			icm20948_gyro_configure(&gyro, &gyro);
+		}
+		if(get_u32(args + 4) != UINT32_MAX)
+		{
+			accel.bandwidth_mhz = get_u32(args + 4);
+			icm20948_accel_configure(&accel, &accel);
+		}
+		put_u32(put_u32(result, gyro.bandwidth_mhz), accel.bandwidth_mhz);
+		result_len = 8;
+		break;
+
+	case COMMAND_GET_CONFIG:
+		if(len != 0)
+		{
+			status = COMMAND_STATUS_BAD_ARGS;
+			break;
+		}
+		icm20948_get_config(&gyro, &accel);
+		result_len = put_config(put_config(result, &gyro), &accel) - result;
+		break;
+
+	case COMMAND_SET_LOGGING:
+	case COMMAND_GET_LOG_STATS:
+		app_get_stats(&app);
+		if(len != (id == COMMAND_SET_LOGGING) || (id == COMMAND_SET_LOGGING && args[0] > 1))
+			status = COMMAND_STATUS_BAD_ARGS;
+		else if(!app.flash)
+			status = COMMAND_STATUS_FAILED;
+		else if(id == COMMAND_SET_LOGGING)
+			flash_log_enable(args[0]);
+		else
+			result_len = get_log_stats(result);
+		break;
+
+	case COMMAND_FIND_LOG:
+		app_get_stats(&app);
+		if(len != 8 || get_u32(args) > get_u32(args + 4))
+			status = COMMAND_STATUS_BAD_ARGS;
+		else if(!app.flash || !flash_log_find(get_u32(args), get_u32(args + 4), &range))
+			status = COMMAND_STATUS_FAILED;
+		else
+		{
+			put_u32(put_u32(put_u32(put_u32(put_u32(result, range.first_block), range.first_seq), range.blocks),
+					range.first_s), range.last_s);
+			result_len = COMMAND_LOG_RANGE_LEN;
+		}
+		break;
+
+	case COMMAND_DUMP:
+		app_get_stats(&app);
+		if(len != 8 || get_u32(args) >= MT25QL512_SIZE)
+			status = COMMAND_STATUS_BAD_ARGS;
+		// the dump frames would be mixed with the text lines
+		else if(!app.flash || tx_format != output_binary)
+			status = COMMAND_STATUS_FAILED;
+		else
+		{
+			flash_dump_start(get_u32(args), get_u32(args + 4));
+			flash_dump_get_stats(&dump);
+			put_u32(put_u32(result, get_u32(args)), dump.left);
+			result_len = COMMAND_DUMP_LEN;
+		}
+		break;
+
+	case COMMAND_SET_FORMAT:
+		if(len != 1 || (args[0] != output_text && args[0] != output_binary))
+			status = COMMAND_STATUS_BAD_ARGS;
+		else
+			tx_format = args[0];
+		break;
+
+	case COMMAND_GET_STATS:
+		if(len != 0)
+			status = COMMAND_STATUS_BAD_ARGS;
+		else
+			result_len = get_stats(result);
+		break;
+
+	case COMMAND_SYNC_TIME:
+		if(len != 8)
+			status = COMMAND_STATUS_BAD_ARGS;
+		else
+			timesync_now(get_u64(args));
+		break;
+
+	case COMMAND_SYNC_REPLY:
+		// a reply itself, not answered
+		if(len == 18)
+			timesync_receive(get_u16(args), get_u64(args + 2), get_u64(args + 10), ticks);
+		return;
+
+	case COMMAND_SET_TIME_ZONE:
+		if(len == 0 || len >= sizeof(rule))
+		{
+			status = COMMAND_STATUS_BAD_ARGS;
+			break;
+		}
+		memcpy(rule, args, len);
+		rule[len] = '\0';
+		if(!tz_set(rule))
+			status = COMMAND_STATUS_BAD_ARGS;
+		break;
+
+	case COMMAND_PROFILE:
+	case COMMAND_PROFILE_RESET:
+#if PROF_ENABLED
+		if(len != 0)
+			status = COMMAND_STATUS_BAD_ARGS;
+		else if(id == COMMAND_PROFILE)
+			profile = true;
+		else
+			prof_reset();
+#else
+		// Release build, no probes
+		status = COMMAND_STATUS_FAILED;
+#endif
+		break;
+
+	default:
+		status = COMMAND_STATUS_UNKNOWN;
+		break;
+	}
+
+	// responses are not batched with the samples
+	usb_stream_write(response, frame_encode_response(response, seq, timebase_us(timebase_ticks()), id, status, result, result_len));
+	if(profile)
+		app_send_profile();
+	usb_stream_flush();
+}
+//COMMAND_GET_STATS result, the layout of command.h
+static uint16_t get_stats(uint8_t* p)
+{
+	uint8_t* start = p;
+	app_stats app;
+	usb_stream_stats usb;
+	icm20948_spi_stats spi;
+	timebase_stats tb;
+	timesync_stats ts;
+
+	app_get_stats(&app);
+	usb_stream_get_stats(&usb);
+	icm20948_get_spi_stats(&spi);
+	timebase_get_stats(&tb);
+	timesync_get_stats(&ts);
+
+	*p++ = app.streaming;
+	*p++ = (uint8_t)tx_format;
+	p = put_u32(p, app.samples);
+	p = put_u32(p, sample_ring.dropped + app.spi_dropped);
+	p = put_u32(p, usb.frames);
+	p = put_u32(p, usb.dropped_frames);
+	p = put_u32(p, spi.errors);
+	p = put_u32(p, tb.seconds);
+	p = put_u32(p, tb.rejected);
+	p = put_u32(p, ts.rounds);
+	p = put_u32(p, (uint32_t)ts.offset_us);
+	p = put_u32(p, ts.delay_us);
+	p = put_u32(p, (uint32_t)ts.calib_ppb);
+	p = put_u32(p, ts.last_sync);
+	p = put_u32(p, stats.commands);
+	p = put_u32(p, stats.rejected);
+
+	return p - start;
+}
+//COMMAND_GET_CONFIG result of one sensor
+static uint8_t* put_config(uint8_t* p, const icm20948_sensor_config* config)
+{
+	p = put_u32(p, config->odr_mhz);
+	*p++ = config->full_scale;
+	return put_u32(p, config->bandwidth_mhz);
+}
+//COMMAND_GET_LOG_STATS result, the layout of command.h
+static uint16_t get_log_stats(uint8_t* p)
+{
+	uint8_t* start = p;
+	flash_log_stats log;
+
+	flash_log_get_stats(&log);
+	*p++ = log.running;
+	p = put_u32(p, log.records);
+	p = put_u32(p, log.dropped_records);
+	p = put_u32(p, log.pages);
+	p = put_u32(p, log.blocks);
+	p = put_u32(p, log.erases);
+	p = put_u32(p, log.errors);
+	p = put_u32(p, log.used_blocks);
+	p = put_u32(p, log.head_block);
+	*p++ = (uint8_t)log.staging_high_water;
+	*p++ = (uint8_t)(log.staging_high_water >> 8);
+	p = put_u32(p, log.committed);
+	p = put_u32(p, log.checkpoints);
+	*p++ = (uint8_t)log.torn_pages;
+	*p++ = (uint8_t)(log.torn_pages >> 8);
+	*p++ = (uint8_t)log.mount_reads;
+	*p++ = (uint8_t)(log.mount_reads >> 8);
+
+	return p - start;
+}
+static uint16_t get_u16(const uint8_t* p)
+{
+	return p[0] | p[1] << 8;
+}
+static uint32_t get_u32(const uint8_t* p)
+{
+	return get_u16(p) | (uint32_t)get_u16(p + 2) << 16;
+}
+static uint64_t get_u64(const uint8_t* p)
+{
+	return get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+static uint8_t* put_u32(uint8_t* p, uint32_t val)
+{
+	*p++ = (uint8_t)val;
+	*p++ = (uint8_t)(val >> 8);
+	*p++ = (uint8_t)(val >> 16);
+	*p++ = (uint8_t)(val >> 24);
+	return p;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file flash_dump.c
+ * @brief Bulk read back of the flash over the USB VCP, at the full-speed bulk rate
+ *
+ * Reading the log back one sample per line would take hours for the 64 MB of the MT25QL512,
+ * so the flash is sent as it is, in large frames:
+ * 1. The main loop takes a free bulk buffer of usb_stream.c and COBS encodes one FRAME_TYPE_DUMP frame
+ *    into it straight from the QUADSPI memory-mapped window, the data is read once and not copied.
+ * 2. The buffer is queued as one transfer; while it is sent the other buffer is filled, and the transfer
+ *    complete interrupt starts it at once, so the IN endpoint is busy back to back.
+ * 3. Every block ends with a FRAME_TYPE_DUMP_CRC frame, the PC resumes a cut dump from the last good block.
+ *
+ * The frames are described in frame.h, the dump in flash_dump.h.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "flash_dump.h"
+#include "frame.h"
+#include "usb_stream.h"
+#include <string.h>
+
+
+#if FRAME_DUMP_ENCODED_LEN(FLASH_DUMP_CHUNK) + FRAME_DUMP_CRC_ENCODED_LEN > USB_STREAM_BULK_LEN
+#error "a FLASH_DUMP_CHUNK frame and a block CRC must fit in one USB_STREAM_BULK_LEN buffer"
+#endif
+
+static uint32_t address;				// next byte to read
+static uint32_t left;					// bytes not read yet
+static uint32_t block_address;			// first byte of the block being sent
+static uint16_t block_crc;				// of its bytes read so far
+static uint16_t seq;
+static flash_dump_stats stats;
+
+
+static uint8_t* put_u32(uint8_t* p, uint32_t val);
+
+
+/**
+ * @brief No dump running
+ * @return None.
+ */
+void flash_dump_init(void)
+{
+	left = 0;
+	memset(&stats, 0, sizeof(stats));
+}
+/**
+ * @brief Start a dump of length bytes at address, replacing the one running
+ * The length is clamped to the end of the flash, 0 only stops the dump running.
+ * @return false if address is past the end of the flash.
+ */
+bool flash_dump_start(uint32_t start, uint32_t length)
+{
+	if(start >= MT25QL512_SIZE)
+		return false;
+	if(length > MT25QL512_SIZE - start)
+		length = MT25QL512_SIZE - start;
+
+	// the frames of the dump replaced are not sent any more
+	usb_stream_bulk_cancel();
+	address = start;
+	left = length;
+	block_address = start;
+	block_crc = 0xFFFF;
+	seq = 0;
+	stats.dumps++;
+
+	return true;
+}
+/**
+ * @brief Stop the dump running, the frames already in flight still arrive
+ * @return None.
+ */
+void flash_dump_stop(void)
+{
+	usb_stream_bulk_cancel();
+	left = 0;
+}
+/**
+ * @brief The next frame can be queued now: a bulk buffer is free and the flash readable
+ * Ends the wait of the main loop for the next sample.
+ * @return true if flash_dump_process() has something to do.
+ */
+bool flash_dump_pending(void)
+{
+	return left != 0 && usb_stream_bulk_buffer() != NULL && !mt25ql512_busy();
+}
+/**
+ * @brief Fill the free bulk buffers, one frame each, and the block CRC after the last frame of a block
+ * The dump is over once the USB is not configured, the PC resumes it after the next enumeration.
+ * @return None.
+ */
+void flash_dump_process(void)
+{
+	uint8_t payload[FRAME_DUMP_CRC_PAYLOAD];
+	const uint8_t* data;
+	uint8_t* buf;
+	uint32_t n;
+	uint16_t len;
+
+	if(left == 0)
+		return;
+
+	if(!usb_stream_connected())
+	{
+		flash_dump_stop();
+		stats.aborted++;
+		return;
+	}
+
+	while(left != 0 && (buf = usb_stream_bulk_buffer()) != NULL)
+	{
+		// the flash log is programming or erasing, its interrupt wakes the main loop up again
+		if(!(data = mt25ql512_mapped(address)))
+		{
+			stats.flash_waits++;
+			return;
+		}
+
+		// a frame does not cross a block
+		n = FLASH_DUMP_BLOCK_SIZE - address % FLASH_DUMP_BLOCK_SIZE;
+		if(n > FLASH_DUMP_CHUNK)
+			n = FLASH_DUMP_CHUNK;
+		if(n > left)
+			n = left;
+
+		len = frame_encode_dump(buf, seq++, address, data, n);
+		block_crc = crc16_ccitt(data, n, block_crc);
+		address += n;
+		left -= n;
+		stats.frames++;
+
+		if(left == 0 || address % FLASH_DUMP_BLOCK_SIZE == 0)
+		{
+			put_u32(put_u32(payload, block_address), address - block_address);
+			payload[8] = (uint8_t)block_crc;
+			payload[9] = (uint8_t)(block_crc >> 8);
+			put_u32(payload + 10, left);
+			len += frame_encode_message(buf + len, FRAME_TYPE_DUMP_CRC, 0, payload, sizeof(payload));
+			block_address = address;
+			block_crc = 0xFFFF;
+			stats.blocks++;
+		}
+
+		usb_stream_bulk_send(len);
+	}
+}
+/**
+ * @brief Copy the dump counters
+ * @return None.
+ */
+void flash_dump_get_stats(flash_dump_stats* stats_out)
+{
+	*stats_out = stats;
+	stats_out->address = address;
+	stats_out->left = left;
+}
+
+
+/* Static Functions */
+static uint8_t* put_u32(uint8_t* p, uint32_t val)
+{
+	*p++ = (uint8_t)val;
+	*p++ = (uint8_t)(val >> 8);
+	*p++ = (uint8_t)(val >> 16);
+	*p++ = (uint8_t)(val >> 24);
+	return p;
+}
@@ -0,0 +1,830 @@
+/**
+ * @file flash_log.c
+ * @brief Append-only sample log on the MT25QL512, the layout is described in flash_log.h
+ *
+ * 1. The main loop appends every sample to a page in RAM, a full page is staged in a RAM queue.
+ * 2. flash_log_process() hands the staged pages to the flash one by one in the background
+ *    (mt25ql512_program_async()), it never waits for the flash, so acquisition goes on while it programs.
+ * 3. The block after the one being written is erased ahead, one 4 KB subsector at a time between the page
+ *    programs, so the staged pages only wait for one subsector erase (50 ms typical) at most.
+ *    When little can be written before it is erased (an empty log, a mount near the end of the head block),
+ *    the block goes in one 64 KB erase (150 ms) instead.
+ * 4. Blocks are used round-robin: the oldest block is erased when the ring is full, every block wears the same.
+ * 5. Every block opened is recorded by a checkpoint in the checkpoint region, programmed before the pages,
+ *    with the time span of the block it closes.
+ * 6. The time span of the head block follows the pages programmed, in the time index.
+ *
+ * A page or an erase that fails is retried. A failed page is skipped and left behind with a bad CRC, unless it
+ * is still blank: it is then programmed again, the mount finds no erased page before the head. The same for
+ * the checkpoint slots.
+ * If the staging queue is full the records are dropped and counted.
+ *
+ * Mount, at init:
+ * 1. The newest checkpoint: the first slot of the 16 subsectors, then a binary search for the last slot used.
+ * 2. The blocks opened after it (power lost before the checkpoint) and the tail blocks erased after it are
+ *    followed through their headers, FLASH_LOG_RECOVERY_BLOCKS at most, otherwise every header is scanned.
+ * 3. A binary search for the first blank page of the head block, then back over the pages failing their CRC
+ *    (torn by the power loss): the record numbers go on after the last good page.
+ * 4. The block after the head is erased again, its erase may have been cut short.
+ * 5. The time index from the spans of all the checkpoints still in the ring, the pages of the blocks
+ *    without one.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "flash_log.h"
+#include "frame.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SUBSECTORS_PER_BLOCK			(FLASH_LOG_BLOCK_SIZE / MT25QL512_SUBSECTOR_SIZE)
+
+
+typedef enum
+{
+	op_none,
+	op_page,
+	op_header,
+	op_erase,
+	op_block_erase,
+	op_checkpoint,
+	op_checkpoint_erase
+} log_op;
+
+// pages waiting for the flash, main loop only
+static uint8_t staging[FLASH_LOG_STAGING_PAGES][FLASH_LOG_PAGE_SIZE];
+static uint32_t staging_head, staging_tail;
+
+// page being filled
+static uint8_t fill[FLASH_LOG_PAGE_SIZE];
+static uint8_t fill_count;
+static uint32_t fill_since;
+
+// block being written, FLASH_LOG_PAGES once it is full
+static uint32_t head_block;
+static uint16_t head_page;
+static uint32_t head_seq;
+static uint32_t tail_block;
+static uint32_t tail_seq;
+static uint32_t next_record;
+static uint32_t committed;
+
+// block after the head, erased ahead
+static uint32_t erase_block;
+static uint8_t erase_done;
+static uint32_t erase_count;
+static flash_log_block_header header;
+
+// checkpoint region: subsector being filled and its next free slot, FLASH_LOG_CHECKPOINT_SLOTS once it is full
+static uint8_t cp_subsector;
+static uint8_t cp_slot;
+static uint32_t cp_seq;
+static bool cp_due;
+static flash_log_checkpoint checkpoint;
+
+// time span of every block, valid from tail to head; SRAM2 holds nothing else (STM32L412RBTXP_FLASH.ld)
+static flash_log_span time_index[FLASH_LOG_BLOCKS] __attribute__((section(".sram2")));
+
+// operation in flight, completed by the QUADSPI interrupt
+static log_op op;
+static volatile bool op_done;
+static volatile bool op_ok;
+
+static bool mounted;
+static uint32_t flash_reads;
+static flash_log_stats stats;
+
+
+/* Static Functions */
+static void mount(void);
+static bool find_checkpoint(void);
+static bool recover(void);
+static void scan_blocks(void);
+static void find_head_page(void);
+static void load_index(void);
+static void read_span(uint32_t block, uint16_t end);
+static bool read_block_header(uint32_t block, flash_log_block_header* out);
+static bool read_checkpoint(uint8_t subsector, uint8_t slot, flash_log_checkpoint* out);
+static bool read_page(uint32_t block, uint16_t page, flash_log_page_header* out);
+static bool blank(uint32_t addr, uint16_t len);
+static uint32_t last_second(const uint8_t* page);
+static const uint8_t* mapped(uint32_t addr);
+static void stage_fill(void);
+static void start_op(void);
+static void finish_op(void);
+static void begin_erase(uint32_t block);
+static void op_callback(bool ok, void* ctx);
+static uint32_t block_addr(uint32_t block);
+static uint32_t checkpoint_addr(uint8_t subsector, uint8_t slot);
+static uint32_t next_block(uint32_t block);
+static uint32_t prev_block(uint32_t block);
+static uint32_t ring_block(uint32_t n);
+
+
+/* Main Functions */
+/**
+ * @brief Initialize the MT25QL512 log, after mt25ql512_init()
+ * The end of the log is found from the last checkpoint. Appending is on.
+ * @return false without a flash.
+ */
+bool flash_log_init(void)
+{
+	memset(&stats, 0, sizeof(stats));
+	staging_head = staging_tail = 0;
+	fill_count = 0;
+	op = op_none;
+	cp_due = false;
+	mounted = false;
+
+	if(!mt25ql512_mapped(FLASH_LOG_BASE))
+		return false;
+
+	mount();
+	mounted = true;
+	stats.running = true;
+	// the erase ahead starts now, before the first sample
+	start_op();
+	return true;
+}
+/**
+ * @brief Start or stop appending samples, the partly filled page is staged when it stops
+ * @return None.
+ */
+void flash_log_enable(bool on)
+{
+	if(!mounted)
+		return;
+
+	if(!on)
+		flash_log_flush();
+	stats.running = on;
+}
+/**
+ * @brief Append one sample to the page being filled, a full page goes to the staging queue
+ * Main loop only.
+ * @return false if the log is stopped or the staging queue was full.
+ */
+bool flash_log_append(uint64_t timestamp_us, const icm20948_raw_sample* sample)
+{
+	flash_log_page_header* page = (flash_log_page_header*)fill;
+	flash_log_record* record;
+
+	if(!mounted || !stats.running)
+		return false;
+
+	// a step of the time sync backwards, or a long pause: the record starts a new page
+	if(fill_count && (timestamp_us < page->timestamp_us || timestamp_us - page->timestamp_us > UINT32_MAX))
+		stage_fill();
+
+	if(fill_count == 0)
+	{
+		memset(fill, 0xFF, sizeof(fill));
+		page->timestamp_us = timestamp_us;
+		page->first_record = next_record;
+		page->reserved = 0;
+		fill_since = HAL_GetTick();
+	}
+
+	record = (flash_log_record*)(fill + FLASH_LOG_PAGE_HEADER_LEN) + fill_count;
+	record->offset_us = (uint32_t)(timestamp_us - page->timestamp_us);
+	memcpy(record->accel, &sample->accel, sizeof(record->accel));
+	memcpy(record->gyro, &sample->gyro, sizeof(record->gyro));
+	memcpy(record->mag, &sample->mag, sizeof(record->mag));
+	record->scale = sample->accel_fs << 4 | sample->gyro_fs;
+	record->flags = sample->flags;
+	fill_count++;
+	next_record++;
+	stats.records++;
+
+	if(fill_count == FLASH_LOG_RECORDS_PER_PAGE)
+		stage_fill();
+	return true;
+}
+/**
+ * @brief Program the staged pages, open the next block and erase ahead, one flash operation at a time
+ * Returns at once while an operation runs.
+ * @return None.
+ */
+void flash_log_process(void)
+{
+	if(!mounted)
+		return;
+
+	mt25ql512_poll();
+	if(op != op_none)
+	{
+		if(!op_done)
+			return;
+		finish_op();
+	}
+
+	if(fill_count && HAL_GetTick() - fill_since >= FLASH_LOG_FLUSH_MS)
+		stage_fill();
+
+	start_op();
+}
+/**
+ * @brief Stage the partly filled page now
+ * @return None.
+ */
+void flash_log_flush(void)
+{
+	if(fill_count)
+		stage_fill();
+}
+/**
+ * @brief true once every staged page is programmed and no operation runs
+ * The erase ahead may still have subsectors to go.
+ */
+bool flash_log_idle(void)
+{
+	return !mounted || (op == op_none && staging_head == staging_tail && fill_count == 0);
+}
+/**
+ * @brief Copy of the log counters
+ * @return None.
+ */
+void flash_log_get_stats(flash_log_stats* stats_out)
+{
+	*stats_out = stats;
+	stats_out->head_block = head_block;
+	stats_out->committed = committed;
+	stats_out->staged = staging_head - staging_tail;
+}
+/**
+ * @brief Blocks holding the records stamped from from_s to to_s, two binary searches of the time index
+ * Main loop only. Only the records programmed are found.
+ * @return false without a flash.
+ */
+bool flash_log_find(uint32_t from_s, uint32_t to_s, flash_log_range* range)
+{
+	uint32_t n = stats.used_blocks, lo = 0, hi, mid, first;
+
+	if(!mounted)
+		return false;
+
+	// the head block has no span before its first page
+	if(n && time_index[head_block].first_s == FLASH_LOG_NO_TIME)
+		n--;
+
+	// first block ending at from_s or later
+	hi = n;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(time_index[ring_block(mid)].last_s < from_s)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	first = lo;
+
+	// first block starting after to_s
+	hi = n;
+	while(lo < hi)
+	{
+		mid = lo + (hi - lo) / 2;
+		if(time_index[ring_block(mid)].first_s <= to_s)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	range->first_block = ring_block(first);
+	range->first_seq = tail_seq + first;
+	range->blocks = lo - first;
+	range->first_s = range->blocks ? time_index[ring_block(first)].first_s : 0;
+	range->last_s = range->blocks ? time_index[ring_block(lo - 1)].last_s : 0;
+	return true;
+}
+
+
+/* Static Functions */
+//End of the log: from the newest checkpoint, from all the block headers without one
+static void mount(void)
+{
+	uint32_t reads = flash_reads;
+
+	stats.torn_pages = 0;
+	stats.spans_rebuilt = 0;
+	if(!find_checkpoint() || !recover())
+	{
+		scan_blocks();
+		cp_due = stats.used_blocks != 0;
+	}
+
+	if(!stats.used_blocks)
+	{
+		// empty log, block 0 is erased and opened first
+		head_block = FLASH_LOG_BLOCKS - 1;
+		head_page = FLASH_LOG_PAGES;
+		head_seq = 0;
+		tail_block = 0;
+		next_record = 0;
+		committed = 0;
+		begin_erase(0);
+	}
+	else
+	{
+		find_head_page();
+		// an erase may have been cut short by the reset: the next block is erased again
+		begin_erase(next_block(head_block));
+		load_index();
+	}
+	stats.mount_reads = flash_reads - reads;
+}
+//Newest checkpoint into head and tail, false if there is none
+static bool find_checkpoint(void)
+{
+	flash_log_checkpoint cp;
+	bool found = false;
+	uint8_t s, newest = 0;
+	uint16_t lo = 1, hi = FLASH_LOG_CHECKPOINT_SLOTS, mid;
+
+	// the subsector filled last has the newest first slot
+	for(s = 0; s < FLASH_LOG_CHECKPOINT_SUBSECTORS; s++)
+	{
+		if(read_checkpoint(s, 0, &cp) && (!found || (int32_t)(cp.seq - cp_seq) > 0))
+		{
+			newest = s;
+			cp_seq = cp.seq;
+			found = true;
+		}
+	}
+	if(!found)
+	{
+		// the first checkpoint erases subsector 0
+		cp_subsector = FLASH_LOG_CHECKPOINT_SUBSECTORS - 1;
+		cp_slot = FLASH_LOG_CHECKPOINT_SLOTS;
+		cp_seq = 0;
+		return false;
+	}
+
+	// the slots are programmed in order: the first blank one is the next to use
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(blank(checkpoint_addr(newest, mid), FLASH_LOG_CHECKPOINT_SLOT_SIZE))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	cp_subsector = newest;
+	cp_slot = lo;
+
+	// the last one may be torn or a failed program, slot 0 is good
+	while(!read_checkpoint(newest, --lo, &cp));
+	cp_seq = cp.seq;
+	head_block = cp.head_block;
+	head_seq = cp.head_seq;
+	tail_block = cp.tail_block;
+	tail_seq = cp.tail_seq;
+	return head_block < FLASH_LOG_BLOCKS && tail_block < FLASH_LOG_BLOCKS;
+}
+//Blocks opened and blocks erased from the tail since the checkpoint, false past FLASH_LOG_RECOVERY_BLOCKS
+static bool recover(void)
+{
+	flash_log_block_header h;
+	uint8_t i;
+
+	if(!read_block_header(head_block, &h) || h.seq != head_seq)
+		return false;
+	next_record = h.first_record;
+
+	// opened, the power went before their checkpoint
+	for(i = 0; read_block_header(next_block(head_block), &h) && h.seq == head_seq + 1; i++)
+	{
+		if(i == FLASH_LOG_RECOVERY_BLOCKS)
+			return false;
+		head_block = next_block(head_block);
+		head_seq = h.seq;
+		next_record = h.first_record;
+		cp_due = true;
+	}
+
+	// erased ahead, or being erased
+	for(i = 0; !read_block_header(tail_block, &h) || h.seq != tail_seq; i++)
+	{
+		if(i == FLASH_LOG_RECOVERY_BLOCKS || tail_block == head_block)
+			return false;
+		tail_block = next_block(tail_block);
+		tail_seq++;
+		cp_due = true;
+	}
+
+	stats.used_blocks = head_seq - tail_seq + 1;
+	return true;
+}
+//Newest and oldest block from every block header
+static void scan_blocks(void)
+{
+	flash_log_block_header h;
+	bool found = false;
+	uint32_t b;
+
+	stats.used_blocks = 0;
+	for(b = 0; b < FLASH_LOG_BLOCKS; b++)
+	{
+		if(!read_block_header(b, &h))
+			continue;
+		stats.used_blocks++;
+		if(!found || (int32_t)(h.seq - head_seq) > 0)
+		{
+			head_block = b;
+			head_seq = h.seq;
+			next_record = h.first_record;
+		}
+		if(!found || (int32_t)(h.seq - tail_seq) < 0)
+		{
+			tail_block = b;
+			tail_seq = h.seq;
+		}
+		found = true;
+	}
+}
+//First free page of the head block and the record number after its last good page
+static void find_head_page(void)
+{
+	flash_log_page_header page;
+	uint16_t lo = 1, hi = FLASH_LOG_PAGES, mid;
+
+	// the pages are programmed in order: the first blank one is the next to use, all 256 bytes of it
+	while(lo < hi)
+	{
+		mid = (lo + hi) / 2;
+		if(blank(block_addr(head_block) + mid * FLASH_LOG_PAGE_SIZE, FLASH_LOG_PAGE_SIZE))
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	head_page = lo;
+
+	// the last pages may be torn, their records were never committed
+	while(--lo >= 1)
+	{
+		if(read_page(head_block, lo, &page))
+		{
+			next_record = page.first_record + page.count;
+			break;
+		}
+		stats.torn_pages++;
+	}
+	committed = next_record;
+}
+//Span of every block from tail to head: from the checkpoints, from the pages where none has it
+static void load_index(void)
+{
+	flash_log_checkpoint cp;
+	const uint8_t* p;
+	uint32_t seq, n;
+	uint8_t s, slot;
+
+	for(n = 0; n < stats.used_blocks; n++)
+		time_index[ring_block(n)].first_s = time_index[ring_block(n)].last_s = FLASH_LOG_NO_TIME;
+
+	// a checkpoint has the span of the block before its head: the ones of blocks still in the ring
+	for(s = 0; s < FLASH_LOG_CHECKPOINT_SUBSECTORS; s++)
+	{
+		for(slot = 0; slot < FLASH_LOG_CHECKPOINT_SLOTS; slot++)
+		{
+			p = mapped(checkpoint_addr(s, slot));
+			if(!p)
+				return;
+			memcpy(&cp, p, sizeof(cp));
+			seq = cp.head_seq - 1;
+			if(cp.magic != FLASH_LOG_CHECKPOINT_MAGIC || seq - tail_seq >= head_seq - tail_seq ||
+					cp.head_block >= FLASH_LOG_BLOCKS || prev_block(cp.head_block) != ring_block(seq - tail_seq) ||
+					!read_checkpoint(s, slot, &cp))
+				continue;
+			time_index[prev_block(cp.head_block)].first_s = cp.first_s;
+			time_index[prev_block(cp.head_block)].last_s = cp.last_s;
+		}
+	}
+
+	// the head block, and the blocks whose checkpoint was lost
+	read_span(head_block, head_page);
+	for(n = 0; n + 1 < stats.used_blocks; n++)
+	{
+		if(time_index[ring_block(n)].first_s != FLASH_LOG_NO_TIME)
+			continue;
+		read_span(ring_block(n), FLASH_LOG_PAGES);
+		stats.spans_rebuilt++;
+	}
+}
+//Span of a block from its first and its last good page before page end
+static void read_span(uint32_t block, uint16_t end)
+{
+	flash_log_page_header page;
+	uint16_t p;
+
+	time_index[block].first_s = time_index[block].last_s = FLASH_LOG_NO_TIME;
+	for(p = 1; p < end && !read_page(block, p, &page); p++);
+	if(p == end)
+		return;
+	time_index[block].first_s = page.timestamp_us / 1000000;
+
+	// back over the blank pages and the ones failing their CRC
+	while(!read_page(block, --end, &page));
+	time_index[block].last_s = last_second(mapped(block_addr(block) + end * FLASH_LOG_PAGE_SIZE));
+}
+//Block header at the start of a block, false if it is blank or its CRC does not match
+static bool read_block_header(uint32_t block, flash_log_block_header* out)
+{
+	const uint8_t* p = mapped(block_addr(block));
+
+	if(!p)
+		return false;
+	memcpy(out, p, sizeof(*out));
+	return out->magic == FLASH_LOG_MAGIC && out->version == FLASH_LOG_VERSION &&
+			out->crc == crc16_ccitt((const uint8_t*)out, offsetof(flash_log_block_header, crc), 0xFFFF);
+}
+//Checkpoint in a slot, false if it is blank or its CRC does not match
+static bool read_checkpoint(uint8_t subsector, uint8_t slot, flash_log_checkpoint* out)
+{
+	const uint8_t* p = mapped(checkpoint_addr(subsector, slot));
+
+	if(!p)
+		return false;
+	memcpy(out, p, sizeof(*out));
+	return out->magic == FLASH_LOG_CHECKPOINT_MAGIC && out->version == FLASH_LOG_VERSION &&
+			out->crc == crc16_ccitt((const uint8_t*)out, offsetof(flash_log_checkpoint, crc), 0xFFFF);
+}
+//Header of a data page, false if the CRC over it and its records does not match
+static bool read_page(uint32_t block, uint16_t page, flash_log_page_header* out)
+{
+	const uint8_t* p = mapped(block_addr(block) + page * FLASH_LOG_PAGE_SIZE);
+	uint16_t crc;
+
+	if(!p)
+		return false;
+	memcpy(out, p, sizeof(*out));
+	if(out->count > FLASH_LOG_RECORDS_PER_PAGE)
+		return false;
+	crc = crc16_ccitt(p, offsetof(flash_log_page_header, crc), 0xFFFF);
+	return out->crc == crc16_ccitt(p + FLASH_LOG_PAGE_HEADER_LEN, out->count * FLASH_LOG_RECORD_LEN, crc);
+}
+//All bytes erased
+static bool blank(uint32_t addr, uint16_t len)
+{
+	const uint8_t* p = mapped(addr);
+
+	while(p && len && *p == 0xFF)
+	{
+		p++;
+		len--;
+	}
+	return p && !len;
+}
+//Second of the last record of a good page
+static uint32_t last_second(const uint8_t* page)
+{
+	const flash_log_page_header* h = (const flash_log_page_header*)page;
+	const flash_log_record* r = (const flash_log_record*)(page + FLASH_LOG_PAGE_HEADER_LEN);
+
+	return (h->timestamp_us + (h->count ? r[h->count - 1].offset_us : 0)) / 1000000;
+}
+//Memory-mapped read, counted for the mount statistics
+static const uint8_t* mapped(uint32_t addr)
+{
+	flash_reads++;
+	return mt25ql512_mapped(addr);
+}
+//Close the page being filled: its CRC, then into the staging queue, dropped if the queue is full
+static void stage_fill(void)
+{
+	flash_log_page_header* page = (flash_log_page_header*)fill;
+	uint16_t crc;
+
+	page->count = fill_count;
+	crc = crc16_ccitt(fill, offsetof(flash_log_page_header, crc), 0xFFFF);
+	page->crc = crc16_ccitt(fill + FLASH_LOG_PAGE_HEADER_LEN, fill_count * FLASH_LOG_RECORD_LEN, crc);
+
+	if(staging_head - staging_tail < FLASH_LOG_STAGING_PAGES)
+	{
+		memcpy(staging[staging_head % FLASH_LOG_STAGING_PAGES], fill, FLASH_LOG_PAGE_HEADER_LEN +
+				fill_count * FLASH_LOG_RECORD_LEN);
+		staging_head++;
+		if(staging_head - staging_tail > stats.staging_high_water)
+			stats.staging_high_water = staging_head - staging_tail;
+	}
+	else
+		stats.dropped_records += fill_count;
+
+	fill_count = 0;
+}
+//Next flash operation: the checkpoint first, then staged pages, then opening the erased block, then the erase ahead
+static void start_op(void)
+{
+	const flash_log_page_header* page;
+	uint32_t addr;
+	bool started = false;
+
+	op_done = false;
+	if(cp_due && cp_slot == FLASH_LOG_CHECKPOINT_SLOTS)
+	{
+		// the next subsector is erased first, the newest checkpoint stays where it is until then
+		op = op_checkpoint_erase;
+		started = mt25ql512_erase_async(checkpoint_addr((cp_subsector + 1) % FLASH_LOG_CHECKPOINT_SUBSECTORS, 0),
+				MT25QL512_SUBSECTOR_SIZE, op_callback, NULL);
+	}
+	else if(cp_due)
+	{
+		checkpoint.magic = FLASH_LOG_CHECKPOINT_MAGIC;
+		checkpoint.seq = cp_seq + 1;
+		checkpoint.head_seq = head_seq;
+		checkpoint.tail_seq = tail_seq;
+		checkpoint.first_s = stats.used_blocks > 1 ? time_index[prev_block(head_block)].first_s : FLASH_LOG_NO_TIME;
+		checkpoint.last_s = stats.used_blocks > 1 ? time_index[prev_block(head_block)].last_s : FLASH_LOG_NO_TIME;
+		checkpoint.head_block = head_block;
+		checkpoint.tail_block = tail_block;
+		checkpoint.version = FLASH_LOG_VERSION;
+		checkpoint.reserved = 0;
+		checkpoint.crc = crc16_ccitt((const uint8_t*)&checkpoint, offsetof(flash_log_checkpoint, crc), 0xFFFF);
+		op = op_checkpoint;
+		started = mt25ql512_program_async(checkpoint_addr(cp_subsector, cp_slot), (const uint8_t*)&checkpoint,
+				sizeof(checkpoint), op_callback, NULL);
+	}
+	else if(head_page < FLASH_LOG_PAGES && staging_head != staging_tail)
+	{
+		page = (const flash_log_page_header*)staging[staging_tail % FLASH_LOG_STAGING_PAGES];
+		addr = block_addr(head_block) + head_page * FLASH_LOG_PAGE_SIZE;
+		op = op_page;
+		started = mt25ql512_program_async(addr, (const uint8_t*)page,
+				FLASH_LOG_PAGE_HEADER_LEN + page->count * FLASH_LOG_RECORD_LEN, op_callback, NULL);
+	}
+	else if(head_page == FLASH_LOG_PAGES && erase_done == SUBSECTORS_PER_BLOCK)
+	{
+		header.magic = FLASH_LOG_MAGIC;
+		header.seq = head_seq + 1;
+		header.erase_count = erase_count;
+		header.first_record = staging_head != staging_tail ?
+				((const flash_log_page_header*)staging[staging_tail % FLASH_LOG_STAGING_PAGES])->first_record :
+				next_record - fill_count;
+		header.version = FLASH_LOG_VERSION;
+		header.reserved = 0;
+		header.crc = crc16_ccitt((const uint8_t*)&header, offsetof(flash_log_block_header, crc), 0xFFFF);
+		op = op_header;
+		started = mt25ql512_program_async(block_addr(erase_block), (const uint8_t*)&header, sizeof(header),
+				op_callback, NULL);
+	}
+	else if(erase_done < SUBSECTORS_PER_BLOCK)
+	{
+		// the first subsector holds the header, the block leaves the log with it
+		if(erase_done == 0 && stats.used_blocks && erase_block == tail_block)
+		{
+			tail_block = next_block(tail_block);
+			tail_seq++;
+			stats.used_blocks--;
+		}
+		// the 16 subsector erases would not be over before the head block is full
+		if(erase_done == 0 && head_page > FLASH_LOG_PAGES / 2)
+		{
+			op = op_block_erase;
+			started = mt25ql512_erase_async(block_addr(erase_block), FLASH_LOG_BLOCK_SIZE, op_callback, NULL);
+		}
+		else
+		{
+			op = op_erase;
+			started = mt25ql512_erase_async(block_addr(erase_block) + erase_done * MT25QL512_SUBSECTOR_SIZE,
+					MT25QL512_SUBSECTOR_SIZE, op_callback, NULL);
+		}
+	}
+	else
+		return;
+
+	// refused, e.g. the write enable latch did not set: tried again on the next pass
+	if(!started)
+	{
+		op = op_none;
+		stats.errors++;
+	}
+}
+//Result of the operation in flight
+static void finish_op(void)
+{
+	log_op done = op;
+	const flash_log_page_header* page;
+
+	op = op_none;
+	switch(done)
+	{
+	case op_page:
+		// a failed page with anything programmed is skipped, the staged page goes to the next one;
+		// one left erased (DMA error, aborted) is programmed again: the mount looks for the first blank page
+		if(op_ok || !blank(block_addr(head_block) + head_page * FLASH_LOG_PAGE_SIZE, FLASH_LOG_PAGE_SIZE))
+			head_page++;
+		if(op_ok)
+		{
+			page = (const flash_log_page_header*)staging[staging_tail % FLASH_LOG_STAGING_PAGES];
+			committed = page->first_record + page->count;
+			if(time_index[head_block].first_s == FLASH_LOG_NO_TIME)
+				time_index[head_block].first_s = page->timestamp_us / 1000000;
+			time_index[head_block].last_s = last_second((const uint8_t*)page);
+			staging_tail++;
+			stats.pages++;
+		}
+		else
+			stats.errors++;
+		break;
+
+	case op_header:
+		if(!op_ok)
+		{
+			// the block is erased again
+			stats.errors++;
+			erase_done = 0;
+			break;
+		}
+		if(!stats.used_blocks)
+		{
+			tail_block = erase_block;
+			tail_seq = header.seq;
+		}
+		head_block = erase_block;
+		head_seq = header.seq;
+		head_page = 1;
+		time_index[head_block].first_s = time_index[head_block].last_s = FLASH_LOG_NO_TIME;
+		stats.blocks++;
+		stats.used_blocks++;
+		cp_due = true;
+		begin_erase(next_block(head_block));
+		break;
+
+	case op_erase:
+	case op_block_erase:
+		if(op_ok)
+		{
+			erase_done = done == op_block_erase ? SUBSECTORS_PER_BLOCK : erase_done + 1;
+			stats.erases++;
+		}
+		else
+			stats.errors++;
+		break;
+
+	case op_checkpoint_erase:
+		if(op_ok)
+		{
+			cp_subsector = (cp_subsector + 1) % FLASH_LOG_CHECKPOINT_SUBSECTORS;
+			cp_slot = 0;
+			stats.erases++;
+		}
+		else
+			stats.errors++;
+		break;
+
+	case op_checkpoint:
+		// a failed slot is skipped, one left erased is programmed again, as for the pages
+		if(op_ok || !blank(checkpoint_addr(cp_subsector, cp_slot), FLASH_LOG_CHECKPOINT_SLOT_SIZE))
+			cp_slot++;
+		if(op_ok)
+		{
+			cp_seq = checkpoint.seq;
+			cp_due = false;
+			stats.checkpoints++;
+		}
+		else
+			stats.errors++;
+		break;
+
+	default:
+		break;
+	}
+}
+//Erase ahead: the erase count of the block's header is carried over to the new one
+static void begin_erase(uint32_t block)
+{
+	flash_log_block_header h;
+
+	erase_block = block;
+	erase_done = 0;
+	erase_count = read_block_header(block, &h) ? h.erase_count + 1 : 1;
+}
+//Flash operation done, QUADSPI interrupt
+static void op_callback(bool ok, void* ctx)
+{
+	op_ok = ok;
+	op_done = true;
+}
+static uint32_t block_addr(uint32_t block)
+{
+	return FLASH_LOG_BASE + block * FLASH_LOG_BLOCK_SIZE;
+}
+static uint32_t checkpoint_addr(uint8_t subsector, uint8_t slot)
+{
+	return FLASH_LOG_CHECKPOINT_BASE + subsector * MT25QL512_SUBSECTOR_SIZE + slot * FLASH_LOG_CHECKPOINT_SLOT_SIZE;
+}
+static uint32_t next_block(uint32_t block)
+{
+	return block + 1 < FLASH_LOG_BLOCKS ? block + 1 : 0;
+}
+static uint32_t prev_block(uint32_t block)
+{
+	return block ? block - 1 : FLASH_LOG_BLOCKS - 1;
+}
+//n-th block of the ring from the tail
+static uint32_t ring_block(uint32_t n)
+{
+	return (tail_block + n) % FLASH_LOG_BLOCKS;
+}
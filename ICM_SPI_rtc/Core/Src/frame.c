@@ -0,0 +1,406 @@
+/**
+ * @file frame.c
+ * @brief Sample framing for the USB VCP
+ *
+ * Two output formats are available:
+ * 1. Text: the original '&' separated ASCII line, with the sensor data converted to g, dps and uT.
+ * 2. Binary: a versioned record with a sequence number, a microsecond timestamp, a field mask,
+ *    the raw int16 sensor data and a CRC-16, COBS encoded and terminated by 0x00.
+ *    A binary sample is 30 to 40 bytes instead of ~250 bytes of text, and needs no float formatting.
+ *
+ * The frame layout is described in frame.h, the host side reference decoder is python/frame_decoder.py.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "frame.h"
+#include <stdio.h>
+#include <string.h>
+
+
+// CRC-16/CCITT-FALSE of every byte value, one lookup per byte instead of 8 shifts: the flash dump checks every byte twice
+static const uint16_t crc16_table[256] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+	0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
+	0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
+	0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
+	0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
+	0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
+	0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
+	0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
+	0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
+	0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
+	0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
+	0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
+	0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
+	0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
+	0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
+	0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
+	0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
+	0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
+	0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
+	0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
+	0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+	0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
+	0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
+	0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
+	0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
+	0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
+	0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
+	0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
+	0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
+	0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
+	0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0
+};
+
+// cobs_encode() over several pieces of a frame
+typedef struct
+{
+	uint8_t* start;
+	uint8_t* code_p;				// where the code of the current block goes
+	uint8_t* p;
+	uint8_t code;
+} cobs_state;
+
+static uint8_t* put_u16(uint8_t* p, uint16_t val);
+static uint8_t* put_u32(uint8_t* p, uint32_t val);
+static uint8_t* put_u32(uint8_t* p, uint32_t val)
+{
+	p = put_u16(p, (uint16_t)val);
+	p = put_u16(p, (uint16_t)(val >> 16));
+	return p;
+}
+
+static uint8_t* put_header(uint8_t* p, uint8_t type, uint16_t seq, uint16_t mask, uint64_t timestamp_us);
+static uint8_t* put_axises(uint8_t* p, const raw_axises* val);
+static uint16_t finish_frame(uint8_t* frame, uint8_t* p, uint8_t* out);
+static void cobs_begin(cobs_state* cobs, uint8_t* out);
+static void cobs_add(cobs_state* cobs, const uint8_t* in, uint16_t len);
+static uint16_t cobs_end(cobs_state* cobs);
+
+
+/**
+ * @brief Encode one raw sample into a binary frame
+ * The magnetometer field is only included when the sample carries a new ak09916 measurement.
+ * @return number of bytes written to out, including the 0x00 delimiter.
+ */
+uint16_t frame_encode_sample(uint8_t* out, uint16_t seq, uint64_t timestamp_us, const icm20948_raw_sample* sample)
+{
+	uint8_t frame[FRAME_MAX_LEN];
+	uint8_t* p = frame;
+	uint16_t mask = FRAME_FIELD_ACCEL | FRAME_FIELD_GYRO | FRAME_FIELD_TEMP | FRAME_FIELD_SCALE;
+
+	if(sample->flags & ICM20948_SAMPLE_MAG_NEW)
+		mask |= FRAME_FIELD_MAG;
+
+	p = put_header(p, FRAME_TYPE_SAMPLE, seq, mask, timestamp_us);
+
+	// payload, in field mask bit order
+	p = put_axises(p, &sample->accel);
+	p = put_axises(p, &sample->gyro);
+	if(mask & FRAME_FIELD_MAG)
+		p = put_axises(p, &sample->mag);
+	p = put_u16(p, (uint16_t)sample->temperature);
+	*p++ = (uint8_t)(sample->accel_fs << 4 | (sample->gyro_fs & 0x0F));
+
+	return finish_frame(frame, p, out);
+}
+
+/**
+ * @brief Encode a diagnostic text message or log records into a binary frame, so that they can share the stream with the samples
+ * Longer payloads are cut at FRAME_MAX_TEXT bytes.
+ * @return number of bytes written to out, including the 0x00 delimiter.
+ */
+uint16_t frame_encode_message(uint8_t* out, uint8_t type, uint64_t timestamp_us, const void* payload, uint16_t len)
+{
+	uint8_t frame[FRAME_HEADER_LEN + FRAME_MAX_TEXT + FRAME_CRC_LEN];
+	uint8_t* p = frame;
+
+	if(len > FRAME_MAX_TEXT)
+		len = FRAME_MAX_TEXT;
+
+	p = put_header(p, type, 0, 0, timestamp_us);
+	memcpy(p, payload, len);
+	p += len;
+
+	return finish_frame(frame, p, out);
+}
+
+/**
+ * @brief Encode a time sync request, t1 is the device time it is sent at
+ * The payload reports the last round, so that the host can follow the synchronisation.
+ * @return number of bytes written to out, including the 0x00 delimiter.
+ */
+uint16_t frame_encode_sync(uint8_t* out, uint16_t seq, uint64_t t1_us, int32_t offset_us, uint32_t delay_us, int32_t calib_ppb)
+{
+	uint8_t frame[FRAME_HEADER_LEN + FRAME_SYNC_PAYLOAD + FRAME_CRC_LEN];
+	uint8_t* p = frame;
+
+	p = put_header(p, FRAME_TYPE_SYNC, seq, 0, t1_us);
+	p = put_u32(p, (uint32_t)offset_us);
+	p = put_u32(p, delay_us);
+	p = put_u32(p, (uint32_t)calib_ppb);
+
+	return finish_frame(frame, p, out);
+}
+
+/**
+ * @brief Encode the response to a command, seq is the sequence number of the command
+ * Longer results are cut at FRAME_MAX_TEXT - 2 bytes.
+ * @return number of bytes written to out, including the 0x00 delimiter.
+ */
+uint16_t frame_encode_response(uint8_t* out, uint16_t seq, uint64_t timestamp_us, uint8_t command, uint8_t status,
+		const uint8_t* result, uint16_t len)
+{
+	uint8_t frame[FRAME_HEADER_LEN + FRAME_MAX_TEXT + FRAME_CRC_LEN];
+	uint8_t* p = frame;
+
+	if(len > FRAME_MAX_TEXT - 2)
+		len = FRAME_MAX_TEXT - 2;
+
+	p = put_header(p, FRAME_TYPE_RESPONSE, seq, 0, timestamp_us);
+	*p++ = command;
+	*p++ = status;
+	memcpy(p, result, len);
+	p += len;
+
+	return finish_frame(frame, p, out);
+}
+
+/**
+ * @brief Encode len bytes of the flash at address, data is usually the memory-mapped window
+ * The frame is COBS encoded piece by piece, the data is not copied into a frame first.
+ * @return number of bytes written to out, including the 0x00 delimiter.
+ */
+uint16_t frame_encode_dump(uint8_t* out, uint16_t seq, uint32_t address, const uint8_t* data, uint16_t len)
+{
+	uint8_t header[FRAME_HEADER_LEN + FRAME_DUMP_HEADER_LEN];
+	uint8_t crc[FRAME_CRC_LEN];
+	cobs_state cobs;
+
+	put_u32(put_header(header, FRAME_TYPE_DUMP, seq, 0, 0), address);
+	put_u16(crc, crc16_ccitt(data, len, crc16_ccitt(header, sizeof(header), 0xFFFF)));
+
+	cobs_begin(&cobs, out);
+	cobs_add(&cobs, header, sizeof(header));
+	cobs_add(&cobs, data, len);
+	cobs_add(&cobs, crc, sizeof(crc));
+	len = cobs_end(&cobs);
+	out[len++] = 0x00;
+
+	return len;
+}
+
+/**
+ * @brief Decode and check one received frame, in is the COBS encoded frame without the 0x00 delimiter
+ * out must hold len bytes.
+ * @return length of the header and the payload, 0 if the frame is not valid.
+ */
+uint16_t frame_decode(const uint8_t* in, uint16_t len, uint8_t* out)
+{
+	uint16_t n = cobs_decode(in, len, out);
+
+	if(n < FRAME_HEADER_LEN + FRAME_CRC_LEN || out[0] != FRAME_VERSION)
+		return 0;
+	n -= FRAME_CRC_LEN;
+	if(crc16_ccitt(out, n, 0xFFFF) != (out[n] | out[n + 1] << 8))
+		return 0;
+
+	return n;
+}
+
+/**
+ * @brief Format one sample as the original text line
+ * Creating a formatted string from the combined time and sensor data,
+ * special characters are inserted to enable future data splitting.
+ * @return string length.
+ */
+uint16_t frame_encode_text(char* out, uint16_t size, const time_data* time_info, const icm20948_raw_sample* sample)
+{
+	icm_20948_data units;
+	int len;
+
+	icm20948_raw_to_data(sample, &units);
+
+	len = snprintf(out, size,
+			  "#%lu&" //unix timestamp
+			  "%04d-%02d-%02d %02d:%02d:%02d&" // utc_timestamp
+			  "%04d-%02d-%02d %02d:%02d:%02d&" //
+			  "%02lu:%02lu&"//
+			  "x_accel = %f/y_accel = %f/z_accel = %f&"
+			  "x_gyro = %f/y_gyro = %f/z_gyro =  %f&"
+			  "x_mag = %f/y_mag = %f/z_mag = %f&\r\n",
+			  (unsigned long)time_info->unix_timestamp,
+
+			  time_info->utc_time.year,
+			  time_info->utc_time.month,
+			  time_info->utc_time.date,
+			  time_info->utc_time.hour,
+			  time_info->utc_time.min,
+			  time_info->utc_time.sec,
+
+			  time_info->local_time.year,
+			  time_info->local_time.month,
+			  time_info->local_time.date,
+			  time_info->local_time.hour,
+			  time_info->local_time.min,
+			  time_info->local_time.sec,
+
+			  (unsigned long)time_info->elapsed_minutes,
+			  (unsigned long)time_info->elapsed_seconds,
+
+			  units.x_accel,
+			  units.y_accel,
+			  units.z_accel,
+
+			  units.x_gyro,
+			  units.y_gyro,
+			  units.z_gyro,
+
+			  units.x_magnet,
+			  units.y_magnet,
+			  units.z_magnet
+	);
+
+	if(len < 0)
+		return 0;
+	return len < size ? len : size - 1;
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE, polynomial 0x1021, start with crc = 0xFFFF
+ * @return crc.
+ */
+uint16_t crc16_ccitt(const uint8_t* data, uint16_t len, uint16_t crc)
+{
+	while(len--)
+		crc = crc << 8 ^ crc16_table[(crc >> 8 ^ *data++) & 0xFF];
+
+	return crc;
+}
+
+/**
+ * @brief Consistent Overhead Byte Stuffing, removes every 0x00 from the data
+ * out must hold len + len / 254 + 1 bytes.
+ * @return encoded length, without delimiter.
+ */
+uint16_t cobs_encode(const uint8_t* in, uint16_t len, uint8_t* out)
+{
+	cobs_state cobs;
+
+	cobs_begin(&cobs, out);
+	cobs_add(&cobs, in, len);
+	return cobs_end(&cobs);
+}
+
+/**
+ * @brief Reverse of cobs_encode(), in must not contain the 0x00 delimiter
+ * @return decoded length, 0 if the input is malformed.
+ */
+uint16_t cobs_decode(const uint8_t* in, uint16_t len, uint8_t* out)
+{
+	const uint8_t* end = in + len;
+	uint8_t* p = out;
+	uint8_t code, i;
+
+	while(in < end)
+	{
+		code = *in++;
+		if(code == 0 || in + code - 1 > end)
+			return 0;
+		for(i = 1; i < code; i++)
+			*p++ = *in++;
+		if(code != 0xFF && in < end)
+			*p++ = 0x00;
+	}
+
+	return p - out;
+}
+
+
+/* Static Functions */
+static uint8_t* put_u16(uint8_t* p, uint16_t val)
+{
+	*p++ = (uint8_t)val;
+	*p++ = (uint8_t)(val >> 8);
+	return p;
+}
+
+static uint8_t* put_header(uint8_t* p, uint8_t type, uint16_t seq, uint16_t mask, uint64_t timestamp_us)
+{
+	int i;
+
+	*p++ = FRAME_VERSION;
+	*p++ = type;
+	p = put_u16(p, seq);
+	p = put_u16(p, mask);
+	for(i = 0; i < 8; i++)
+		*p++ = (uint8_t)(timestamp_us >> (8 * i));
+	return p;
+}
+
+static uint8_t* put_axises(uint8_t* p, const raw_axises* val)
+{
+	p = put_u16(p, (uint16_t)val->x);
+	p = put_u16(p, (uint16_t)val->y);
+	p = put_u16(p, (uint16_t)val->z);
+	return p;
+}
+
+//append the CRC, COBS encode into out and terminate with 0x00
+static uint16_t finish_frame(uint8_t* frame, uint8_t* p, uint8_t* out)
+{
+	uint16_t len;
+
+	p = put_u16(p, crc16_ccitt(frame, p - frame, 0xFFFF));
+
+	len = cobs_encode(frame, p - frame, out);
+	out[len++] = 0x00;
+
+	return len;
+}
+
+static void cobs_begin(cobs_state* cobs, uint8_t* out)
+{
+	cobs->start = out;
+	cobs->code_p = out;
+	cobs->p = out + 1;
+	cobs->code = 1;
+}
+
+//same blocks as if the pieces were one buffer
+static void cobs_add(cobs_state* cobs, const uint8_t* in, uint16_t len)
+{
+	uint8_t* code_p = cobs->code_p;
+	uint8_t* p = cobs->p;
+	uint8_t code = cobs->code;
+
+	while(len--)
+	{
+		if(*in)
+		{
+			*p++ = *in;
+			code++;
+		}
+		if(!*in++ || code == 0xFF)
+		{
+			*code_p = code;
+			code = 1;
+			code_p = p++;
+		}
+	}
+
+	cobs->code_p = code_p;
+	cobs->p = p;
+	cobs->code = code;
+}
+
+//encoded length, without delimiter
+static uint16_t cobs_end(cobs_state* cobs)
+{
+	*cobs->code_p = cobs->code;
+	return cobs->p - cobs->start;
+}
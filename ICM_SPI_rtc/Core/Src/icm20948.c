@@ -29,11 +29,70 @@
 
 
 #include "icm20948.h"
+#include "log.h"
+#include <string.h>
 
 
 static float gyro_scale_factor;
 static float accel_scale_factor;
 
+// full-scale selection of the samples read from now on, carried by every raw sample
+// changed by the DMA interrupt at the end of the register write, between the last burst read with the old
+// range and the first one with the new range
+static volatile uint8_t gyro_fs = _250dps;
+static volatile uint8_t accel_fs = _2g;
+
+// LSB per unit for each full-scale selection, page 11 and 12
+static const float gyro_lsb_per_dps[4] = { 131.0f, 65.5f, 32.8f, 16.4f };
+static const int16_t accel_lsb_per_g[4] = { 16384, 8192, 4096, 2048 };
+
+// digital LPF 3 dB bandwidth for each DLPFCFG, mHz, GYRO_CONFIG_1 and ACCEL_CONFIG tables
+static const uint32_t gyro_dlpf_bandwidth_mhz[8] = { 196600, 151800, 119500, 51200, 23900, 11600, 5700, 361400 };
+static const uint32_t accel_dlpf_bandwidth_mhz[8] = { 246000, 246000, 111400, 50400, 23900, 11500, 5700, 473000 };
+
+// configuration as written, the power on values until then
+static icm20948_sensor_config gyro_config = { ICM20948_ODR_BASE_MHZ, _250dps, 196600 };
+static icm20948_sensor_config accel_config = { ICM20948_ODR_BASE_MHZ, _2g, 246000 };
+
+// last valid magnetometer reading, held between ak09916 measurements
+static raw_axises last_mag;
+
+// FIFO records drained in one burst
+static uint8_t fifo_buf[ICM20948_FIFO_MAX_RECORDS * ICM20948_BURST_LEN];
+
+// SPI1 DMA transport: queue of pending transactions, each one is a bank select followed by the register access
+typedef struct
+{
+	userbank ub;
+	uint8_t reg;				// READ / WRITE | register address
+	uint8_t* buf;				// read: destination, write: source
+	uint16_t len;
+	icm20948_xfer_cb cb;
+	void* ctx;
+} spi_xfer;
+
+// spi_xfer_blocking() completion, set by the DMA interrupt
+typedef struct
+{
+	volatile bool done;
+	volatile uint8_t* fs;		// set to full_scale if the transfer succeeded, NULL: nothing
+	uint8_t full_scale;
+} spi_xfer_wait;
+
+static spi_xfer xfer_queue[ICM20948_XFER_QUEUE_LEN];
+static volatile uint8_t xfer_head;		// transaction on the bus
+static volatile uint8_t xfer_tail;		// next free slot
+static volatile bool xfer_active;
+static bool xfer_data_phase;
+
+// REG_BANK_SEL value the device holds, REG_BANK_UNKNOWN forces the next bank select to be written
+static uint8_t current_bank = REG_BANK_UNKNOWN;
+static icm20948_spi_stats spi_stats;
+
+// first byte is the register address
+static uint8_t dma_tx_buf[ICM20948_DMA_BUF_LEN + 1];
+static uint8_t dma_rx_buf[ICM20948_DMA_BUF_LEN + 1];
+
 
 /* Static Functions */
 static void     cs_high();
@@ -41,16 +100,31 @@ static void     cs_low();
 
 static void     select_user_bank(userbank ub);
 
+//SPI1 DMA transport, completion runs in the DMA interrupt
+static bool     spi_xfer_submit(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx);
+static void     spi_xfer_blocking(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len);
+static void     spi_xfer_wait_for(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, spi_xfer_wait* wait);
+static void     spi_xfer_start_data();
+static void     spi_xfer_complete(bool ok);
+static void     spi_xfer_abort();
+static void     spi_xfer_done_flag(uint8_t* buf, uint16_t len, void* ctx);
+
 //read and write data to icm20948 register, especially for accelerometer and gyroscope
 static uint8_t  read_single_icm20948_reg(userbank ub, uint8_t reg);
 static void     write_single_icm20948_reg(userbank ub, uint8_t reg, uint8_t val);
 static uint8_t* read_multiple_icm20948_reg(userbank ub, uint8_t reg, uint8_t len);
+static void     read_icm20948_burst(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len);
 static void     write_multiple_icm20948_reg(userbank ub, uint8_t reg, uint8_t* val, uint8_t len);
+static void     write_full_scale_reg(uint8_t reg, uint8_t val, volatile uint8_t* fs, uint8_t full_scale);
 
-//read and write data to ak09918, the magnetometer
+//read and write data to ak09918, the magnetometer, through I2C_SLV4 so that I2C_SLV0 keeps mirroring
+static bool     wait_i2c_slv4_done();
 static uint8_t  read_single_ak09916_reg(uint8_t reg);
 static void     write_single_ak09916_reg(uint8_t reg, uint8_t val);
-static uint8_t* read_multiple_ak09916_reg(uint8_t reg, uint8_t len);
+
+//sensor configuration
+static uint16_t odr_divider(uint32_t odr_mhz, uint16_t max_divider);
+static uint8_t  dlpf_config(const uint32_t* bandwidth_mhz, uint32_t target_mhz);
 
 
 /* Main Functions */
@@ -76,21 +150,20 @@ void icm20948_init()
     //Reset I2C Slave module and put the serial interface in SPI mode only.
 	icm20948_spi_slave_enable();
 
-    // Enable digital low pass filter for gyroscope and accelerometer
-	icm20948_gyro_low_pass_filter(0);
-	icm20948_accel_low_pass_filter(0);
-
-    // Set sample rate(ODR) for gyroscope and accelerometer. scaler =10, means both sample at 102.3Hz
-	icm20948_gyro_sample_rate_divider(10);
-	icm20948_accel_sample_rate_divider(10);
+    // Enable digital low pass filter and set sample rate(ODR) for gyroscope and accelerometer, 102.3Hz by default.
+	// The biases are measured at the power on full scale, 250 dps and 2 g
+	icm20948_sensor_config gyro = { ICM20948_GYRO_ODR_MHZ, _250dps, ICM20948_GYRO_BANDWIDTH_MHZ };
+	icm20948_sensor_config accel = { ICM20948_ACCEL_ODR_MHZ, _2g, ICM20948_ACCEL_BANDWIDTH_MHZ };
+	icm20948_gyro_configure(&gyro, NULL);
+	icm20948_accel_configure(&accel, NULL);
 
     //ICM gyroscope and accelerometer bias cancellation function
 	icm20948_gyro_calibration();
 	icm20948_accel_calibration();
 
     //Choose full-scale range for gyroscope and accelerometer
-	icm20948_gyro_full_scale_select(_2000dps);
-	icm20948_accel_full_scale_select(_16g);
+	icm20948_gyro_full_scale_select(ICM20948_GYRO_FULL_SCALE);
+	icm20948_accel_full_scale_select(ICM20948_ACCEL_FULL_SCALE);
 }
 
 /**
@@ -121,6 +194,10 @@ void ak09916_init()
 	//Choose the magnetometer to Continuous Measurement Mode 4 at 100Hz.
 	//This makes sure the sensor is measured periodically in 100Hz.
 	ak09916_operation_mode_setting(continuous_measurement_100hz);
+
+	//Let I2C_SLV0 keep reading ST1 ~ ST2 at the I2C master ODR,
+	//so that the magnetometer data is always waiting in EXT_SLV_SENS_DATA_00 ~ 08.
+	ak09916_auto_poll_enable();
 }
 
 /**
@@ -152,6 +229,8 @@ void icm20948_accel_read(axises* data)
 /**
  * @brief Read magnetometer data.
  *
+ * The data is taken from the EXT_SLV_SENS_DATA shadow registers that I2C_SLV0 keeps filling with ST1 ~ ST2,
+    so only one bank 0 SPI read is needed and no I2C transaction is started here.
  * Data ready and overflow tests implemented first. If the magnetometer passes the two tests first,
     read the data from registers. If system pass these two tests, a true will be returned at the end of the function.
  *
@@ -162,23 +241,24 @@ bool ak09916_mag_read(axises* data)
 	uint8_t* temp;
 	uint8_t drdy, hofl;	// data ready, overflow
 
-	drdy = read_single_ak09916_reg(MAG_ST1) & 0x01;
+	// EXT_SLV_SENS_DATA_00 ~ 08 = ST1, HXL ~ HZH, TMPS, ST2
+	temp = read_multiple_icm20948_reg(ub_0, B0_EXT_SLV_SENS_DATA_00, AK09916_MIRROR_LEN);
+
+	drdy = temp[0] & 0x01;
 	if(!drdy){
-		printf("data is not ready\n");
+		LOG_DEBUG(LOG_MAG_NOT_READY);
 		return false;
 	}
 
-	temp = read_multiple_ak09916_reg(MAG_HXL, 6);
-
-	hofl = read_single_ak09916_reg(MAG_ST2) & 0x08;
+	hofl = temp[8] & 0x08;
 	if(hofl){
-		printf("data is overflow\n");
+		LOG_WARN(LOG_MAG_OVERFLOW);
 		return false;
 	}
 
-	data->x = (int16_t)(temp[1] << 8 | temp[0]);
-	data->y = (int16_t)(temp[3] << 8 | temp[2]);
-	data->z = (int16_t)(temp[5] << 8 | temp[4]);
+	data->x = (int16_t)(temp[2] << 8 | temp[1]);
+	data->y = (int16_t)(temp[4] << 8 | temp[3]);
+	data->z = (int16_t)(temp[6] << 8 | temp[5]);
 
 	return true;
 }
@@ -224,14 +304,15 @@ bool ak09916_mag_read_uT(axises* data)
 	data->y = (float)(temp.y * 0.15);
 	data->z = (float)(temp.z * 0.15);
 
-	printf("magnetometer : %f, %f, and %f\n", data ->x,
-			data ->y, data ->z);
+	LOG_DEBUG(LOG_MAG_RAW, (int32_t)temp.x, (int32_t)temp.y, (int32_t)temp.z);
 
 	return true;
 }
 /**
- * @brief Read all data, accelerometer, gyroscope and magnetometer data altogether
- * Make sure all data is in the standard units, and no overflow and data is ready for data collection
+ * @brief Read all data, accelerometer, gyroscope, temperature and magnetometer data altogether
+ * One burst read from B0_ACCEL_XOUT_H through B0_EXT_SLV_SENS_DATA_08 in a single CS-low window.
+ * The magnetometer part is the ST1..ST2 block mirrored by I2C_SLV0 (armed in ak09916_init()).
+ * If the magnetometer has no new data or overflowed, the last valid magnetometer reading is kept.
  * And store on the data in the struct, icm_20948_data type.
  * @return result(icm_20948_data).
  */
@@ -239,62 +320,294 @@ icm_20948_data read_all_data(void)
 //uint8_t read_all_data(icm_20948_data* data)
 {
 	icm_20948_data result;
-	axises my_gyro;
-	axises my_accel;
-	axises my_mag;
+	uint8_t* temp = read_multiple_icm20948_reg(ub_0, B0_ACCEL_XOUT_H, ICM20948_BURST_LEN);
 
-	icm20948_gyro_read(&my_gyro);
+	icm20948_parse_sample(temp, &result);
 
-	my_gyro.x /= gyro_scale_factor;
-	my_gyro.y /= gyro_scale_factor;
-	my_gyro.z /= gyro_scale_factor;
+    LOG_DEBUG(LOG_ACCEL_MG, (int32_t)(result.x_accel * 1000),
+           (int32_t)(result.y_accel * 1000), (int32_t)(result.z_accel * 1000));
+    LOG_DEBUG(LOG_GYRO_MDPS, (int32_t)(result.x_gyro * 1000),
+           (int32_t)(result.y_gyro * 1000), (int32_t)(result.z_gyro * 1000));
+    LOG_DEBUG(LOG_MAG_NT, (int32_t)(result.x_magnet * 1000),
+           (int32_t)(result.y_magnet * 1000), (int32_t)(result.z_magnet * 1000));
 
-	icm20948_accel_read(&my_accel);
+    return result;
 
-	my_accel.x /= accel_scale_factor;
-	my_accel.y /= accel_scale_factor;
-	my_accel.z /= accel_scale_factor;
+}
+/**
+ * @brief Raw data ready interrupt on the INT1 pin
+ * INT_PIN_CFG: active high, push-pull, 50us pulse (not latched), page 40
+ * INT_ENABLE_1: RAW_DATA_0_RDY_EN, one pulse per sample at the gyroscope/accelerometer ODR, page 41
+ * @return None.
+ */
+void icm20948_data_ready_enable()
+{
+	write_single_icm20948_reg(ub_0, B0_INT_PIN_CFG, 0x00);
+	write_single_icm20948_reg(ub_0, B0_INT_ENABLE_1, 0x01);
+}
+/**
+ * @brief Stop the raw data ready interrupt
+ * @return None.
+ */
+void icm20948_data_ready_disable()
+{
+	write_single_icm20948_reg(ub_0, B0_INT_ENABLE_1, 0x00);
+}
+/**
+ * @brief Read one full sample in a single burst, without unit conversion
+ * @return None.
+ */
+void icm20948_read_raw_sample(icm20948_raw_sample* sample)
+{
+	uint8_t* temp = read_multiple_icm20948_reg(ub_0, B0_ACCEL_XOUT_H, ICM20948_BURST_LEN);
 
-	axises temp;
-	bool new_data = ak09916_mag_read(&temp);
-//	ak09916_mag_read(&temp);
-	printf("new data is %d\n", new_data);
-	if(!new_data)
+	icm20948_parse_raw_sample(temp, icm20948_full_scale(), sample);
+}
+/**
+ * @brief Start FIFO streaming
+ * Accelerometer, gyroscope, temperature and I2C_SLV0 data are written into the FIFO at every sample,
+ * so each record has the same ICM20948_BURST_LEN layout as the registers ACCEL_XOUT_H ~ EXT_SLV_SENS_DATA_08.
+ * Stream mode: when the FIFO is full, the oldest data is overwritten and an overflow is flagged.
+ * @return None.
+ */
+void icm20948_fifo_enable()
+{
+	uint8_t new_val;
+
+	icm20948_fifo_disable();
+	// FIFO_MODE: 0 = stream, page 58
+	write_single_icm20948_reg(ub_0, B0_FIFO_MODE, 0x00);
+	// FIFO_EN_1: SLV_0_FIFO_EN, FIFO_EN_2: ACCEL, GYRO_Z/Y/X and TEMP_FIFO_EN, page 56
+	write_single_icm20948_reg(ub_0, B0_FIFO_EN_1, 0x01);
+	write_single_icm20948_reg(ub_0, B0_FIFO_EN_2, 0x1F);
+	icm20948_fifo_reset();
+	// clear a stale overflow flag
+	read_single_icm20948_reg(ub_0, B0_INT_STATUS_2);
+
+	// USER_CTRL: FIFO_EN
+	new_val = read_single_icm20948_reg(ub_0, B0_USER_CTRL);
+	new_val |= 0x40;
+	write_single_icm20948_reg(ub_0, B0_USER_CTRL, new_val);
+}
+/**
+ * @brief Stop FIFO streaming, sensors stop writing into the FIFO
+ * @return None.
+ */
+void icm20948_fifo_disable()
+{
+	uint8_t new_val = read_single_icm20948_reg(ub_0, B0_USER_CTRL);
+	new_val &= ~0x40;
+
+	write_single_icm20948_reg(ub_0, B0_USER_CTRL, new_val);
+	write_single_icm20948_reg(ub_0, B0_FIFO_EN_1, 0x00);
+	write_single_icm20948_reg(ub_0, B0_FIFO_EN_2, 0x00);
+}
+/**
+ * @brief Flush the FIFO, FIFO_RESET is asserted then de-asserted
+ * @return None.
+ */
+void icm20948_fifo_reset()
+{
+	write_single_icm20948_reg(ub_0, B0_FIFO_RST, 0x1F);
+	write_single_icm20948_reg(ub_0, B0_FIFO_RST, 0x00);
+}
+/**
+ * @brief Number of bytes in the FIFO, FIFO_COUNTH[4:0] and FIFO_COUNTL
+ * @return byte count.
+ */
+uint16_t icm20948_fifo_count()
+{
+	uint8_t* temp = read_multiple_icm20948_reg(ub_0, B0_FIFO_COUNTH, 2);
+
+	return (uint16_t)((temp[0] & 0x1F) << 8 | temp[1]);
+}
+/**
+ * @brief Drain the FIFO into a raw sample array
+ * Whole records are read from FIFO_R_W in bursts of up to ICM20948_FIFO_MAX_RECORDS, until the FIFO holds
+ * less than one record or the array is full.
+ * If the FIFO overflowed, the records are no longer aligned: the FIFO is flushed and no samples are returned.
+ * @param samples: array to fill
+ * @param max_samples: size of the array
+ * @param overflow: set to true if the FIFO overflowed since the last call, may be NULL
+ * @return number of samples written.
+ */
+uint16_t icm20948_fifo_read(icm20948_raw_sample* samples, uint16_t max_samples, bool* overflow)
+{
+	uint16_t n = 0;
+	uint16_t records, i;
+
+	// INT_STATUS_2: FIFO_OVERFLOW_INT[4:0], cleared on read
+	bool ovf = read_single_icm20948_reg(ub_0, B0_INT_STATUS_2) & 0x1F;
+	if(overflow)
+		*overflow = ovf;
+	if(ovf)
 	{
-		printf("data not ready/ overflow for magnetometer\n");
-		while(1);
+		icm20948_fifo_reset();
+		return 0;
 	}
-	else
+
+	while(n < max_samples)
 	{
-		printf("magnetometer reading finished.\n");
-	}
+		records = icm20948_fifo_count() / ICM20948_BURST_LEN;
+		if(records == 0)
+			break;
+		if(records > ICM20948_FIFO_MAX_RECORDS)
+			records = ICM20948_FIFO_MAX_RECORDS;
+		if(records > max_samples - n)
+			records = max_samples - n;
 
-	my_mag.x = (float)(temp.x * 0.15);
-	my_mag.y = (float)(temp.y * 0.15);
-	my_mag.z = (float)(temp.z * 0.15);
+		read_icm20948_burst(ub_0, B0_FIFO_R_W, fifo_buf, records * ICM20948_BURST_LEN);
 
+		for(i = 0; i < records; i++)
+			icm20948_parse_raw_sample(&fifo_buf[i * ICM20948_BURST_LEN], icm20948_full_scale(), &samples[n++]);
+	}
 
-    result.x_magnet = my_mag.x;
-    result.y_magnet = my_mag.y;
-    result.z_magnet = my_mag.z;
+	return n;
+}
+/**
+ * @brief Configure the gyroscope: output data rate, full-scale range and digital LPF bandwidth
+ * The divider is the one of the nearest rate, the LPF the narrowest with at least the target bandwidth.
+ * The LPF stays enabled, GYRO_SMPLRT_DIV is only used with it.
+ * @return false if the target is out of range, nothing is written then.
+ */
+bool icm20948_gyro_configure(const icm20948_sensor_config* target, icm20948_sensor_config* actual)
+{
+	if(target->odr_mhz == 0 || target->full_scale > _2000dps)
+		return false;
 
-    result.x_accel = my_accel.x;
-    result.y_accel = my_accel.y;
-    result.z_accel = my_accel.z;
+	icm20948_gyro_low_pass_filter(dlpf_config(gyro_dlpf_bandwidth_mhz, target->bandwidth_mhz));
+	icm20948_gyro_sample_rate_divider(odr_divider(target->odr_mhz, ICM20948_GYRO_MAX_DIVIDER));
+	icm20948_gyro_full_scale_select(target->full_scale);
 
-    result.x_gyro = my_gyro.x;
-    result.y_gyro = my_gyro.y;
-    result.z_gyro = my_gyro.z;
+	if(actual != NULL)
+		*actual = gyro_config;
+	return true;
+}
+/**
+ * @brief Configure the accelerometer: output data rate, full-scale range and digital LPF bandwidth
+ * As icm20948_gyro_configure(), with the 12 bit ACCEL_SMPLRT_DIV the rate goes down to 0.27 Hz.
+ * @return false if the target is out of range, nothing is written then.
+ */
+bool icm20948_accel_configure(const icm20948_sensor_config* target, icm20948_sensor_config* actual)
+{
+	if(target->odr_mhz == 0 || target->full_scale > _16g)
+		return false;
 
-    printf("accelerometer : %f, %f, and %f \n", result.x_accel,
-           result.y_accel, result.z_accel);
-    printf("gyroscope : %f, %f, and %f \n", result.x_gyro,
-           result.y_gyro, result.z_gyro);
-    printf("magnetometer : %f, %f, and %f\n", result.x_magnet,
-           result.y_magnet, result.z_magnet);
+	icm20948_accel_low_pass_filter(dlpf_config(accel_dlpf_bandwidth_mhz, target->bandwidth_mhz));
+	icm20948_accel_sample_rate_divider(odr_divider(target->odr_mhz, ICM20948_ACCEL_MAX_DIVIDER));
+	icm20948_accel_full_scale_select(target->full_scale);
 
-    return result;
+	if(actual != NULL)
+		*actual = accel_config;
+	return true;
+}
+/**
+ * @brief Copy the configuration as written, whichever function wrote it
+ * @return None.
+ */
+void icm20948_get_config(icm20948_sensor_config* gyro, icm20948_sensor_config* accel)
+{
+	*gyro = gyro_config;
+	*accel = accel_config;
+}
+/**
+ * @brief Full-scale selection of the bursts read from now on, as FRAME_FIELD_SCALE: accel_fs << 4 | gyro_fs
+ * Read in the burst read callback, it is the range the burst was measured with.
+ * @return the selection for icm20948_parse_raw_sample().
+ */
+uint8_t icm20948_full_scale(void)
+{
+	return accel_fs << 4 | gyro_fs;
+}
+/**
+ * @brief Queue a non-blocking register read on SPI1 DMA
+ * The callback runs in the DMA interrupt once buf holds the data; len is 0 if the transfer failed.
+ * @return false if the queue is full or len is larger than ICM20948_DMA_BUF_LEN.
+ */
+bool icm20948_read_async(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx)
+{
+	return spi_xfer_submit(ub, READ | reg, buf, len, cb, ctx);
+}
+/**
+ * @brief Queue a non-blocking register write on SPI1 DMA
+ * buf must stay valid until the callback runs.
+ * @return false if the queue is full or len is larger than ICM20948_DMA_BUF_LEN.
+ */
+bool icm20948_write_async(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx)
+{
+	return spi_xfer_submit(ub, WRITE | reg, buf, len, cb, ctx);
+}
+/**
+ * @brief Queue a non-blocking burst read of one full sample, ICM20948_BURST_LEN bytes
+ * Use icm20948_parse_raw_sample() on raw once the callback has run.
+ * @return false if the queue is full.
+ */
+bool icm20948_read_all_data_async(uint8_t* raw, icm20948_xfer_cb cb, void* ctx)
+{
+	return spi_xfer_submit(ub_0, READ | B0_ACCEL_XOUT_H, raw, ICM20948_BURST_LEN, cb, ctx);
+}
+/**
+ * @brief true while SPI1 DMA transactions are queued or running
+ */
+bool icm20948_spi_busy()
+{
+	return xfer_active;
+}
+/**
+ * @brief Forget the cached user bank, the next access writes REG_BANK_SEL again
+ * Needed whenever the device may have changed bank on its own (reset, power cycle, SPI error).
+ * @return None.
+ */
+void icm20948_bank_cache_invalidate()
+{
+	current_bank = REG_BANK_UNKNOWN;
+}
+/**
+ * @brief Copy of the SPI transaction counters
+ * @return None.
+ */
+void icm20948_get_spi_stats(icm20948_spi_stats* stats)
+{
+	__disable_irq();
+	*stats = spi_stats;
+	__enable_irq();
+}
+/**
+ * @brief Clear the SPI transaction counters
+ * @return None.
+ */
+void icm20948_reset_spi_stats()
+{
+	__disable_irq();
+	memset(&spi_stats, 0, sizeof(spi_stats));
+	__enable_irq();
+}
+/**
+ * @brief SPI1 DMA full-duplex transfer finished, the bank select is followed by the register access
+ * @return None.
+ */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	if(hspi != ICM20948_SPI)
+		return;
 
+	cs_high();
+	if(!xfer_data_phase)
+		spi_xfer_start_data();
+	else
+		spi_xfer_complete(true);
+}
+/**
+ * @brief SPI1 DMA error, the current transaction completes with len 0
+ * @return None.
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+	if(hspi != ICM20948_SPI)
+		return;
+
+	cs_high();
+	spi_xfer_complete(false);
 }
 /**
  * @brief who_am_i check for icm20948
@@ -303,13 +616,12 @@ icm_20948_data read_all_data(void)
 bool icm20948_who_am_i()
 {
 	uint8_t icm20948_id = read_single_icm20948_reg(ub_0, B0_WHO_AM_I);
-	printf("the icm20948 who am i is: 0x%x\n",icm20948_id);
 	if(icm20948_id == ICM20948_ID){
-		printf("Data matches, icm20948 identity verified.\n");
+		LOG_INFO(LOG_ICM_WHO_AM_I, icm20948_id);
 		return true;
 	}
 	else{
-		printf("Data not matched, icm20948 incorrect.\n");
+		LOG_ERROR(LOG_ICM_ID_MISMATCH, icm20948_id, ICM20948_ID);
 		return false;
 	}
 }
@@ -320,15 +632,14 @@ bool icm20948_who_am_i()
 bool ak09916_who_am_i()
 {
 	uint8_t ak09916_id = read_single_ak09916_reg(MAG_WIA2);
-	printf("the ak09916_id who am i is: 0x%x\n", ak09916_id);
 	if(ak09916_id == AK09916_ID)
 	{
-		printf("Data matches, ak09916 identity verified.\n");
+		LOG_INFO(LOG_AK_WHO_AM_I, ak09916_id);
 		return true;
 	}
 	else
 	{
-		printf("Data not matched, ak09916 incorrect.\n");
+		LOG_ERROR(LOG_AK_ID_MISMATCH, ak09916_id, AK09916_ID);
 		return false;
 	}
 }
@@ -337,6 +648,8 @@ void icm20948_device_reset()
 {
 	write_single_icm20948_reg(ub_0, B0_PWR_MGMT_1, 0x80 | 0x41);
 	HAL_Delay(100);
+	// the reset brings REG_BANK_SEL back to its default, resynchronize on the next access
+	icm20948_bank_cache_invalidate();
 }
 /**
  * @brief Configure low pass filter for magnetometer and i2c master odr rate
@@ -458,7 +771,9 @@ void icm20948_odr_align_enable()
 void icm20948_gyro_low_pass_filter(uint8_t config)
 {
 	uint8_t new_val = read_single_icm20948_reg(ub_2, B2_GYRO_CONFIG_1);
-	new_val |= config << 3;
+	// GYRO_DLPFCFG bit 5:3, GYRO_FCHOICE bit 0
+	new_val = (new_val & ~0x39) | (config & 0x07) << 3 | 0x01;
+	gyro_config.bandwidth_mhz = gyro_dlpf_bandwidth_mhz[config & 0x07];
 
 	write_single_icm20948_reg(ub_2, B2_GYRO_CONFIG_1, new_val);
 }
@@ -469,9 +784,11 @@ void icm20948_gyro_low_pass_filter(uint8_t config)
 void icm20948_accel_low_pass_filter(uint8_t config)
 {
 	uint8_t new_val = read_single_icm20948_reg(ub_2, B2_ACCEL_CONFIG);
-	new_val |= config << 3;
+	// ACCEL_DLPFCFG bit 5:3, ACCEL_FCHOICE bit 0
+	new_val = (new_val & ~0x39) | (config & 0x07) << 3 | 0x01;
+	accel_config.bandwidth_mhz = accel_dlpf_bandwidth_mhz[config & 0x07];
 
-	write_single_icm20948_reg(ub_2, B2_GYRO_CONFIG_1, new_val);
+	write_single_icm20948_reg(ub_2, B2_ACCEL_CONFIG, new_val);
 }
 /**
  * @brief icm20948 sample rate divider, different scaler gives different odr rate.
@@ -481,6 +798,7 @@ void icm20948_accel_low_pass_filter(uint8_t config)
 void icm20948_gyro_sample_rate_divider(uint8_t divider)
 {
 	write_single_icm20948_reg(ub_2, B2_GYRO_SMPLRT_DIV, divider);
+	gyro_config.odr_mhz = (ICM20948_ODR_BASE_MHZ + (1 + divider) / 2) / (1 + divider);
 }
 /**
  * @brief icm20948 sample rate divider, different scaler gives different odr rate.
@@ -489,11 +807,14 @@ void icm20948_gyro_sample_rate_divider(uint8_t divider)
  */
 void icm20948_accel_sample_rate_divider(uint16_t divider)
 {
-	uint8_t divider_1 = (uint8_t)(divider >> 8);
-	uint8_t divider_2 = (uint8_t)(0x0F & divider);
+	// 12 bits, ACCEL_SMPLRT_DIV_1 holds bit 11:8
+	uint8_t divider_1 = (uint8_t)(0x0F & divider >> 8);
+	uint8_t divider_2 = (uint8_t)(0xFF & divider);
 
 	write_single_icm20948_reg(ub_2, B2_ACCEL_SMPLRT_DIV_1, divider_1);
 	write_single_icm20948_reg(ub_2, B2_ACCEL_SMPLRT_DIV_2, divider_2);
+	divider &= ICM20948_ACCEL_MAX_DIVIDER;
+	accel_config.odr_mhz = (ICM20948_ODR_BASE_MHZ + (1 + divider) / 2) / (1 + divider);
 }
 /**
  * @brief icm20948 continuous measurement mode
@@ -505,6 +826,26 @@ void ak09916_operation_mode_setting(operation_mode mode)
 	write_single_ak09916_reg(MAG_CNTL2, mode);
 	HAL_Delay(100);
 }
+/**
+ * @brief ak09916 autonomous polling through I2C_SLV0
+ * The I2C master reads ST1 ~ ST2 (9 bytes) from ak09916 at I2C_MST_ODR and stores them in
+ * EXT_SLV_SENS_DATA_00 ~ 08. Reading ST2 at the end of each transfer releases the data lock of ak09916.
+ * @return None.
+ */
+void ak09916_auto_poll_enable()
+{
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_ADDR, READ | MAG_SLAVE_ADDR);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_REG, MAG_ST1);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_CTRL, 0x80 | AK09916_MIRROR_LEN);
+}
+/**
+ * @brief stop the ak09916 autonomous polling, EXT_SLV_SENS_DATA keeps the last values
+ * @return None.
+ */
+void ak09916_auto_poll_disable()
+{
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_CTRL, 0x00);
+}
 
 /**
  * @brief remove gyroscope calibration
@@ -553,7 +894,6 @@ void icm20948_gyro_calibration()
  */
 void icm20948_accel_calibration()
 {
-	axises temp;
 	uint8_t* temp2;
 	uint8_t* temp3;
 	uint8_t* temp4;
@@ -562,13 +902,13 @@ void icm20948_accel_calibration()
 	int32_t accel_bias_reg[3] = {0};
 	uint8_t accel_offset[6] = {0};
 
-    //Take 100 accel measurements
+    //Take 100 accel measurements, raw counts: icm20948_accel_read() adds back the 1 g taken out here
 	for(int i = 0; i < 100; i++)
 	{
-		icm20948_accel_read(&temp);
-		accel_bias[0] += temp.x;
-		accel_bias[1] += temp.y;
-		accel_bias[2] += temp.z;
+		temp2 = read_multiple_icm20948_reg(ub_0, B0_ACCEL_XOUT_H, 6);
+		accel_bias[0] += (int16_t)(temp2[0] << 8 | temp2[1]);
+		accel_bias[1] += (int16_t)(temp2[2] << 8 | temp2[3]);
+		accel_bias[2] += (int16_t)(temp2[4] << 8 | temp2[5]);
 	}
 
     //Divide by 100 get the average accelerometer readings
@@ -621,28 +961,13 @@ void icm20948_accel_calibration()
 void icm20948_gyro_full_scale_select(gyro_full_scale full_scale)
 {
 	uint8_t new_val = read_single_icm20948_reg(ub_2, B2_GYRO_CONFIG_1);
+	// GYRO_FS_SEL bit 2:1, the other bits are kept
+	full_scale &= 0x03;
+	new_val = (new_val & ~0x06) | full_scale << 1;
+	gyro_scale_factor = gyro_lsb_per_dps[full_scale];
+	gyro_config.full_scale = full_scale;
 
-	switch(full_scale)
-	{
-		case _250dps :
-			new_val |= 0x00;
-			gyro_scale_factor = 131.0;
-			break;
-		case _500dps :
-			new_val |= 0x02;
-			gyro_scale_factor = 65.5;
-			break;
-		case _1000dps :
-			new_val |= 0x04;
-			gyro_scale_factor = 32.8;
-			break;
-		case _2000dps :
-			new_val |= 0x06;
-			gyro_scale_factor = 16.4;
-			break;
-	}
-
-	write_single_icm20948_reg(ub_2, B2_GYRO_CONFIG_1, new_val);
+	write_full_scale_reg(B2_GYRO_CONFIG_1, new_val, &gyro_fs, full_scale);
 }
 
 /**
@@ -652,32 +977,44 @@ void icm20948_gyro_full_scale_select(gyro_full_scale full_scale)
 void icm20948_accel_full_scale_select(accel_full_scale full_scale)
 {
 	uint8_t new_val = read_single_icm20948_reg(ub_2, B2_ACCEL_CONFIG);
+	// ACCEL_FS_SEL bit 2:1, the other bits are kept
+	full_scale &= 0x03;
+	new_val = (new_val & ~0x06) | full_scale << 1;
+	accel_scale_factor = accel_lsb_per_g[full_scale];
+	accel_config.full_scale = full_scale;
 
-	switch(full_scale)
-	{
-		case _2g :
-			new_val |= 0x00;
-			accel_scale_factor = 16384;
-			break;
-		case _4g :
-			new_val |= 0x02;
-			accel_scale_factor = 8192;
-			break;
-		case _8g :
-			new_val |= 0x04;
-			accel_scale_factor = 4096;
-			break;
-		case _16g :
-			new_val |= 0x06;
-			accel_scale_factor = 2048;
-			break;
-	}
-
-	write_single_icm20948_reg(ub_2, B2_ACCEL_CONFIG, new_val);
+	write_full_scale_reg(B2_ACCEL_CONFIG, new_val, &accel_fs, full_scale);
 }
 
 
 /* Static Functions */
+//divider of the output data rate nearest to odr_mhz, odr_mhz is not 0
+static uint16_t odr_divider(uint32_t odr_mhz, uint16_t max_divider)
+{
+	uint32_t n = ICM20948_ODR_BASE_MHZ / odr_mhz;
+
+	// base / n >= odr_mhz > base / (n + 1), n + 1 is nearer if base / n - odr_mhz > odr_mhz - base / (n + 1)
+	if(n == 0)
+		n = 1;
+	else if((uint64_t)ICM20948_ODR_BASE_MHZ * (2 * n + 1) > 2ull * odr_mhz * n * (n + 1))
+		n++;
+
+	return n > (uint32_t)max_divider + 1 ? max_divider : n - 1;
+}
+//narrowest DLPFCFG with at least target_mhz of bandwidth, the widest if none has
+static uint8_t dlpf_config(const uint32_t* bandwidth_mhz, uint32_t target_mhz)
+{
+	uint8_t config = 0, i;
+
+	for(i = 1; i < 8; i++)
+	{
+		if(bandwidth_mhz[config] < target_mhz ? bandwidth_mhz[i] > bandwidth_mhz[config] :
+				bandwidth_mhz[i] >= target_mhz && bandwidth_mhz[i] < bandwidth_mhz[config])
+			config = i;
+	}
+
+	return config;
+}
 //toggle the gpio output pin(CS pin) to high
 static void cs_high()
 {
@@ -688,29 +1025,177 @@ static void cs_low()
 {
 	HAL_GPIO_WritePin(ICM20948_SPI_CS_PIN_PORT, ICM20948_SPI_CS_PIN_NUMBER, RESET);
 }
-//Select userbank
+//Select userbank, first phase of the transaction at the head of the queue
+//skipped when the device is already on this bank
 static void select_user_bank(userbank ub)
 {
-	uint8_t write_reg[2];
-	write_reg[0] = WRITE | REG_BANK_SEL;
-	write_reg[1] = ub;
+	if(ub == current_bank)
+	{
+		spi_stats.bank_selects_skipped++;
+		spi_xfer_start_data();
+		return;
+	}
+
+	current_bank = ub;
+	spi_stats.bank_selects++;
+	spi_stats.transactions++;
+
+	dma_tx_buf[0] = WRITE | REG_BANK_SEL;
+	dma_tx_buf[1] = ub;
+
+	xfer_data_phase = false;
+	cs_low();
+	if(HAL_SPI_TransmitReceive_DMA(ICM20948_SPI, dma_tx_buf, dma_rx_buf, 2) != HAL_OK)
+	{
+		cs_high();
+		spi_xfer_complete(false);
+	}
+}
+//Second phase: register address followed by len data bytes in the same CS-low window
+static void spi_xfer_start_data()
+{
+	spi_xfer* xfer = &xfer_queue[xfer_head];
+
+	dma_tx_buf[0] = xfer->reg;
+	if(xfer->reg & READ)
+		memset(&dma_tx_buf[1], 0, xfer->len);
+	else
+		memcpy(&dma_tx_buf[1], xfer->buf, xfer->len);
 
+	spi_stats.transactions++;
+	xfer_data_phase = true;
 	cs_low();
-	HAL_SPI_Transmit(ICM20948_SPI, write_reg, 2, 10);
+	if(HAL_SPI_TransmitReceive_DMA(ICM20948_SPI, dma_tx_buf, dma_rx_buf, xfer->len + 1) != HAL_OK)
+	{
+		cs_high();
+		spi_xfer_complete(false);
+	}
+}
+//Finish the head transaction, call its callback and start the next one
+static void spi_xfer_complete(bool ok)
+{
+	spi_xfer xfer = xfer_queue[xfer_head];
+
+	// a failed transfer may have left the bank select half written
+	if(!ok)
+	{
+		current_bank = REG_BANK_UNKNOWN;
+		spi_stats.errors++;
+	}
+	if(ok && (xfer.reg & READ))
+		memcpy(xfer.buf, &dma_rx_buf[1], xfer.len);
+	xfer_head = (xfer_head + 1) % ICM20948_XFER_QUEUE_LEN;
+
+	// the callback may queue a new transaction
+	if(xfer.cb)
+		xfer.cb(xfer.buf, ok ? xfer.len : 0, xfer.ctx);
+
+	if(xfer_head != xfer_tail)
+		select_user_bank(xfer_queue[xfer_head].ub);
+	else
+		xfer_active = false;
+}
+//Add a transaction to the queue, start the bus if it is idle
+static bool spi_xfer_submit(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, icm20948_xfer_cb cb, void* ctx)
+{
+	uint32_t primask;
+	uint8_t next;
+
+	if(len == 0 || len > ICM20948_DMA_BUF_LEN)
+		return false;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+
+	next = (xfer_tail + 1) % ICM20948_XFER_QUEUE_LEN;
+	if(next == xfer_head)
+	{
+		__set_PRIMASK(primask);
+		return false;
+	}
+
+	xfer_queue[xfer_tail] = (spi_xfer){ ub, reg, buf, len, cb, ctx };
+	xfer_tail = next;
+
+	if(!xfer_active)
+	{
+		xfer_active = true;
+		select_user_bank(ub);
+	}
+
+	__set_PRIMASK(primask);
+	return true;
+}
+//Queue a transaction and wait for it, not to be used from an interrupt
+static void spi_xfer_blocking(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len)
+{
+	spi_xfer_wait wait = { false, NULL, 0 };
+
+	spi_xfer_wait_for(ub, reg, buf, len, &wait);
+}
+static void spi_xfer_wait_for(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len, spi_xfer_wait* wait)
+{
+	uint32_t start = HAL_GetTick();
+
+	while(!spi_xfer_submit(ub, reg, buf, len, spi_xfer_done_flag, wait))
+	{
+		if(HAL_GetTick() - start > ICM20948_SPI_TIMEOUT)
+		{
+			spi_xfer_abort();
+			return;
+		}
+	}
+
+	while(!wait->done)
+	{
+		if(HAL_GetTick() - start > ICM20948_SPI_TIMEOUT)
+		{
+			spi_xfer_abort();
+			return;
+		}
+	}
+}
+//Stop the bus and drop every queued transaction, each one completes with len 0 as after a DMA error
+static void spi_xfer_abort()
+{
+	spi_xfer dropped[ICM20948_XFER_QUEUE_LEN];
+	uint8_t count = 0, i;
+
+	HAL_SPI_Abort(ICM20948_SPI);
 	cs_high();
+
+	__disable_irq();
+	while(xfer_head != xfer_tail)
+	{
+		dropped[count++] = xfer_queue[xfer_head];
+		xfer_head = (xfer_head + 1) % ICM20948_XFER_QUEUE_LEN;
+	}
+	xfer_head = xfer_tail = 0;
+	xfer_active = false;
+	current_bank = REG_BANK_UNKNOWN;
+	spi_stats.errors++;
+	__enable_irq();
+
+	// outside the critical section, a callback may queue a new transaction
+	for(i = 0; i < count; i++)
+		if(dropped[i].cb)
+			dropped[i].cb(dropped[i].buf, 0, dropped[i].ctx);
+}
+static void spi_xfer_done_flag(uint8_t* buf, uint16_t len, void* ctx)
+{
+	spi_xfer_wait* wait = ctx;
+
+	if(len && wait->fs)
+		*wait->fs = wait->full_scale;
+	wait->done = true;
 }
 
 //SPI read ICM20948 registers, transmit register address and receive data
 static uint8_t read_single_icm20948_reg(userbank ub, uint8_t reg)
 {
-	uint8_t read_reg = READ | reg;
-	uint8_t reg_val;
-	select_user_bank(ub);
+	uint8_t reg_val = 0;
 
-	cs_low();
-	HAL_SPI_Transmit(ICM20948_SPI, &read_reg, 1, 1000);
-	HAL_SPI_Receive(ICM20948_SPI, &reg_val, 1, 1000);
-	cs_high();
+	spi_xfer_blocking(ub, READ | reg, &reg_val, 1);
 
 	return reg_val;
 }
@@ -718,87 +1203,162 @@ static uint8_t read_single_icm20948_reg(userbank ub, uint8_t reg)
 //SPI write ICM20948 registers, transmit register address and data together
 static void write_single_icm20948_reg(userbank ub, uint8_t reg, uint8_t val)
 {
-	uint8_t write_reg[2];
-	write_reg[0] = WRITE | reg;
-	write_reg[1] = val;
-
-	select_user_bank(ub);
-
-	cs_low();
-	HAL_SPI_Transmit(ICM20948_SPI, write_reg, 2, 1000);
-	cs_high();
+	spi_xfer_blocking(ub, WRITE | reg, &val, 1);
 }
 
 //SPI read multiple registers
 static uint8_t* read_multiple_icm20948_reg(userbank ub, uint8_t reg, uint8_t len)
 {
-	uint8_t read_reg = READ | reg;
-	static uint8_t reg_val[6];
-	select_user_bank(ub);
+	static uint8_t reg_val[ICM20948_BURST_LEN];
 
-	cs_low();
-	HAL_SPI_Transmit(ICM20948_SPI, &read_reg, 1, 1000);
-	HAL_SPI_Receive(ICM20948_SPI, reg_val, len, 1000);
-	cs_high();
+	read_icm20948_burst(ub, reg, reg_val, len);
 
 	return reg_val;
 }
+//SPI read a burst into the caller's buffer, the register address auto-increments except for FIFO_R_W
+static void read_icm20948_burst(userbank ub, uint8_t reg, uint8_t* buf, uint16_t len)
+{
+	spi_xfer_blocking(ub, READ | reg, buf, len);
+}
+//SPI write GYRO_CONFIG_1 or ACCEL_CONFIG, *fs follows in the same interrupt as the write completes,
+//so every burst read queued before it keeps the old range and every one after it has the new one
+static void write_full_scale_reg(uint8_t reg, uint8_t val, volatile uint8_t* fs, uint8_t full_scale)
+{
+	spi_xfer_wait wait = { false, fs, full_scale };
+
+	spi_xfer_wait_for(ub_2, WRITE | reg, &val, 1, &wait);
+}
 //SPI write multiple registers
 static void write_multiple_icm20948_reg(userbank ub, uint8_t reg, uint8_t* val, uint8_t len)
 {
-	uint8_t write_reg = WRITE | reg;
-	select_user_bank(ub);
+	spi_xfer_blocking(ub, WRITE | reg, val, len);
+}
+/**
+ * @brief wait for the end of an I2C_SLV4 transaction
+ * I2C_MST_STATUS bit 6: I2C_SLV4_DONE, bit 4: I2C_SLV4_NACK. The register is cleared on read.
+ * SLV4 transfers are started at the I2C master ODR, so one transfer takes less than 1 / 136Hz.
+ * @return true if the transfer is done and acknowledged, false on NACK or timeout.
+ */
+static bool wait_i2c_slv4_done()
+{
+	uint32_t start = HAL_GetTick();
+	uint8_t status;
 
-	cs_low();
-	HAL_SPI_Transmit(ICM20948_SPI, &write_reg, 1, 1000);
-	HAL_SPI_Transmit(ICM20948_SPI, val, len, 1000);
-	cs_high();
+	do
+	{
+		status = read_single_icm20948_reg(ub_0, B0_I2C_MST_STATUS);
+		if(status & 0x40)
+			return !(status & 0x10);
+	} while(HAL_GetTick() - start < AK09916_SLV4_TIMEOUT);
+
+	return false;
 }
 /**
  * @brief Read ak09916 single byte
  * enable I2C Master, ak09916 = I2C slave, ICM = I2C Master. I2C Master comm. all uses SPI comm. to configurate
- * @return ak09916 measurements. HAL_Delay() added to make sure no data overflow.
+ * I2C_SLV4 is used for single transfers, I2C_SLV0 is left untouched for the autonomous polling.
+ * @return one byte reading from I2C_SLV4_DI register, 0 if the transfer failed.
  */
 static uint8_t read_single_ak09916_reg(uint8_t reg)
 {
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_ADDR, READ | MAG_SLAVE_ADDR);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_REG, reg);
-	HAL_Delay(50);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_CTRL, 0x81);
-	HAL_Delay(50);
-	return read_single_icm20948_reg(ub_0, B0_EXT_SLV_SENS_DATA_00);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_ADDR, READ | MAG_SLAVE_ADDR);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_REG, reg);
+	read_single_icm20948_reg(ub_0, B0_I2C_MST_STATUS);		// clear a stale done flag
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_CTRL, 0x80);
+	if(!wait_i2c_slv4_done())
+		return 0;
+	return read_single_icm20948_reg(ub_3, B3_I2C_SLV4_DI);
 }
 /**
  * @brief write ak09916 single byte
  * enable I2C Master, ak09916 = I2C slave, ICM = I2C Master. I2C Master comm. all uses SPI comm. to configurate
- * B3_I2C_SLV0_CTRL: Enable reading data from this ak09916 slave at the sample rate and storing data at the first available
- * HAL_Delay() added to make sure no data overflow.
-        EXT_SENS_DATA register, which is always EXT_SENS_DATA_00 for I2C slave 0.
-        one bytes to be read from I2C slave 0.
- * @return one byte reading from EXT_SENS_DATA register: the magnetometer measurement
+ * B3_I2C_SLV4_CTRL: Enable a single data write to this ak09916 slave, the enable bit clears itself when done.
+ * @return None.
  */
 static void write_single_ak09916_reg(uint8_t reg, uint8_t val)
 {
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_ADDR, WRITE | MAG_SLAVE_ADDR);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_REG, reg);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_DO, val);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_ADDR, WRITE | MAG_SLAVE_ADDR);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_REG, reg);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_DO, val);
+	read_single_icm20948_reg(ub_0, B0_I2C_MST_STATUS);		// clear a stale done flag
 	//	Enable and single data write
-	HAL_Delay(50);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_CTRL, 0x81);
-	HAL_Delay(50);
+	write_single_icm20948_reg(ub_3, B3_I2C_SLV4_CTRL, 0x80);
+	wait_i2c_slv4_done();
+}
+/**
+ * @brief Unpack one ACCEL_XOUT_H ~ EXT_SLV_SENS_DATA_08 block, integer only
+ * The sample keeps the full-scale selection it was measured with, for a later conversion.
+ * If the magnetometer has no new data or overflowed, the last valid magnetometer reading is kept
+ * and ICM20948_SAMPLE_MAG_NEW is cleared.
+ * @return None.
+ */
+void icm20948_parse_raw_sample(const uint8_t* raw, uint8_t full_scale, icm20948_raw_sample* result)
+{
+	int32_t z;
+
+	result->gyro_fs = full_scale & 0x03;
+	result->accel_fs = (full_scale >> 4) & 0x03;
+
+	// accelerometer, B0_ACCEL_XOUT_H ~ B0_ACCEL_ZOUT_L, big endian
+	// Add 1 g to z because calibraiton function offset gravity acceleration, saturated to int16.
+	result->accel.x = (int16_t)(raw[0] << 8 | raw[1]);
+	result->accel.y = (int16_t)(raw[2] << 8 | raw[3]);
+	z = (int16_t)(raw[4] << 8 | raw[5]) + accel_lsb_per_g[result->accel_fs];
+	result->accel.z = z > INT16_MAX ? INT16_MAX : (int16_t)z;
+
+	// gyroscope, B0_GYRO_XOUT_H ~ B0_GYRO_ZOUT_L, big endian
+	result->gyro.x = (int16_t)(raw[6] << 8 | raw[7]);
+	result->gyro.y = (int16_t)(raw[8] << 8 | raw[9]);
+	result->gyro.z = (int16_t)(raw[10] << 8 | raw[11]);
+
+	// temperature, B0_TEMP_OUT_H ~ B0_TEMP_OUT_L
+	result->temperature = (int16_t)(raw[12] << 8 | raw[13]);
+
+	// magnetometer, EXT_SLV_SENS_DATA_00 ~ 08 = ST1, HXL ~ HZH, TMPS, ST2, little endian
+	// ST1 bit 0: data ready, ST2 bit 3: magnetic sensor overflow
+	result->flags = 0;
+	if((raw[14] & 0x01) && !(raw[22] & 0x08))
+	{
+		last_mag.x = (int16_t)(raw[16] << 8 | raw[15]);
+		last_mag.y = (int16_t)(raw[18] << 8 | raw[17]);
+		last_mag.z = (int16_t)(raw[20] << 8 | raw[19]);
+		result->flags |= ICM20948_SAMPLE_MAG_NEW;
+	}
+	result->mag = last_mag;
 }
 /**
- * @brief Read ak09916 multiple byte
- * HAL_Delay() added to make sure no data overflow.
- * @return ak09916 measurements in multiple bytes, no. of bytes determined by the input value.
+ * @brief Convert a raw sample into standard units, g, dps, uT and degree C
+ * Only for the consumers that need physical units, the acquisition path stays integer.
+ * @return None.
  */
-static uint8_t* read_multiple_ak09916_reg(uint8_t reg, uint8_t len)
+void icm20948_raw_to_data(const icm20948_raw_sample* raw, icm_20948_data* result)
 {
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_ADDR, READ | MAG_SLAVE_ADDR);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_REG, reg);
-	HAL_Delay(50);
-	write_single_icm20948_reg(ub_3, B3_I2C_SLV0_CTRL, 0x80 | len);
-	HAL_Delay(50);
-	return read_multiple_icm20948_reg(ub_0, B0_EXT_SLV_SENS_DATA_00, len);
+	float accel_scale = 1.0f / accel_lsb_per_g[raw->accel_fs & 0x03];
+	float gyro_scale = 1.0f / gyro_lsb_per_dps[raw->gyro_fs & 0x03];
+
+	result->x_accel = raw->accel.x * accel_scale;
+	result->y_accel = raw->accel.y * accel_scale;
+	result->z_accel = raw->accel.z * accel_scale;
+
+	result->x_gyro = raw->gyro.x * gyro_scale;
+	result->y_gyro = raw->gyro.y * gyro_scale;
+	result->z_gyro = raw->gyro.z * gyro_scale;
+
+	result->x_magnet = raw->mag.x * AK09916_UT_PER_LSB;
+	result->y_magnet = raw->mag.y * AK09916_UT_PER_LSB;
+	result->z_magnet = raw->mag.z * AK09916_UT_PER_LSB;
+
+	// page 14: ((TEMP_OUT - RoomTemp_Offset) / Temp_Sensitivity) + 21
+	result->temperature = raw->temperature / ICM20948_TEMP_LSB_PER_DEGC + 21.0f;
 }
+/**
+ * @brief Convert one ACCEL_XOUT_H ~ EXT_SLV_SENS_DATA_08 block into standard units
+ * @return None.
+ */
+void icm20948_parse_sample(const uint8_t* raw, icm_20948_data* result)
+{
+	icm20948_raw_sample sample;
 
+	icm20948_parse_raw_sample(raw, icm20948_full_scale(), &sample);
+	icm20948_raw_to_data(&sample, result);
+}
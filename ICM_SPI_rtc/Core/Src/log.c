@@ -0,0 +1,91 @@
+/**
+ * @file log.c
+ * @brief Deferred binary logging
+ *
+ * printf() through _write() and ITM_SendChar() blocks for milliseconds per line, even without a debugger.
+ * A log call here only copies the message id, the tick and the raw arguments into a RAM ring,
+ * a few tens of cycles. The main loop sends the records over the USB VCP when it has nothing else to do
+ * and the host formats them, see LOG_MESSAGES in log.h.
+ *
+ * The severity filter is applied at compile time (LOG_LEVEL), a filtered call leaves no code behind.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "log.h"
+#include "main.h"
+#include "ring_buffer.h"
+#include <string.h>
+
+
+static ring_buffer log_ring;
+static uint8_t log_ring_buf[LOG_RING_SIZE];
+
+
+/**
+ * @brief Empty the log ring
+ * @return None.
+ */
+void log_init(void)
+{
+	ring_init(&log_ring, log_ring_buf, sizeof(log_ring_buf));
+}
+/**
+ * @brief Queue one record, called through the LOG_ macros
+ * Several contexts log, the interrupts are masked around the ring write to keep it single producer.
+ * @return None.
+ */
+void log_write(log_id id, uint8_t level, const uint32_t* args, uint8_t nargs)
+{
+	uint32_t record[LOG_MAX_RECORD_LEN / 4];
+	uint32_t primask;
+
+	if(nargs > LOG_MAX_ARGS)
+		nargs = LOG_MAX_ARGS;
+
+	record[0] = (uint32_t)id | (uint32_t)level << 16 | (uint32_t)nargs << 24;
+	record[1] = HAL_GetTick();
+	memcpy(&record[2], args, nargs * sizeof(uint32_t));
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	ring_write(&log_ring, (uint8_t*)record, LOG_HEADER_LEN + nargs * sizeof(uint32_t));
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Copy the oldest records, as many whole records as fit in max bytes
+ * @return number of bytes copied.
+ */
+uint16_t log_peek(uint8_t* out, uint16_t max)
+{
+	uint16_t len = ring_peek(&log_ring, out, max);
+	uint16_t pos = 0, record_len;
+
+	while(pos + LOG_HEADER_LEN <= len)
+	{
+		record_len = LOG_HEADER_LEN + out[pos + 3] * sizeof(uint32_t);
+		if(pos + record_len > len)
+			break;
+		pos += record_len;
+	}
+
+	return pos;
+}
+/**
+ * @brief Remove the records returned by log_peek()
+ * @return None.
+ */
+void log_consume(uint16_t len)
+{
+	ring_consume(&log_ring, len);
+}
+/**
+ * @brief Records lost because the ring was full
+ * @return number of records.
+ */
+uint32_t log_dropped(void)
+{
+	return log_ring.dropped;
+}
@@ -18,9 +18,12 @@
 /* USER CODE END Header */
 /* Includes ------------------------------------------------------------------*/
 #include "main.h"
+#include "dma.h"
 #include "i2c.h"
+#include "quadspi.h"
 #include "rtc.h"
 #include "spi.h"
+#include "tim.h"
 #include "usb_device.h"
 #include "gpio.h"
 
@@ -28,6 +31,8 @@
 /* USER CODE BEGIN Includes */
 #include "icm20948.h"
 #include "time.h"
+#include "app.h"
+#include "timebase.h"
 #include "usbd_cdc_if.h"
 #include <string.h>
 #include <stdio.h>
@@ -65,22 +70,12 @@ icm_20948_data imu_data;
 //char buffer2[] = "You sent 2, get 2 back\r\n";
 //char buffer3[] = "You sent 3, get 3 back\r\n";
 
-char received_data[1000];
-
 char time[30];
 char date[30];
 
 RTC_TimeTypeDef sTime = {0};
 RTC_DateTypeDef sDate = {0};
 
-NMEA_Result NMEA_result;
-
-//organized data for future sending, including the time data and sensor data
-typedef struct {
-    time_data time_info;
-    icm_20948_data sensor_data;
-} combined_data;
-
 
 /* USER CODE END PV */
 
@@ -102,12 +97,7 @@ void SystemClock_Config(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-	//initialize time data and sensor data
-	icm_20948_data imu_data;
-	time_data time_result;
-	combined_data dataToSend;7
-	//get start time for getting the elapsed time later
-	uint32_t startTime = HAL_GetTick();
+
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -128,15 +118,16 @@ int main(void)
 
   /* Initialize all configured peripherals */
   MX_GPIO_Init();
+  MX_DMA_Init();
   MX_I2C1_Init();
   MX_SPI1_Init();
   MX_USB_DEVICE_Init();
   MX_RTC_Init();
+  MX_TIM2_Init();
+  MX_QUADSPI_Init();
   /* USER CODE BEGIN 2 */
-  //initialize ICM gyroscope, accelerometer and magnetometer peripherals and configuration
-  icm20948_init();
-  ak09916_init();
-
+  //initialize the sensors and start the data ready interrupt driven acquisition
+  app_init();
   /* USER CODE END 2 */
 
   /* Infinite loop */
@@ -147,56 +138,8 @@ int main(void)
 
     /* USER CODE BEGIN 3 */
 	// This segment fetches sensor data, combines it with time information,
-	// formats it into a specific string format, and sends it over USB.
-	  dataToSend.time_info = read_time(startTime); // Assume you already have the read_time function
-	  dataToSend.sensor_data = read_all_data(); // Assume you have modified the read_all_data function as previously indicated
-
-	  char buffer[512]; // suppose 512 bytes is big enough
-	  // Creating a formatted string from the combined time and sensor data
-	  // part to insert special character that enable future data splitting
-	  sprintf(buffer,
-			  "#%u&" //unix timestamp
-			  "%04d-%02d-%02d %02d:%02d:%02d&" // utc_timestamp
-			  "%04d-%02d-%02d %02d:%02d:%02d&" //
-			  "%02u:%02u&"//
-			  "x_accel = %f/y_accel = %f/z_accel = %f&"
-			  "x_gyro = %f/y_gyro = %f/z_gyro =  %f&"
-			  "x_mag = %f/y_mag = %f/z_mag = %f&\r\n",
-			  dataToSend.time_info.unix_timestamp,
-
-			  dataToSend.time_info.utc_time.year,
-			  dataToSend.time_info.utc_time.month,
-			  dataToSend.time_info.utc_time.date,
-			  dataToSend.time_info.utc_time.hour,
-			  dataToSend.time_info.utc_time.min,
-			  dataToSend.time_info.utc_time.sec,
-
-			  dataToSend.time_info.uk_time.year,
-			  dataToSend.time_info.uk_time.month,
-			  dataToSend.time_info.uk_time.date,
-			  dataToSend.time_info.uk_time.hour,
-			  dataToSend.time_info.uk_time.min,
-			  dataToSend.time_info.uk_time.sec,
-
-			  dataToSend.time_info.elapsed_minutes,
-			  dataToSend.time_info.elapsed_seconds,
-
-			  dataToSend.sensor_data.x_accel,
-			  dataToSend.sensor_data.y_accel,
-			  dataToSend.sensor_data.z_accel,
-
-			  dataToSend.sensor_data.x_gyro,
-			  dataToSend.sensor_data.y_gyro,
-			  dataToSend.sensor_data.z_gyro,
-
-			  dataToSend.sensor_data.x_magnet,
-			  dataToSend.sensor_data.y_magnet,
-			  dataToSend.sensor_data.z_magnet
-
-	  );
-	  //transmit to the USB VCP
-	  CDC_Transmit_FS(buffer, strlen(buffer));
-
+	// formats it as a text line or a binary frame, and sends it over USB.
+	  app_process();
 
 
   }
@@ -269,6 +212,21 @@ void SystemClock_Config(void)
 
 //printf function
 /* USER CODE BEGIN 4 */
+//ICM raw data ready: read the new sample on SPI1 DMA right away
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if(GPIO_Pin == ICM_INT_Pin)
+	{
+		app_data_ready();
+	}
+}
+
+//RTC second boundary, ties the TIM2 sample timestamps to the RTC
+void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef *hrtc)
+{
+	timebase_rtc_second();
+}
+
 int _write(int file, char *ptr, int len)
 {
 	int DataIdx;
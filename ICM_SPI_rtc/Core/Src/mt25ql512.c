@@ -0,0 +1,472 @@
+/**
+ * @file mt25ql512.c
+ * @brief MT25QL512ABB serial NOR flash driver on the QUADSPI
+ *
+ * 1. Reads use the memory-mapped mode with the 4-byte quad I/O fast read (0xEC): the flash appears at
+ *    MT25QL512_MAPPED_BASE and is read with plain loads or memcpy, the QUADSPI fetches on demand.
+ * 2. Page programs use the 4-byte quad I/O program (0x3E), the data phase runs on DMA1 channel 5.
+ * 3. 4 KB subsector and 64 KB sector erases use the 4-byte commands (0x21, 0xDC).
+ * 4. While a program or erase runs, the QUADSPI automatic polling mode reads the flag status register
+ *    every MT25QL512_POLL_INTERVAL cycles and interrupts once the device is ready, the CPU is free meanwhile.
+ *
+ * The commands go out in the extended SPI protocol: instruction on one line, address and data on one or four.
+ * 4-byte address commands are used throughout, so the result does not depend on the address mode register,
+ * which a reset of the flash alone would change.
+ *
+ * A program or an erase leaves the memory-mapped mode, the next read enters it again.
+ *
+ * @note For the command set and timings, consult the Micron MT25Q 512Mb datasheet.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "mt25ql512.h"
+#include "log.h"
+#include <string.h>
+
+
+// operation in the background, the program data phase then the automatic polling
+static volatile bool op_busy;
+static uint8_t op_command;
+static uint32_t op_start_ms;
+static uint32_t op_timeout_ms;
+static mt25ql512_done_cb op_cb;
+static void* op_ctx;
+
+// result of a blocking operation, set by its callback
+typedef struct
+{
+	volatile bool done;
+	volatile bool ok;
+} op_result;
+
+// the QUADSPI is in memory-mapped mode
+static bool mapped;
+
+static mt25ql512_stats stats;
+
+
+/* Static Functions */
+static void make_command(QSPI_CommandTypeDef* cmd, uint8_t instruction, uint32_t address_mode, uint32_t address,
+		uint32_t data_mode, uint32_t len, uint32_t dummy);
+static bool send_command(uint8_t instruction);
+static bool read_register(uint8_t instruction, uint8_t* val, uint16_t len);
+static bool write_enable(void);
+static bool wait_ready(uint32_t timeout_ms);
+
+static bool op_begin(uint8_t command, uint32_t timeout_ms, mt25ql512_done_cb cb, void* ctx);
+static bool op_poll_ready(void);
+static void op_finish(bool ok);
+static void op_done_flag(bool ok, void* ctx);
+static bool op_wait(op_result* result);
+
+
+/* Main Functions */
+/**
+ * @brief Initialize the MT25QL512
+ * A software reset ends what a reset of the MCU may have cut short, then the id is checked.
+ * @return true if the device answers as an MT25QL512.
+ */
+bool mt25ql512_init(void)
+{
+	uint8_t id[3];
+
+	HAL_QSPI_Abort(MT25QL512_QSPI);
+	mapped = false;
+	op_busy = false;
+	memset(&stats, 0, sizeof(stats));
+
+	// a reset during a program or an erase is only taken once it has finished
+	send_command(MT25QL512_RESET_ENABLE);
+	send_command(MT25QL512_RESET_MEMORY);
+	HAL_Delay(1);
+	if(!wait_ready(MT25QL512_RESET_TIMEOUT))
+	{
+		LOG_ERROR(LOG_FLASH_TIMEOUT, MT25QL512_RESET_MEMORY);
+		return false;
+	}
+
+	mt25ql512_read_id(id);
+	if(id[0] != MT25QL512_MANUFACTURER_ID || id[1] != MT25QL512_MEMORY_TYPE || id[2] != MT25QL512_CAPACITY)
+	{
+		LOG_ERROR(LOG_FLASH_ID_MISMATCH, id[0], id[1], id[2]);
+		return false;
+	}
+	LOG_INFO(LOG_FLASH_ID, id[0], id[1], id[2]);
+
+	return send_command(MT25QL512_CLEAR_FLAG_STATUS);
+}
+/**
+ * @brief JEDEC id: manufacturer, memory type, capacity
+ * @return None.
+ */
+void mt25ql512_read_id(uint8_t id[3])
+{
+	memset(id, 0, 3);
+	if(mapped)
+	{
+		HAL_QSPI_Abort(MT25QL512_QSPI);
+		mapped = false;
+	}
+	read_register(MT25QL512_READ_ID, id, 3);
+}
+/**
+ * @brief Start a page program, len bytes at addr, without crossing a page boundary
+ * The callback runs in the QUADSPI interrupt once the device is ready again.
+ * @return false if an operation is running, the range is invalid or the device refused it.
+ */
+bool mt25ql512_program_async(uint32_t addr, const uint8_t* data, uint16_t len, mt25ql512_done_cb cb, void* ctx)
+{
+	QSPI_CommandTypeDef cmd;
+
+	if(len == 0 || addr >= MT25QL512_SIZE || len > MT25QL512_PAGE_SIZE - addr % MT25QL512_PAGE_SIZE)
+		return false;
+	if(!op_begin(MT25QL512_QUAD_IO_PROGRAM_4B, MT25QL512_PROGRAM_TIMEOUT, cb, ctx))
+		return false;
+
+	make_command(&cmd, MT25QL512_QUAD_IO_PROGRAM_4B, QSPI_ADDRESS_4_LINES, addr, QSPI_DATA_4_LINES, len, 0);
+	if(HAL_QSPI_Command(MT25QL512_QSPI, &cmd, MT25QL512_TIMEOUT) != HAL_OK ||
+			HAL_QSPI_Transmit_DMA(MT25QL512_QSPI, (uint8_t*)data) != HAL_OK)
+	{
+		HAL_QSPI_Abort(MT25QL512_QSPI);
+		stats.errors++;
+		op_busy = false;
+		return false;
+	}
+
+	stats.pages++;
+	stats.bytes += len;
+	return true;
+}
+/**
+ * @brief Start the erase of the subsector (4 KB) or sector (64 KB) holding addr
+ * The callback runs in the QUADSPI interrupt once the device is ready again.
+ * @return false if an operation is running, the size is not supported or the device refused it.
+ */
+bool mt25ql512_erase_async(uint32_t addr, uint32_t size, mt25ql512_done_cb cb, void* ctx)
+{
+	QSPI_CommandTypeDef cmd;
+	uint8_t command;
+	uint32_t timeout;
+
+	if(addr >= MT25QL512_SIZE)
+		return false;
+	if(size == MT25QL512_SUBSECTOR_SIZE)
+	{
+		command = MT25QL512_SUBSECTOR_ERASE_4B;
+		timeout = MT25QL512_SUBSECTOR_TIMEOUT;
+	}
+	else if(size == MT25QL512_SECTOR_SIZE)
+	{
+		command = MT25QL512_SECTOR_ERASE_4B;
+		timeout = MT25QL512_SECTOR_TIMEOUT;
+	}
+	else
+		return false;
+
+	if(!op_begin(command, timeout, cb, ctx))
+		return false;
+
+	make_command(&cmd, command, QSPI_ADDRESS_1_LINE, addr & ~(size - 1), QSPI_DATA_NONE, 0, 0);
+	if(HAL_QSPI_Command(MT25QL512_QSPI, &cmd, MT25QL512_TIMEOUT) != HAL_OK || !op_poll_ready())
+	{
+		HAL_QSPI_Abort(MT25QL512_QSPI);
+		stats.errors++;
+		op_busy = false;
+		return false;
+	}
+
+	if(size == MT25QL512_SUBSECTOR_SIZE)
+		stats.subsector_erases++;
+	else
+		stats.sector_erases++;
+	return true;
+}
+/**
+ * @brief true while a program or an erase is running
+ */
+bool mt25ql512_busy(void)
+{
+	return op_busy;
+}
+/**
+ * @brief Abort the operation running past its timeout, its callback runs with ok false
+ * The device may still be busy, the next operation finds out through the flag status register.
+ * @return None.
+ */
+void mt25ql512_poll(void)
+{
+	if(!op_busy || HAL_GetTick() - op_start_ms <= op_timeout_ms)
+		return;
+
+	HAL_QSPI_Abort(MT25QL512_QSPI);
+	LOG_ERROR(LOG_FLASH_TIMEOUT, op_command);
+	__disable_irq();
+	// the status match interrupt may have come meanwhile
+	if(op_busy)
+		op_finish(false);
+	__enable_irq();
+}
+/**
+ * @brief Program len bytes at addr, page by page, and wait for each page
+ * @return false if a page failed.
+ */
+bool mt25ql512_program(uint32_t addr, const uint8_t* data, uint32_t len)
+{
+	op_result result;
+	uint16_t chunk;
+
+	while(len)
+	{
+		chunk = MT25QL512_PAGE_SIZE - addr % MT25QL512_PAGE_SIZE;
+		if(chunk > len)
+			chunk = len;
+
+		result.done = false;
+		if(!mt25ql512_program_async(addr, data, chunk, op_done_flag, &result) || !op_wait(&result))
+			return false;
+
+		addr += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+
+	return true;
+}
+/**
+ * @brief Erase the subsector or sector holding addr and wait for it
+ * @return false if it failed.
+ */
+bool mt25ql512_erase(uint32_t addr, uint32_t size)
+{
+	op_result result = { false, false };
+
+	return mt25ql512_erase_async(addr, size, op_done_flag, &result) && op_wait(&result);
+}
+/**
+ * @brief Address of addr in the memory-mapped window, the QUADSPI enters memory-mapped mode if needed
+ * @return NULL while a program or an erase is running.
+ */
+const uint8_t* mt25ql512_mapped(uint32_t addr)
+{
+	QSPI_CommandTypeDef cmd;
+	QSPI_MemoryMappedTypeDef config;
+
+	if(addr >= MT25QL512_SIZE || op_busy)
+		return NULL;
+
+	if(!mapped)
+	{
+		make_command(&cmd, MT25QL512_QUAD_IO_READ_4B, QSPI_ADDRESS_4_LINES, 0, QSPI_DATA_4_LINES, 0,
+				MT25QL512_QUAD_IO_READ_DUMMY);
+		// nCS goes high after a while without reads, the device drops to standby current
+		config.TimeOutActivation = QSPI_TIMEOUT_COUNTER_ENABLE;
+		config.TimeOutPeriod = MT25QL512_MAPPED_TIMEOUT;
+		if(HAL_QSPI_MemoryMapped(MT25QL512_QSPI, &cmd, &config) != HAL_OK)
+		{
+			stats.errors++;
+			return NULL;
+		}
+		mapped = true;
+	}
+
+	return (const uint8_t*)MT25QL512_MAPPED_BASE + addr;
+}
+/**
+ * @brief Copy len bytes at addr out of the memory-mapped window
+ * @return false while a program or an erase is running or past the end of the device.
+ */
+bool mt25ql512_read(uint32_t addr, uint8_t* buf, uint32_t len)
+{
+	const uint8_t* src;
+
+	if(len > MT25QL512_SIZE - addr || !(src = mt25ql512_mapped(addr)))
+		return false;
+
+	memcpy(buf, src, len);
+	return true;
+}
+/**
+ * @brief Copy of the operation counters
+ * @return None.
+ */
+void mt25ql512_get_stats(mt25ql512_stats* stats_out)
+{
+	__disable_irq();
+	*stats_out = stats;
+	__enable_irq();
+}
+/**
+ * @brief Program data phase sent, the device now programs the page: poll it in the background
+ * @return None.
+ */
+void HAL_QSPI_TxCpltCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	if(qspiHandle != MT25QL512_QSPI || !op_busy)
+		return;
+
+	if(!op_poll_ready())
+		op_finish(false);
+}
+/**
+ * @brief The flag status register reads ready, the operation is over
+ * The register is read once more for the error bits, the automatic polling only matched the ready bit.
+ * @return None.
+ */
+void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	uint8_t flags = 0;
+
+	if(qspiHandle != MT25QL512_QSPI || !op_busy)
+		return;
+
+	if(!read_register(MT25QL512_READ_FLAG_STATUS, &flags, 1) || (flags & MT25QL512_FSR_ERRORS))
+	{
+		LOG_ERROR(LOG_FLASH_FAILED, op_command, flags);
+		send_command(MT25QL512_CLEAR_FLAG_STATUS);
+		op_finish(false);
+		return;
+	}
+
+	op_finish(true);
+}
+/**
+ * @brief DMA or QUADSPI transfer error, the running operation fails
+ * @return None.
+ */
+void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef *qspiHandle)
+{
+	if(qspiHandle != MT25QL512_QSPI || !op_busy)
+		return;
+
+	op_finish(false);
+}
+
+
+/* Static Functions */
+//Extended SPI protocol: the instruction on one line, a 4-byte address and the data on address_mode / data_mode lines
+static void make_command(QSPI_CommandTypeDef* cmd, uint8_t instruction, uint32_t address_mode, uint32_t address,
+		uint32_t data_mode, uint32_t len, uint32_t dummy)
+{
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->InstructionMode = QSPI_INSTRUCTION_1_LINE;
+	cmd->Instruction = instruction;
+	cmd->AddressMode = address_mode;
+	cmd->AddressSize = QSPI_ADDRESS_32_BITS;
+	cmd->Address = address;
+	cmd->AlternateByteMode = QSPI_ALTERNATE_BYTES_NONE;
+	cmd->DataMode = data_mode;
+	cmd->NbData = len;
+	cmd->DummyCycles = dummy;
+	cmd->DdrMode = QSPI_DDR_MODE_DISABLE;
+	cmd->DdrHoldHalfCycle = QSPI_DDR_HHC_ANALOG_DELAY;
+	cmd->SIOOMode = QSPI_SIOO_INST_EVERY_CMD;
+}
+//Instruction only, blocking
+static bool send_command(uint8_t instruction)
+{
+	QSPI_CommandTypeDef cmd;
+
+	make_command(&cmd, instruction, QSPI_ADDRESS_NONE, 0, QSPI_DATA_NONE, 0, 0);
+	return HAL_QSPI_Command(MT25QL512_QSPI, &cmd, MT25QL512_TIMEOUT) == HAL_OK;
+}
+//Instruction then len bytes read on one line, blocking
+static bool read_register(uint8_t instruction, uint8_t* val, uint16_t len)
+{
+	QSPI_CommandTypeDef cmd;
+
+	make_command(&cmd, instruction, QSPI_ADDRESS_NONE, 0, QSPI_DATA_1_LINE, len, 0);
+	return HAL_QSPI_Command(MT25QL512_QSPI, &cmd, MT25QL512_TIMEOUT) == HAL_OK &&
+			HAL_QSPI_Receive(MT25QL512_QSPI, val, MT25QL512_TIMEOUT) == HAL_OK;
+}
+//WRITE ENABLE, checked: a program or an erase without the latch set is silently ignored by the device
+static bool write_enable(void)
+{
+	uint8_t status = 0;
+
+	return send_command(MT25QL512_WRITE_ENABLE) && read_register(MT25QL512_READ_STATUS, &status, 1) &&
+			(status & MT25QL512_SR_WEL);
+}
+//Blocking flag status polling, init only
+static bool wait_ready(uint32_t timeout_ms)
+{
+	uint8_t flags;
+	uint32_t start = HAL_GetTick();
+
+	do
+	{
+		if(read_register(MT25QL512_READ_FLAG_STATUS, &flags, 1) && (flags & MT25QL512_FSR_READY))
+			return true;
+	} while(HAL_GetTick() - start <= timeout_ms);
+
+	return false;
+}
+//Claim the device for one operation: leave the memory-mapped mode and set the write enable latch
+static bool op_begin(uint8_t command, uint32_t timeout_ms, mt25ql512_done_cb cb, void* ctx)
+{
+	if(op_busy)
+		return false;
+
+	if(mapped)
+	{
+		HAL_QSPI_Abort(MT25QL512_QSPI);
+		mapped = false;
+	}
+	if(!write_enable())
+	{
+		stats.errors++;
+		return false;
+	}
+
+	op_command = command;
+	op_start_ms = HAL_GetTick();
+	op_timeout_ms = timeout_ms;
+	op_cb = cb;
+	op_ctx = ctx;
+	op_busy = true;
+	return true;
+}
+//Automatic polling of the ready bit, HAL_QSPI_StatusMatchCallback() once it is set
+static bool op_poll_ready(void)
+{
+	QSPI_CommandTypeDef cmd;
+	QSPI_AutoPollingTypeDef config;
+
+	make_command(&cmd, MT25QL512_READ_FLAG_STATUS, QSPI_ADDRESS_NONE, 0, QSPI_DATA_1_LINE, 1, 0);
+	config.Match = MT25QL512_FSR_READY;
+	config.Mask = MT25QL512_FSR_READY;
+	config.MatchMode = QSPI_MATCH_MODE_AND;
+	config.StatusBytesSize = 1;
+	config.Interval = MT25QL512_POLL_INTERVAL;
+	config.AutomaticStop = QSPI_AUTOMATIC_STOP_ENABLE;
+
+	return HAL_QSPI_AutoPolling_IT(MT25QL512_QSPI, &cmd, &config) == HAL_OK;
+}
+//End the operation and run its callback
+static void op_finish(bool ok)
+{
+	mt25ql512_done_cb cb = op_cb;
+
+	if(!ok)
+		stats.errors++;
+	op_busy = false;
+	if(cb)
+		cb(ok, op_ctx);
+}
+static void op_done_flag(bool ok, void* ctx)
+{
+	op_result* result = ctx;
+
+	result->ok = ok;
+	result->done = true;
+}
+//Wait for a blocking operation, the timeout is checked by mt25ql512_poll()
+static bool op_wait(op_result* result)
+{
+	while(!result->done)
+		mt25ql512_poll();
+
+	return result->ok;
+}
@@ -0,0 +1,130 @@
+/**
+ * @file prof.c
+ * @brief Cycle accurate profiling of the acquisition pipeline with the Cortex-M4 DWT cycle counter
+ *
+ * Every probe keeps its count, min, max, mean and a histogram in powers of 2 of the cycle count,
+ * at 80 MHz one cycle is 12.5 ns and the counter wraps after 53 s, longer stages are not measured correctly.
+ * The results are sent over the USB VCP on request, see app_usb_receive().
+ *
+ * Only built into the Debug configuration, in Release PROF_BEGIN()/PROF_END() compile to nothing.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "prof.h"
+#include <stdio.h>
+#include <string.h>
+
+#if PROF_ENABLED
+
+prof_stats prof_data[PROF_COUNT];
+
+static const char* const prof_names[PROF_COUNT] =
+{
+	[PROF_WAIT] = "wait",
+	[PROF_SPI_READ] = "spi_read",
+	[PROF_PARSE] = "parse",
+	[PROF_READ_TIME] = "read_time",
+	[PROF_ENCODE] = "encode",
+	[PROF_USB_WRITE] = "usb_write",
+	[PROF_PROCESS] = "process",
+};
+
+
+/**
+ * @brief Start the DWT cycle counter and clear the probes
+ * @return None.
+ */
+void prof_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	prof_reset();
+}
+/**
+ * @brief Clear the statistics of every probe
+ * @return None.
+ */
+void prof_reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	int i;
+
+	__disable_irq();
+	for(i = 0; i < PROF_COUNT; i++)
+	{
+		memset(&prof_data[i], 0, sizeof(prof_data[i]));
+		prof_data[i].min = UINT32_MAX;
+	}
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Add one measurement to a probe
+ * @return None.
+ */
+void prof_record(prof_probe probe, uint32_t cycles)
+{
+	prof_stats* s = &prof_data[probe];
+	uint32_t bucket;
+
+	s->count++;
+	s->sum += cycles;
+	if(cycles < s->min)
+		s->min = cycles;
+	if(cycles > s->max)
+		s->max = cycles;
+
+	// index of the highest set bit, cycles < 64 << bucket
+	bucket = 32 - __CLZ(cycles >> PROF_BUCKET_SHIFT);
+	if(bucket >= PROF_BUCKETS)
+		bucket = PROF_BUCKETS - 1;
+	s->hist[bucket]++;
+}
+/**
+ * @brief Copy one probe with the interrupts masked
+ * @return None.
+ */
+void prof_get(prof_probe probe, prof_stats* stats)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	*stats = prof_data[probe];
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Format one probe as "prof <name> n=<count> min=<cycles> mean=<cycles> max=<cycles> us=<mean> hist=<buckets>"
+ * The mean is also given in microseconds at SystemCoreClock, the histogram lists the PROF_BUCKETS counts.
+ * @return string length.
+ */
+uint16_t prof_format(prof_probe probe, char* out, uint16_t size)
+{
+	prof_stats s;
+	uint32_t mean;
+	uint64_t mean_ns;
+	int len, i;
+
+	prof_get(probe, &s);
+	mean = s.count ? (uint32_t)(s.sum / s.count) : 0;
+	mean_ns = (uint64_t)mean * 1000000000u / SystemCoreClock;
+	if(!s.count)
+		s.min = 0;
+
+	len = snprintf(out, size, "prof %s n=%lu min=%lu mean=%lu max=%lu us=%lu.%02lu hist=",
+			prof_names[probe], (unsigned long)s.count, (unsigned long)s.min, (unsigned long)mean,
+			(unsigned long)s.max, (unsigned long)(mean_ns / 1000), (unsigned long)(mean_ns % 1000 / 10));
+	for(i = 0; i < PROF_BUCKETS && len > 0 && len < size; i++)
+		len += snprintf(out + len, size - len, i ? ",%lu" : "%lu", (unsigned long)s.hist[i]);
+	if(len > 0 && len < size)
+		len += snprintf(out + len, size - len, "\r\n");
+
+	if(len < 0)
+		return 0;
+	return len < size ? len : size - 1;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/**
+ * @file ring_buffer.c
+ * @brief Lock-free single producer, single consumer byte ring
+ *
+ * The producer only moves head and the consumer only moves tail, a data memory barrier
+ * orders the buffer access before the index update, so an interrupt and the main loop
+ * can share a ring without disabling interrupts.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "ring_buffer.h"
+#include "main.h"
+#include <string.h>
+
+
+/**
+ * @brief Attach a buffer to a ring and clear it
+ * @return false if size is not a power of 2.
+ */
+bool ring_init(ring_buffer* ring, uint8_t* buf, uint16_t size)
+{
+	if(size == 0 || size > 32768 || (size & (size - 1)) != 0)
+		return false;
+
+	memset(ring, 0, sizeof(*ring));
+	ring->buf = buf;
+	ring->size = size;
+
+	return true;
+}
+/**
+ * @brief Queue len bytes, nothing is written if they do not all fit
+ * Only called from the producer context.
+ * @return false if the data was dropped.
+ */
+bool ring_write(ring_buffer* ring, const uint8_t* data, uint16_t len)
+{
+	uint16_t head = ring->head;
+	uint16_t used = head - ring->tail;
+	uint16_t offset = head & (ring->size - 1);
+	uint16_t first;
+
+	if(len > ring->size - used)
+	{
+		ring->dropped++;
+		ring->dropped_bytes += len;
+		return false;
+	}
+
+	first = ring->size - offset;
+	if(first > len)
+		first = len;
+	memcpy(&ring->buf[offset], data, first);
+	memcpy(ring->buf, data + first, len - first);
+
+	// the data must be in memory before the consumer can see the new head
+	__DMB();
+	ring->head = head + len;
+
+	if(used + len > ring->high_water)
+		ring->high_water = used + len;
+
+	return true;
+}
+/**
+ * @brief Copy up to max bytes out of the ring without removing them
+ * Only called from the consumer context.
+ * @return number of bytes copied.
+ */
+uint16_t ring_peek(ring_buffer* ring, uint8_t* data, uint16_t max)
+{
+	uint16_t tail = ring->tail;
+	uint16_t len = ring->head - tail;
+	uint16_t offset = tail & (ring->size - 1);
+	uint16_t first;
+
+	// the head has to be read before the data it covers
+	__DMB();
+
+	if(len > max)
+		len = max;
+
+	first = ring->size - offset;
+	if(first > len)
+		first = len;
+	memcpy(data, &ring->buf[offset], first);
+	memcpy(data + first, ring->buf, len - first);
+
+	return len;
+}
+/**
+ * @brief Remove len bytes that have been peeked
+ * Only called from the consumer context.
+ * @return None.
+ */
+void ring_consume(ring_buffer* ring, uint16_t len)
+{
+	// the data must have been copied out before the producer may overwrite it
+	__DMB();
+	ring->tail += len;
+}
+/**
+ * @brief Copy and remove up to max bytes
+ * Only called from the consumer context.
+ * @return number of bytes read.
+ */
+uint16_t ring_read(ring_buffer* ring, uint8_t* data, uint16_t max)
+{
+	uint16_t len = ring_peek(ring, data, max);
+
+	ring_consume(ring, len);
+
+	return len;
+}
+/**
+ * @brief Bytes queued
+ * @return number of bytes.
+ */
+uint16_t ring_used(const ring_buffer* ring)
+{
+	return (uint16_t)(ring->head - ring->tail);
+}
+/**
+ * @brief Bytes that can still be written
+ * @return number of bytes.
+ */
+uint16_t ring_free(const ring_buffer* ring)
+{
+	return ring->size - ring_used(ring);
+}
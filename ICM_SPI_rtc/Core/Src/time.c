@@ -7,11 +7,11 @@
  * 2. Receiving time data via USB CDC and updating the STM32's RTC. (for old plan: current data get from PC through USB VCP)
  * 3. Converting UTC time to Beijing time (commented out).
  * 4. Checking for leap years and calculating the number of days in a month.
- * 5. Determining whether daylight saving time adjustments should be applied.
- * 6. Converting UTC time to UK time considering DST.
- * 7. Converting time to seconds since the UNIX epoch (1970).
- * 8. Converting seconds since the UNIX epoch to a date-time structure.
- * 9. Convert GPS Date to seconds.
+ * 5. Converting time to seconds since the UNIX epoch (1970).
+ * 6. Converting seconds since the UNIX epoch to a date-time structure.
+ * 7. Convert GPS Date to seconds.
+ * 8. Reading the RTC as unix time, UTC and local time with a per day cache (read_time), the time zone is tz.c.
+ * 9. Setting the RTC from a unix time (set_rtc_time), used by timesync.c.
  *
  * @author  [Author's Name]
  * @date    [Date]
@@ -19,6 +19,10 @@
  */
 #include "time.h"
 #include "rtc.h"
+#include "log.h"
+#include "timebase.h"
+#include "tz.h"
+#include "usbd_cdc_if.h"
 
 //send timing request to PC from USB VCP
 void time_request(void) {
@@ -37,13 +41,16 @@ void CDC_Received_Callback(uint8_t* Buf, uint32_t Len) {
 }
 
 void Set_RTC_From_Buffer(uint8_t* buffer) {
-    RTC_TimeTypeDef sTime;
-    RTC_DateTypeDef sDate;
+    int year, month, date, hours, minutes, seconds;
     // Assume that the format sent by your PC program is: "YYYY-MM-DD HH:MM:SS"
-    sscanf((char*)buffer, "%04d-%02d-%02d %02d:%02d:%02d", &sDate.Year, &sDate.Month, &sDate.Date, &sTime.Hours, &sTime.Minutes, &sTime.Seconds);
+    // scanned into int first, %d into the uint8_t fields of the RTC structures would overwrite the next fields
+    if(sscanf((char*)buffer, "%4d-%2d-%2d %2d:%2d:%2d", &year, &month, &date, &hours, &minutes, &seconds) != 6)
+        return;
+    if(year < 2000 || year > 2099 || month < 1 || month > 12 || date < 1 || date > daysInMonth(month, year) ||
+            hours > 23 || minutes > 59 || seconds > 59)
+        return;
 
-    HAL_RTC_SetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
-    HAL_RTC_SetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+    set_rtc_time((uint32_t)days_from_civil(year, month, date) * ONEDAYTOSENCOND + hours * xHOUR + minutes * xMINUTE + seconds);
 }
 
 //
@@ -133,54 +140,6 @@ int daysInMonth(int month, int year) {
         default: return 31;
     }
 }
-// Determine whether daylight saving time adjustments should be applied
-int isInDST(nmea_time* time) {
-    int lastSundayOfMarch = 31 - (2 + 31 - time->year) % 7;
-    int lastSundayOfOctober = 31 - (5 + 31 - time->year) % 7;
-
-    if(time->month > 3 && time->month < 10) return 1;  // DST is active between last Sunday of March and October
-    if(time->month == 3 && time->date > lastSundayOfMarch) return 1;  // After the last Sunday of March
-    if(time->month == 3 && time->date == lastSundayOfMarch && time->hour >= 1) return 1;  // On the last Sunday of March but after 1am UTC
-    if(time->month == 10 && time->date < lastSundayOfOctober) return 1;  // Before the last Sunday of October
-    if(time->month == 10 && time->date == lastSundayOfOctober && time->hour < 1) return 1;  // On the last Sunday of October but before 1am UTC
-
-    return 0;  // If none of the above conditions is met, it's not DST
-}
-
-void UTC_to_UKtime(nmea_time* utc_time) {
-    int year, month, day, hour;
-
-    year = utc_time->year;
-    month = utc_time->month;
-    day = utc_time->date;
-    hour = utc_time->hour;
-
-    if(isInDST(utc_time)) {
-        hour++; // Move one hour forward for DST
-    }
-
-    // Check for time overflow after adjustment
-    if(hour >= 24) {
-        hour -= 24;
-        day++;
-        if(day > daysInMonth(month, year)) {
-            day = 1;
-            month++;
-            if(month > 12) {
-                month = 1;
-                year++;
-            }
-        }
-    }
-
-    NMEA_result.local_time.year = year;
-    NMEA_result.local_time.month = month;
-    NMEA_result.local_time.date = day;
-    NMEA_result.local_time.hour = hour;
-    NMEA_result.local_time.min = utc_time->min;
-    NMEA_result.local_time.sec = utc_time->sec;
-}
-
 unsigned int  xDate2Seconds(_xtime *time)
 {
   static unsigned int  month[12]={
@@ -330,47 +289,137 @@ uint32_t ConvertDateToSecond(const uint8_t *date)
     return seconds;
 }
 
+/**
+ * @brief Days since 1970-01-01 of a proleptic Gregorian date, constant time
+ * H. Hinnant's days_from_civil(): the year is shifted to start in March, so the leap day is the last day of it,
+ * then every 400 year era has the same 146097 days.
+ * @return days, negative before 1970.
+ */
+int32_t days_from_civil(int32_t year, uint32_t month, uint32_t day)
+{
+	int32_t era;
+	uint32_t yoe, doy, doe;
+
+	year -= month <= 2;
+	era = (year >= 0 ? year : year - 399) / 400;
+	yoe = (uint32_t)(year - era * 400);								// [0, 399]
+	doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;	// [0, 365]
+	doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;					// [0, 146096]
+
+	return era * 146097 + (int32_t)doe - 719468;
+}
+/**
+ * @brief Reverse of days_from_civil(), fills year, month and date of time
+ * @return None.
+ */
+void civil_from_days(int32_t days, nmea_time* time)
+{
+	int32_t era;
+	uint32_t doe, yoe, doy, mp;
+
+	days += 719468;
+	era = (days >= 0 ? days : days - 146096) / 146097;
+	doe = (uint32_t)(days - era * 146097);
+	yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	mp = (5 * doy + 2) / 153;
+
+	time->date = doy - (153 * mp + 2) / 5 + 1;
+	time->month = mp < 10 ? mp + 3 : mp - 9;
+	time->year = (int32_t)yoe + era * 400 + (time->month <= 2);
+}
+/* Cached date dependent part of read_time(), recomputed only when the RTC date changes */
+typedef struct
+{
+	uint8_t year;				// RTC date the cache is for, month 0: nothing cached yet
+	uint8_t month;
+	uint8_t date;
+	uint32_t day_base;			// unix time of 00:00:00 UTC
+	nmea_time yesterday;		// the local date is at most one day away from the UTC date
+	nmea_time today;			// UTC date
+	nmea_time tomorrow;
+} day_cache;
+
+static day_cache time_cache;
+
+//recompute the date dependent part, once per day
+static void update_day_cache(const RTC_DateTypeDef* date)
+{
+	int32_t days = days_from_civil(2000 + date->Year, date->Month, date->Date);
+
+	time_cache.year = date->Year;
+	time_cache.month = date->Month;
+	time_cache.date = date->Date;
+	time_cache.day_base = (uint32_t)days * ONEDAYTOSENCOND;
+
+	memset(&time_cache.yesterday, 0, sizeof(nmea_time));
+	memset(&time_cache.today, 0, sizeof(nmea_time));
+	memset(&time_cache.tomorrow, 0, sizeof(nmea_time));
+	civil_from_days(days - 1, &time_cache.yesterday);
+	civil_from_days(days, &time_cache.today);
+	civil_from_days(days + 1, &time_cache.tomorrow);
+}
+
+/**
+ * @brief Read the RTC and convert it to unix time, UTC time and local time
+ * The unix time is computed from the binary RTC fields, the date dependent part (days since 1970)
+ * is cached and only recomputed when the date changes, the local time is one compare and an add (tz_local()),
+ * so a sample costs a few dozen cycles on top of the RTC register reads.
+ * @return time data.
+ */
 time_data read_time(uint32_t startTime){
 
 	  time_data result;
-	  // get RTC time and Date
+	  uint32_t seconds;
+	  uint32_t local;
+	  // get RTC time and Date, the date has to be read after the time to unlock the shadow registers
 	  HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
 	  HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
 
+	  if(sDate.Date != time_cache.date || sDate.Month != time_cache.month || sDate.Year != time_cache.year)
+		  update_day_cache(&sDate);
+
 	  // show date and time
 	  /* Display date Format : yy/mm/dd */
-	  printf("%04d/%02d/%02d\r\n",2000 + sDate.Year, sDate.Month, sDate.Date);
+	  LOG_DEBUG(LOG_RTC_DATE, 2000 + sDate.Year, sDate.Month, sDate.Date);
 	  /* Display time Format : hh:mm:ss */
-	  printf("UTC Time is: %02d:%02d:%02d\r\n",sTime.Hours, sTime.Minutes, sTime.Seconds);
-
-	  // create an array that converts the date and time obtained from the RTC into "DDMMYY,HHMMSS.SSS" format.
-	  uint8_t rtcDate[14];
-	  sprintf((char *)rtcDate, "%02d%02d%02d,%02d%02d%02d.000",
-	          sDate.Date, sDate.Month, sDate.Year,
-	          sTime.Hours, sTime.Minutes, sTime.Seconds);
+	  LOG_DEBUG(LOG_RTC_TIME, sTime.Hours, sTime.Minutes, sTime.Seconds);
 
 	  // Convert RTC date and time to Unix timestamp
-	  uint32_t timestamp = ConvertDateToSecond(rtcDate);
-	  printf("Unix Timestamp: %u\n", timestamp);
-
-	    // Populate the NMEA time structure with the date and time of the RTC
-	  nmea_time testTime = {
-			  .year = 2000 + sDate.Year,
-			  .month = sDate.Month,
-			  .date = sDate.Date,
-			  .hour = sTime.Hours,
-			  .min = sTime.Minutes,
-			  .sec = sTime.Seconds
-	  };
-
-
-	   // Use UTC_to_UKtime function to convert time
-	  UTC_to_UKtime(&testTime);
-
-	   // print local uk time
-	  printf("Local UK time: %04d-%02d-%02d %02d:%02d:%02d\n",
-	           NMEA_result.local_time.year, NMEA_result.local_time.month, NMEA_result.local_time.date,
-	           NMEA_result.local_time.hour, NMEA_result.local_time.min, NMEA_result.local_time.sec);
+	  seconds = sTime.Hours * xHOUR + sTime.Minutes * xMINUTE + sTime.Seconds;
+	  result.unix_timestamp = time_cache.day_base + seconds;
+	  LOG_DEBUG(LOG_UNIX_TIME, result.unix_timestamp);
+
+	  result.utc_time = time_cache.today;
+	  result.utc_time.hour = sTime.Hours;
+	  result.utc_time.min = sTime.Minutes;
+	  result.utc_time.sec = sTime.Seconds;
+
+	  // local time, the date is the day before, the same day or the day after
+	  local = tz_local(result.unix_timestamp);
+	  if(local < time_cache.day_base)
+	  {
+		  result.local_time = time_cache.yesterday;
+		  seconds = local - (time_cache.day_base - ONEDAYTOSENCOND);
+	  }
+	  else if(local - time_cache.day_base >= ONEDAYTOSENCOND)
+	  {
+		  result.local_time = time_cache.tomorrow;
+		  seconds = local - time_cache.day_base - ONEDAYTOSENCOND;
+	  }
+	  else
+	  {
+		  result.local_time = time_cache.today;
+		  seconds = local - time_cache.day_base;
+	  }
+	  result.local_time.hour = seconds / xHOUR;
+	  result.local_time.min = seconds / xMINUTE % 60;
+	  result.local_time.sec = seconds % 60;
+
+	   // print local time
+	  LOG_DEBUG(LOG_LOCAL_TIME,
+	           result.local_time.year, result.local_time.month, result.local_time.date,
+	           result.local_time.hour, result.local_time.min, result.local_time.sec);
 
 	  // Calculate the elapsed time since the program was run
 	  uint32_t elapsedTime = HAL_GetTick() - startTime;
@@ -378,18 +427,48 @@ time_data read_time(uint32_t startTime){
 	  uint32_t elapsedMinutes = elapsedSeconds / 60;
 	  elapsedSeconds %= 60;
 
-	  printf("Elapsed time: %02u:%02u\n", elapsedMinutes, elapsedSeconds);
-	  printf("\r\n");
+	  LOG_DEBUG(LOG_ELAPSED, elapsedMinutes, elapsedSeconds);
 
-	  result.unix_timestamp = timestamp;
-	  // Assume that the NMEA_time structure can be directly assigned a value.
-	  // If not, please assign a value to each field separately.
-	  result.utc_time = testTime;
-	  result.uk_time = NMEA_result.local_time;
 	  result.elapsed_minutes = elapsedMinutes;
 	  result.elapsed_seconds = elapsedSeconds;
 
 	  return result;
 }
 
-
+/**
+ * @brief Set the RTC calendar to a unix time
+ * Setting the time restarts the RTC prescalers, the new second starts now. The sample timestamps are
+ * rebuilt from the new calendar (timebase_reset()).
+ * @return HAL status.
+ */
+HAL_StatusTypeDef set_rtc_time(uint32_t unix_time)
+{
+	RTC_TimeTypeDef rtc_time = {0};
+	RTC_DateTypeDef rtc_date = {0};
+	nmea_time date;
+	int32_t days = unix_time / ONEDAYTOSENCOND;
+	uint32_t seconds = unix_time % ONEDAYTOSENCOND;
+
+	civil_from_days(days, &date);
+	// the RTC only counts years 2000 ~ 2099
+	if(date.year < 2000 || date.year > 2099)
+		return HAL_ERROR;
+
+	rtc_time.Hours = seconds / xHOUR;
+	rtc_time.Minutes = seconds / xMINUTE % 60;
+	rtc_time.Seconds = seconds % 60;
+	rtc_time.DayLightSaving = RTC_DAYLIGHTSAVING_NONE;
+	rtc_time.StoreOperation = RTC_STOREOPERATION_RESET;
+	rtc_date.Year = date.year - 2000;
+	rtc_date.Month = date.month;
+	rtc_date.Date = date.date;
+	// 1970-01-01 was a Thursday, RTC_WEEKDAY_MONDAY is 1
+	rtc_date.WeekDay = (days + 3) % 7 + 1;
+
+	if(HAL_RTC_SetTime(&hrtc, &rtc_time, RTC_FORMAT_BIN) != HAL_OK ||
+			HAL_RTC_SetDate(&hrtc, &rtc_date, RTC_FORMAT_BIN) != HAL_OK)
+		return HAL_ERROR;
+
+	timebase_reset();
+	return HAL_OK;
+}
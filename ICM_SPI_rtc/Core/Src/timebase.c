@@ -0,0 +1,246 @@
+/**
+ * @file timebase.c
+ * @brief Microsecond sample timestamps from the RTC and the free running TIM2 counter
+ *
+ * The RTC gives the unix second, with 1/256 s sub-seconds (SynchPrediv 255). TIM2 counts at 1 MHz and is latched
+ * in the data ready interrupt. The two are tied together at every RTC second boundary:
+ * 1. RTC alarm A fires when the second increments, the interrupt latches the TIM2 count.
+ * 2. The main loop reads the RTC once, the sub-seconds tell which second the latched boundary started,
+ *    even if the loop was late, and the boundary becomes the anchor.
+ * 3. The TIM2 count between two boundaries is the TIM2 rate in RTC seconds, every timestamp is scaled by it,
+ *    so the timestamps follow the RTC and do not drift with the PLL clock.
+ *
+ * Until the first boundary the anchor comes from the RTC sub-seconds and the rate is nominal.
+ *
+ * timesync.c corrects the phase with timebase_correct(): the RTC is shifted by whole sub-seconds
+ * (HAL_RTCEx_SetSynchroShift()), the remainder below one sub-second is added to the timestamps in software.
+ * It is kept in a backup register, so that it survives a reset with the RTC.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "timebase.h"
+#include "rtc.h"
+#include "time.h"
+
+
+/* Anchor, written by the main loop */
+typedef struct
+{
+	uint64_t epoch_us;			// unix time of the boundary, microseconds
+	uint32_t ticks;				// TIM2 count at the boundary
+	uint32_t us_per_tick;		// 1.31 fixed point, microseconds per TIM2 tick, 1 << 31 at the nominal rate
+	bool valid;
+} timebase_anchor;
+
+static timebase_anchor anchor;
+// phase correction below one RTC sub-second, added to every timestamp
+static int32_t offset_us;
+
+/* Written by the RTC alarm interrupt */
+static volatile uint32_t boundary_ticks;
+static volatile uint32_t boundary_count;
+static volatile uint32_t ticks_per_second;
+static volatile uint32_t rejected_seconds;
+// the second ending at this boundary count is the first one measured, after an RTC shift
+static volatile uint32_t measure_from;
+static uint32_t anchored_count;
+
+
+static uint32_t read_rtc(uint32_t* fraction_us, uint32_t* ticks);
+
+
+/**
+ * @brief Start TIM2 and the once per second RTC alarm interrupt
+ * @return None.
+ */
+void timebase_init(void)
+{
+	anchor.valid = false;
+	ticks_per_second = 0;
+	boundary_count = 0;
+	anchored_count = 0;
+	measure_from = 0;
+	// kept through a reset together with the calendar (MX_RTC_Init()), 0 on a fresh calendar
+	offset_us = (int32_t)HAL_RTCEx_BKUPRead(&hrtc, RTC_BKUP_PHASE_REG);
+
+	// alarm A has every field masked (MX_RTC_Init()), its interrupt comes when the second increments
+	HAL_TIM_Base_Start(&htim2);
+}
+/**
+ * @brief RTC second boundary, called from HAL_RTC_AlarmAEventCallback()
+ * Only latches TIM2, the RTC is read by the main loop: reading it here could see the shadow registers
+ * locked by an interrupted read_time().
+ * @return None.
+ */
+void timebase_rtc_second(void)
+{
+	uint32_t now = timebase_ticks();
+	uint32_t ticks = now - boundary_ticks;
+
+	if(boundary_count && boundary_count >= measure_from)
+	{
+		if(ticks > TIMEBASE_TICK_HZ - TIMEBASE_TOLERANCE && ticks < TIMEBASE_TICK_HZ + TIMEBASE_TOLERANCE)
+			ticks_per_second = ticks;
+		else
+			rejected_seconds++;
+	}
+
+	boundary_ticks = now;
+	boundary_count++;
+}
+/**
+ * @brief Move the anchor to the latest RTC second boundary
+ * Cheap when there was no new boundary, call it on every main loop pass.
+ * @return None.
+ */
+void timebase_update(void)
+{
+	uint32_t count, ticks, rate, fraction_us, now, epoch, elapsed_us;
+	uint32_t primask;
+
+	if(boundary_count == anchored_count && anchor.valid)
+		return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	count = boundary_count;
+	ticks = boundary_ticks;
+	rate = ticks_per_second;
+	__set_PRIMASK(primask);
+
+	if(!rate)
+		rate = TIMEBASE_TICK_HZ;
+
+	epoch = read_rtc(&fraction_us, &now);
+
+	if(count == 0)
+	{
+		// no boundary yet, estimate the last one from the sub-seconds
+		ticks = now - (uint32_t)((uint64_t)fraction_us * rate / 1000000);
+	}
+	else
+	{
+		// the boundary was latched before the RTC read, whole seconds ago plus the current fraction
+		elapsed_us = (uint32_t)((uint64_t)(now - ticks) * 1000000 / rate);
+		epoch -= (elapsed_us - fraction_us + 500000) / 1000000;
+	}
+
+	anchor.epoch_us = (uint64_t)epoch * 1000000;
+	anchor.ticks = ticks;
+	anchor.us_per_tick = (uint32_t)(((uint64_t)1000000 << 31) / rate);
+	anchor.valid = true;
+	anchored_count = count;
+}
+/**
+ * @brief Drop the anchor, the next timebase_update() rebuilds it from the RTC sub-seconds
+ * @return None.
+ */
+void timebase_reset(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	anchor.valid = false;
+	boundary_count = 0;
+	ticks_per_second = 0;
+	measure_from = 0;
+	__set_PRIMASK(primask);
+	anchored_count = 0;
+	offset_us = 0;
+	HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_PHASE_REG, 0);
+}
+/**
+ * @brief Move the timestamps by us, called by timesync.c with the measured offset
+ * The RTC is shifted by the nearest whole number of sub-seconds, so that the calendar follows as well,
+ * what is left is applied in software. The anchor moves with the RTC, and the second that contains
+ * the shift is not used to measure the TIM2 rate.
+ * us must be below one second.
+ * @return None.
+ */
+void timebase_correct(int32_t us)
+{
+	uint32_t steps = hrtc.Init.SynchPrediv + 1;
+	int64_t total = (int64_t)offset_us + us;
+	int32_t shift, shift_us;
+	uint32_t primask;
+
+	// nearest whole sub-second, ADD1S advances the RTC by one second, SUBFS delays it by SUBFS sub-seconds
+	shift = (int32_t)((total * steps + (total >= 0 ? 500000 : -500000)) / 1000000);
+	if(shift >= (int32_t)steps)
+		shift = steps - 1;
+	if(shift <= -(int32_t)steps)
+		shift = -(int32_t)(steps - 1);
+
+	if(shift)
+	{
+		measure_from = boundary_count + 2;
+		if(HAL_RTCEx_SetSynchroShift(&hrtc, shift > 0 ? RTC_SHIFTADD1S_SET : RTC_SHIFTADD1S_RESET,
+				shift > 0 ? steps - shift : -shift) != HAL_OK)
+			shift = 0;
+	}
+	shift_us = (int32_t)((int64_t)shift * 1000000 / steps);
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(shift)
+	{
+		// boundaries latched before the shift completed do not anchor, the one after it is not measured
+		anchor.epoch_us += shift_us;
+		anchored_count = boundary_count;
+		measure_from = boundary_count + 1;
+	}
+	offset_us = (int32_t)(total - shift_us);
+	__set_PRIMASK(primask);
+	HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_PHASE_REG, (uint32_t)offset_us);
+}
+/**
+ * @brief Timestamp of a TIM2 count, which may be a little older than the anchor
+ * Main loop only, like timebase_update().
+ * @return microseconds since 1970-01-01 UTC, 0 before timebase_update() has run.
+ */
+uint64_t timebase_us(uint32_t ticks)
+{
+	int32_t delta;
+
+	if(!anchor.valid)
+		return 0;
+
+	delta = (int32_t)(ticks - anchor.ticks);
+
+	return anchor.epoch_us + offset_us + (((int64_t)delta * anchor.us_per_tick) >> 31);
+}
+/**
+ * @brief Counters of the RTC second boundaries
+ * @return None.
+ */
+void timebase_get_stats(timebase_stats* stats)
+{
+	stats->seconds = boundary_count;
+	stats->rejected = rejected_seconds;
+	stats->ticks_per_second = ticks_per_second ? ticks_per_second : TIMEBASE_TICK_HZ;
+	stats->locked = ticks_per_second != 0;
+	stats->offset_us = offset_us;
+}
+
+
+/* Static Functions */
+//unix time of the RTC, with the sub-seconds and the TIM2 count at the read
+static uint32_t read_rtc(uint32_t* fraction_us, uint32_t* ticks)
+{
+	RTC_TimeTypeDef rtc_time;
+	RTC_DateTypeDef rtc_date;
+
+	*ticks = timebase_ticks();
+	HAL_RTC_GetTime(&hrtc, &rtc_time, RTC_FORMAT_BIN);
+	HAL_RTC_GetDate(&hrtc, &rtc_date, RTC_FORMAT_BIN);
+
+	// SubSeconds counts down from SecondFraction (SynchPrediv) to 0
+	*fraction_us = (uint32_t)((uint64_t)(rtc_time.SecondFraction - rtc_time.SubSeconds) * 1000000 /
+			(rtc_time.SecondFraction + 1));
+
+	return (uint32_t)days_from_civil(2000 + rtc_date.Year, rtc_date.Month, rtc_date.Date) * ONEDAYTOSENCOND +
+			rtc_time.Hours * xHOUR + rtc_time.Minutes * xMINUTE + rtc_time.Seconds;
+}
@@ -0,0 +1,266 @@
+/**
+ * @file timesync.c
+ * @brief Synchronisation of the RTC to the PC clock over the USB VCP
+ *
+ * 1. Every TIMESYNC_INTERVAL_MS a round of TIMESYNC_BURST requests is sent, the PC answers each one with
+ *    its receive and transmit times (timesync.h). USB latency is mostly one way (batching, host polling),
+ *    so only the exchange with the shortest round trip of a round is used, its offset error is at most half of it.
+ * 2. The offset of that exchange corrects the phase: beyond TIMESYNC_STEP_US the RTC calendar is set,
+ *    otherwise timebase_correct() shifts the RTC and the sample timestamps.
+ * 3. The phase corrections add up to the drift of the RTC crystal, once they are large enough to measure
+ *    (TIMESYNC_DRIFT_MIN_US) the frequency error is corrected with the RTC smooth calibration,
+ *    which works in steps of 0.954 ppm over 32 s. The timestamps follow the RTC (timebase.c).
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "timesync.h"
+#include "timebase.h"
+#include "time.h"
+#include "rtc.h"
+#include "log.h"
+
+
+/* Current round */
+typedef struct
+{
+	uint16_t first_seq;				// sequence number of the first request
+	uint8_t sent;
+	uint32_t next_ms;				// HAL tick of the next request, or of the end of the round
+	uint64_t t1[TIMESYNC_BURST];
+	bool best_valid;
+	int64_t best_offset;
+	uint32_t best_delay;
+	uint64_t best_t4;
+} timesync_round;
+
+/* Drift since the last calibration change */
+typedef struct
+{
+	bool valid;
+	uint64_t start_us;
+	int64_t phase_us;				// sum of the phase corrections
+} timesync_baseline;
+
+static timesync_round round_state;
+static timesync_baseline baseline;
+static timesync_stats stats;
+static int32_t calib_pulses;
+
+
+static void end_round(void);
+static void correct(int64_t offset_us, uint64_t at_us);
+static void calibrate(int32_t ppb);
+static int32_t pulses_to_ppb(int32_t pulses);
+
+
+/**
+ * @brief Start the first round TIMESYNC_START_MS from now
+ * The calibration and the last round come from the RTC backup registers, all 0 on a fresh calendar.
+ * @return None.
+ */
+void timesync_init(void)
+{
+	memset(&stats, 0, sizeof(stats));
+	memset(&round_state, 0, sizeof(round_state));
+	baseline.valid = false;
+	calib_pulses = (int32_t)HAL_RTCEx_BKUPRead(&hrtc, RTC_BKUP_CALIB_REG);
+	stats.calib_ppb = pulses_to_ppb(calib_pulses);
+	stats.last_sync = HAL_RTCEx_BKUPRead(&hrtc, RTC_BKUP_SYNC_TIME_REG);
+	stats.offset_us = (int32_t)HAL_RTCEx_BKUPRead(&hrtc, RTC_BKUP_SYNC_OFFSET_REG);
+	stats.delay_us = HAL_RTCEx_BKUPRead(&hrtc, RTC_BKUP_SYNC_DELAY_REG);
+	round_state.next_ms = HAL_GetTick() + TIMESYNC_START_MS;
+}
+/**
+ * @brief Next request of the round, if one is due
+ * @return true and the sequence number and t1 of the request, which must be sent right away.
+ */
+bool timesync_request(uint16_t* seq, uint64_t* t1_us)
+{
+	uint64_t now_us;
+
+	if(round_state.sent == TIMESYNC_BURST || (int32_t)(HAL_GetTick() - round_state.next_ms) < 0)
+		return false;
+
+	now_us = timebase_us(timebase_ticks());
+	// no timestamps yet
+	if(now_us == 0)
+		return false;
+
+	*seq = round_state.first_seq + round_state.sent;
+	*t1_us = now_us;
+	round_state.t1[round_state.sent++] = now_us;
+	round_state.next_ms = HAL_GetTick() + TIMESYNC_SPACING_MS;
+	stats.requests++;
+
+	return true;
+}
+/**
+ * @brief Use the best exchange once the round is over
+ * @return None.
+ */
+void timesync_process(void)
+{
+	// the last reply of the round had TIMESYNC_SPACING_MS to arrive
+	if(round_state.sent == TIMESYNC_BURST && (int32_t)(HAL_GetTick() - round_state.next_ms) >= 0)
+		end_round();
+}
+/**
+ * @brief Reply from the PC, keep the exchange if it is of this round and has the shortest round trip so far
+ * @return None.
+ */
+void timesync_receive(uint16_t seq, uint64_t t2_us, uint64_t t3_us, uint32_t ticks)
+{
+	uint16_t index = (uint16_t)(seq - round_state.first_seq);
+	uint64_t t1, t4;
+	int64_t offset, delay;
+
+	if(index >= round_state.sent)
+		return;
+	stats.replies++;
+
+	t1 = round_state.t1[index];
+	t4 = timebase_us(ticks);
+	delay = (int64_t)(t4 - t1) - (int64_t)(t3_us - t2_us);
+	offset = ((int64_t)(t2_us - t1) + (int64_t)(t3_us - t4)) / 2;
+
+	if(delay < 0 || delay > TIMESYNC_MAX_DELAY_US)
+		return;
+	if(round_state.best_valid && delay >= round_state.best_delay)
+		return;
+
+	round_state.best_valid = true;
+	round_state.best_offset = offset;
+	round_state.best_delay = (uint32_t)delay;
+	round_state.best_t4 = t4;
+}
+/**
+ * @brief Synchronise now instead of at the next round
+ * A round that is already running is left to finish. A PC time far off the device time sets the calendar
+ * right away, as the correction of a round would.
+ * @return None.
+ */
+void timesync_now(uint64_t pc_us)
+{
+	int64_t offset_us = (int64_t)(pc_us - timebase_us(timebase_ticks()));
+	uint32_t delay_ms = 0;
+
+	if(pc_us != 0 && (offset_us >= TIMESYNC_STEP_US || offset_us <= -TIMESYNC_STEP_US))
+	{
+		if(set_rtc_time((uint32_t)((pc_us + 500000) / 1000000)) == HAL_OK)
+			stats.steps++;
+		baseline.valid = false;
+		delay_ms = TIMESYNC_SETTLE_MS;
+	}
+
+	if(round_state.sent == 0)
+		round_state.next_ms = HAL_GetTick() + delay_ms;
+}
+/**
+ * @brief Copy the synchronisation counters
+ * @return None.
+ */
+void timesync_get_stats(timesync_stats* stats_out)
+{
+	*stats_out = stats;
+}
+
+
+/* Static Functions */
+//correct with the best exchange and schedule the next round
+static void end_round(void)
+{
+	uint32_t interval = TIMESYNC_INTERVAL_MS;
+
+	if(round_state.best_valid)
+	{
+		stats.rounds++;
+		stats.offset_us = (int32_t)(round_state.best_offset > INT32_MAX ? INT32_MAX :
+				round_state.best_offset < INT32_MIN ? INT32_MIN : round_state.best_offset);
+		stats.delay_us = round_state.best_delay;
+		stats.last_sync = (uint32_t)((round_state.best_t4 + round_state.best_offset) / 1000000);
+		HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_SYNC_TIME_REG, stats.last_sync);
+		HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_SYNC_OFFSET_REG, (uint32_t)stats.offset_us);
+		HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_SYNC_DELAY_REG, stats.delay_us);
+		LOG_INFO(LOG_SYNC_ROUND, stats.offset_us, stats.delay_us, stats.calib_ppb);
+
+		correct(round_state.best_offset, round_state.best_t4);
+		if(!baseline.valid)
+			interval = TIMESYNC_SETTLE_MS;
+	}
+
+	round_state.first_seq += TIMESYNC_BURST;
+	round_state.sent = 0;
+	round_state.best_valid = false;
+	round_state.next_ms = HAL_GetTick() + interval;
+}
+//phase: set or shift the RTC, frequency: smooth calibration from the phase corrected since the last change
+static void correct(int64_t offset_us, uint64_t at_us)
+{
+	int64_t elapsed_us, drift_ppb;
+	uint64_t now_us;
+
+	if(offset_us >= TIMESYNC_STEP_US || offset_us <= -TIMESYNC_STEP_US)
+	{
+		// the calendar restarts at the nearest whole second, the next round shifts the rest
+		now_us = timebase_us(timebase_ticks()) + offset_us;
+		if(set_rtc_time((uint32_t)((now_us + 500000) / 1000000)) == HAL_OK)
+			stats.steps++;
+		baseline.valid = false;
+		return;
+	}
+
+	timebase_correct((int32_t)offset_us);
+	stats.synced = true;
+
+	// the first offset after a step is not drift
+	if(!baseline.valid)
+	{
+		baseline.valid = true;
+		baseline.start_us = at_us;
+		baseline.phase_us = 0;
+		return;
+	}
+
+	baseline.phase_us += offset_us;
+	elapsed_us = (int64_t)(at_us - baseline.start_us);
+	if(elapsed_us <= 0)
+		return;
+	if(baseline.phase_us < TIMESYNC_DRIFT_MIN_US && baseline.phase_us > -TIMESYNC_DRIFT_MIN_US &&
+			elapsed_us < (int64_t)TIMESYNC_DRIFT_MAX_S * 1000000)
+		return;
+
+	// a device running slow needs positive offsets, the RTC has to speed up
+	drift_ppb = baseline.phase_us * 1000000000 / elapsed_us;
+	calibrate(stats.calib_ppb + (int32_t)drift_ppb);
+	baseline.start_us = at_us;
+	baseline.phase_us = 0;
+}
+//RTC smooth calibration, 32 s cycle: CALP adds 512 RTCCLK pulses, CALM masks 0 ~ 511, one pulse is 2^-20 = 0.954 ppm
+static void calibrate(int32_t ppb)
+{
+	int32_t pulses = (int32_t)(((int64_t)ppb * 1048576 + (ppb >= 0 ? 500000000 : -500000000)) / 1000000000);
+
+	if(pulses > 512)
+		pulses = 512;
+	if(pulses < -511)
+		pulses = -511;
+	if(pulses == calib_pulses)
+		return;
+
+	if(HAL_RTCEx_SetSmoothCalib(&hrtc, RTC_SMOOTHCALIB_PERIOD_32SEC,
+			pulses > 0 ? RTC_SMOOTHCALIB_PLUSPULSES_SET : RTC_SMOOTHCALIB_PLUSPULSES_RESET,
+			pulses > 0 ? 512 - pulses : -pulses) != HAL_OK)
+		return;
+
+	calib_pulses = pulses;
+	stats.calib_ppb = pulses_to_ppb(pulses);
+	stats.calibrations++;
+	HAL_RTCEx_BKUPWrite(&hrtc, RTC_BKUP_CALIB_REG, (uint32_t)pulses);
+}
+static int32_t pulses_to_ppb(int32_t pulses)
+{
+	return (int32_t)((int64_t)pulses * 1000000000 / 1048576);
+}
@@ -0,0 +1,360 @@
+/**
+ * @file tz.c
+ * @brief Local time from POSIX TZ rules, replacing the hardcoded UK summer time
+ *
+ * 1. tz_set() parses the rule once (tz.h): the standard and summer time offsets and the two rule days.
+ * 2. The rule days of the year before, this year and the next are turned into unix times, the last
+ *    change before the time being converted and the first one after it give the span with a constant offset.
+ * 3. Until the time leaves that span tz_local() is one compare and an add, the span is recomputed twice a year.
+ *
+ * Zones are selected at runtime with COMMAND_SET_TIME_ZONE on the USB VCP (command.h).
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "tz.h"
+#include "time.h"
+#include "log.h"
+
+
+/* Rule day */
+typedef enum
+{
+	tz_rule_month,					// Mm.w.d
+	tz_rule_julian,					// Jn, 1 ~ 365, no February 29
+	tz_rule_day						// n, 0 ~ 365
+} tz_rule_type;
+
+typedef struct
+{
+	tz_rule_type type;
+	uint8_t month;
+	uint8_t week;					// 1 ~ 4, 5: last
+	uint8_t weekday;				// 0: Sunday
+	uint16_t day;
+	int32_t time;					// local time of the change, seconds after midnight
+} tz_rule;
+
+typedef struct
+{
+	int32_t std_offset;				// seconds east of UTC
+	int32_t dst_offset;
+	bool has_dst;
+	tz_rule start;					// to summer time, in local standard time
+	tz_rule end;					// back to standard time, in local summer time
+} tz_zone;
+
+/* Unix times [start, start + length) have the same offset */
+typedef struct
+{
+	uint32_t start;
+	uint32_t length;
+	int32_t offset;
+} tz_span;
+
+const tz_preset tz_presets[] =
+{
+	{"UTC",					"UTC0"},
+	{"Europe/London",		"GMT0BST,M3.5.0/1,M10.5.0"},
+	{"Europe/Berlin",		"CET-1CEST,M3.5.0,M10.5.0/3"},
+	{"Europe/Athens",		"EET-2EEST,M3.5.0/3,M10.5.0/4"},
+	{"America/New_York",	"EST5EDT,M3.2.0,M11.1.0"},
+	{"America/Chicago",		"CST6CDT,M3.2.0,M11.1.0"},
+	{"America/Denver",		"MST7MDT,M3.2.0,M11.1.0"},
+	{"America/Los_Angeles",	"PST8PDT,M3.2.0,M11.1.0"},
+	{"Asia/Kolkata",		"IST-5:30"},
+	{"Asia/Shanghai",		"CST-8"},
+	{"Asia/Tokyo",			"JST-9"},
+	{"Australia/Sydney",	"AEST-10AEDT,M10.1.0,M4.1.0/3"},
+	{"Pacific/Auckland",	"NZST-12NZDT,M9.5.0,M4.1.0/3"},
+	{NULL, NULL}
+};
+
+static tz_zone zone;
+static tz_span span;
+static char zone_rule[TZ_RULE_LEN];
+
+
+static bool parse_zone(const char* p, tz_zone* out);
+static const char* parse_name(const char* p);
+static const char* parse_time(const char* p, int32_t* seconds, uint32_t max_hours);
+static const char* parse_rule(const char* p, tz_rule* rule);
+static const char* parse_number(const char* p, uint32_t min, uint32_t max, uint32_t* val);
+static int32_t rule_day(const tz_rule* rule, int32_t year);
+static void find_span(uint32_t unix_time);
+
+
+/**
+ * @brief Start with TZ_DEFAULT
+ * @return None.
+ */
+void tz_init(void)
+{
+	zone_rule[0] = '\0';
+	tz_set(TZ_DEFAULT);
+}
+/**
+ * @brief Select a zone, by tz_presets[] name or by POSIX TZ rule
+ * @return true if the rule was valid, the current zone is kept otherwise.
+ */
+bool tz_set(const char* rule)
+{
+	tz_zone parsed;
+	int i;
+
+	for(i = 0; tz_presets[i].name != NULL; i++)
+	{
+		if(strcmp(rule, tz_presets[i].name) == 0)
+		{
+			rule = tz_presets[i].rule;
+			break;
+		}
+	}
+
+	if(strlen(rule) >= sizeof(zone_rule) || !parse_zone(rule, &parsed))
+	{
+		LOG_WARN(LOG_TZ_INVALID);
+		return false;
+	}
+
+	zone = parsed;
+	strcpy(zone_rule, rule);
+	// empty span, the next tz_local() finds the offset
+	span.start = 0;
+	span.length = 0;
+	span.offset = zone.std_offset;
+	LOG_INFO(LOG_TZ_SET, zone.std_offset, zone.dst_offset);
+
+	return true;
+}
+/**
+ * @brief Local time of a unix time
+ * @return unix_time plus the offset of the zone at that time.
+ */
+uint32_t tz_local(uint32_t unix_time)
+{
+	// unsigned, before the span wraps around to a large value
+	if(unix_time - span.start >= span.length)
+		find_span(unix_time);
+
+	return unix_time + span.offset;
+}
+/**
+ * @brief Rule of the current zone, as set
+ * @return '\0' terminated rule.
+ */
+const char* tz_get_rule(void)
+{
+	return zone_rule;
+}
+/**
+ * @brief Offsets of the current zone, the current one as of the last tz_local()
+ * @return None.
+ */
+void tz_get_info(tz_info* info)
+{
+	info->std_offset = zone.std_offset;
+	info->dst_offset = zone.dst_offset;
+	info->offset = span.offset;
+	info->next_change = span.length > UINT32_MAX - span.start ? UINT32_MAX : span.start + span.length;
+}
+
+
+/* Static Functions */
+//std offset [dst [offset] [,start[/time],end[/time]]]
+static bool parse_zone(const char* p, tz_zone* out)
+{
+	int32_t offset;
+
+	p = parse_name(p);
+	if(p == NULL || (p = parse_time(p, &offset, 24)) == NULL)
+		return false;
+	// POSIX offsets are west of Greenwich
+	out->std_offset = -offset;
+	out->dst_offset = out->std_offset;
+	out->has_dst = false;
+	if(*p == '\0')
+		return out->std_offset > -ONEDAYTOSENCOND && out->std_offset < ONEDAYTOSENCOND;
+
+	p = parse_name(p);
+	if(p == NULL)
+		return false;
+	out->dst_offset = out->std_offset + xHOUR;
+	if(*p != '\0' && *p != ',')
+	{
+		p = parse_time(p, &offset, 24);
+		if(p == NULL)
+			return false;
+		out->dst_offset = -offset;
+	}
+	if(*p == '\0')
+		p = ",M3.2.0,M11.1.0";
+
+	if(*p++ != ',' || (p = parse_rule(p, &out->start)) == NULL)
+		return false;
+	if(*p++ != ',' || (p = parse_rule(p, &out->end)) == NULL || *p != '\0')
+		return false;
+	out->has_dst = true;
+
+	// the local date is at most one day away from the UTC date (read_time())
+	return out->std_offset > -ONEDAYTOSENCOND && out->std_offset < ONEDAYTOSENCOND &&
+			out->dst_offset > -ONEDAYTOSENCOND && out->dst_offset < ONEDAYTOSENCOND;
+}
+//three letters or more, or "<...>" with signs and digits as well
+static const char* parse_name(const char* p)
+{
+	const char* start;
+
+	if(*p == '<')
+	{
+		start = ++p;
+		while((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || (*p >= '0' && *p <= '9') || *p == '+' || *p == '-')
+			p++;
+		if(*p != '>' || p - start < 3)
+			return NULL;
+		return p + 1;
+	}
+
+	start = p;
+	while((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))
+		p++;
+
+	return p - start < 3 ? NULL : p;
+}
+//[+|-]hh[:mm[:ss]]
+static const char* parse_time(const char* p, int32_t* seconds, uint32_t max_hours)
+{
+	uint32_t hours, minutes = 0, secs = 0;
+	int32_t sign = 1;
+
+	if(*p == '+' || *p == '-')
+		sign = *p++ == '-' ? -1 : 1;
+
+	p = parse_number(p, 0, max_hours, &hours);
+	if(p != NULL && *p == ':')
+		p = parse_number(p + 1, 0, 59, &minutes);
+	if(p != NULL && *p == ':')
+		p = parse_number(p + 1, 0, 59, &secs);
+	if(p == NULL)
+		return NULL;
+
+	*seconds = sign * (int32_t)(hours * xHOUR + minutes * xMINUTE + secs);
+	return p;
+}
+//Mm.w.d, Jn or n, then [/time], the time can be negative or past 24:00 (RFC 8536)
+static const char* parse_rule(const char* p, tz_rule* rule)
+{
+	uint32_t val;
+
+	memset(rule, 0, sizeof(*rule));
+	if(*p == 'M')
+	{
+		rule->type = tz_rule_month;
+		if((p = parse_number(p + 1, 1, 12, &val)) == NULL || *p != '.')
+			return NULL;
+		rule->month = val;
+		if((p = parse_number(p + 1, 1, 5, &val)) == NULL || *p != '.')
+			return NULL;
+		rule->week = val;
+		if((p = parse_number(p + 1, 0, 6, &val)) == NULL)
+			return NULL;
+		rule->weekday = val;
+	}
+	else if(*p == 'J')
+	{
+		rule->type = tz_rule_julian;
+		if((p = parse_number(p + 1, 1, 365, &val)) == NULL)
+			return NULL;
+		rule->day = val;
+	}
+	else
+	{
+		rule->type = tz_rule_day;
+		if((p = parse_number(p, 0, 365, &val)) == NULL)
+			return NULL;
+		rule->day = val;
+	}
+
+	rule->time = 2 * xHOUR;
+	if(*p == '/')
+		p = parse_time(p + 1, &rule->time, 167);
+
+	return p;
+}
+//decimal, at least one digit, NULL if out of [min, max]
+static const char* parse_number(const char* p, uint32_t min, uint32_t max, uint32_t* val)
+{
+	const char* start = p;
+
+	*val = 0;
+	while(*p >= '0' && *p <= '9' && *val <= max)
+		*val = *val * 10 + (*p++ - '0');
+
+	return p == start || *val < min || *val > max ? NULL : p;
+}
+//days since 1970-01-01 of the rule day in a year
+static int32_t rule_day(const tz_rule* rule, int32_t year)
+{
+	int32_t first, day;
+
+	switch(rule->type)
+	{
+	case tz_rule_julian:
+		return days_from_civil(year, 1, 1) + rule->day - 1 + (rule->day >= 60 && isLeapYear(year));
+	case tz_rule_day:
+		return days_from_civil(year, 1, 1) + rule->day;
+	case tz_rule_month:
+	default:
+		first = days_from_civil(year, rule->month, 1);
+		// 1970-01-01 was a Thursday, weekday 0 is Sunday
+		day = first + ((rule->weekday - (first + 4) % 7) % 7 + 7) % 7 + (rule->week - 1) * 7;
+		// week 5 is the last one, which can be the 4th
+		if(day >= first + daysInMonth(rule->month, year))
+			day -= 7;
+		return day;
+	}
+}
+//offset at unix_time, from the changes of the year before to the year after
+static void find_span(uint32_t unix_time)
+{
+	int64_t last = INT64_MIN, next = INT64_MAX, change;
+	int32_t offset = zone.std_offset;
+	nmea_time date;
+	int32_t year;
+	int i;
+
+	if(!zone.has_dst)
+	{
+		span.start = 0;
+		span.length = UINT32_MAX;
+		span.offset = zone.std_offset;
+		return;
+	}
+
+	civil_from_days(unix_time / ONEDAYTOSENCOND, &date);
+	for(year = date.year - 1; year <= date.year + 1; year++)
+	{
+		for(i = 0; i < 2; i++)
+		{
+			// summer time starts at a local standard time and ends at a local summer time
+			if(i == 0)
+				change = (int64_t)rule_day(&zone.start, year) * ONEDAYTOSENCOND + zone.start.time - zone.std_offset;
+			else
+				change = (int64_t)rule_day(&zone.end, year) * ONEDAYTOSENCOND + zone.end.time - zone.dst_offset;
+
+			if(change <= unix_time && change > last)
+			{
+				last = change;
+				offset = i == 0 ? zone.dst_offset : zone.std_offset;
+			}
+			else if(change > unix_time && change < next)
+				next = change;
+		}
+	}
+
+	span.start = last < 0 ? 0 : (uint32_t)last;
+	span.length = (next > UINT32_MAX ? UINT32_MAX : (uint32_t)next) - span.start;
+	span.offset = offset;
+}
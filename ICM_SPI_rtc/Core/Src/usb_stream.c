@@ -0,0 +1,328 @@
+/**
+ * @file usb_stream.c
+ * @brief Buffered transmission to the USB VCP
+ *
+ * CDC_Transmit_FS() returns USBD_BUSY while the previous transfer is still in flight,
+ * so calling it once per sample loses samples whenever the host polls late.
+ * Instead, frames are queued in a ring buffer and sent by the USB stack itself:
+ * a write starts a transfer if the IN endpoint is idle, otherwise the transfer complete
+ * callback picks up everything queued in the meantime.
+ * A frame is only dropped if the ring is full, and that is counted.
+ *
+ * Frames are batched: a transfer starts once flush_bytes are queued and is cut to a multiple
+ * of the 64 byte full-speed bulk packet, so the host sees full packets back to back.
+ * Whatever is left is sent anyway once the oldest queued byte waited deadline_ms,
+ * usb_stream_poll() checks that from the main loop.
+ *
+ * Bulk data, e.g. the flash dump of flash_dump.c, does not go through the ring: the producer writes whole
+ * frames straight into one of two bulk buffers and queues it, the next transfer is that buffer as it is.
+ * While one buffer is in flight the other one is filled, and the transfer complete interrupt starts the
+ * next queued one at once, so the IN endpoint is never left idle waiting for the main loop.
+ * A bulk buffer only goes once the ring has been sent up to the end of a frame, and the ring keeps its
+ * turn whenever its batch or its deadline is due, so the samples still go out within the deadline.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "usb_stream.h"
+#include "ring_buffer.h"
+#include "usbd_cdc_if.h"
+#include <string.h>
+
+
+extern USBD_HandleTypeDef hUsbDeviceFS;
+
+static ring_buffer tx_ring;
+static uint8_t tx_ring_buf[USB_STREAM_RING_SIZE];
+// CDC_Transmit_FS() reads from here until the transfer completes
+static uint8_t tx_xfer[USB_STREAM_XFER_LEN];
+
+static uint16_t flush_bytes = USB_STREAM_FLUSH_BYTES;
+static uint16_t deadline_ms = USB_STREAM_DEADLINE_MS;
+// HAL tick when the oldest byte still queued was written
+static uint32_t pending_since;
+// usb_stream_flush(): send everything queued so far without waiting for the batch
+static bool flush_requested;
+
+// bulk buffers: bulk_next is the oldest one queued, bulk_queued are waiting, the other one may be in flight
+static uint8_t bulk_buf[2][USB_STREAM_BULK_LEN];
+static uint16_t bulk_len[2];
+static uint8_t bulk_next;
+static uint8_t bulk_queued;
+static bool bulk_in_flight;
+// the last ring transfer ended with the ring empty, so on a frame boundary: a bulk buffer can go next
+static bool ring_whole;
+
+static uint32_t tx_frames;
+static uint32_t tx_transfers;
+static uint32_t tx_deadline_transfers;
+static uint32_t tx_bytes;
+static uint32_t tx_bulk_transfers;
+static uint32_t tx_bulk_cancelled;
+
+
+static void usb_stream_kick(void);
+
+
+/**
+ * @brief Clear the transmit ring
+ * @return None.
+ */
+void usb_stream_init(void)
+{
+	ring_init(&tx_ring, tx_ring_buf, sizeof(tx_ring_buf));
+	bulk_next = 0;
+	bulk_queued = 0;
+	bulk_in_flight = false;
+	ring_whole = true;
+	tx_frames = 0;
+	tx_transfers = 0;
+	tx_deadline_transfers = 0;
+	tx_bytes = 0;
+	tx_bulk_transfers = 0;
+	tx_bulk_cancelled = 0;
+}
+/**
+ * @brief Queue one frame for the USB VCP and start a transfer if none is in flight
+ * Only called from the main loop.
+ * @return false if the ring was full and the frame has been dropped.
+ */
+bool usb_stream_write(const uint8_t* data, uint16_t len)
+{
+	uint32_t primask;
+	bool was_empty = ring_used(&tx_ring) == 0;
+
+	if(!ring_write(&tx_ring, data, len))
+		return false;
+	tx_frames++;
+
+	// the USB interrupt is the other caller of usb_stream_kick()
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(was_empty)
+		pending_since = HAL_GetTick();
+	usb_stream_kick();
+	__set_PRIMASK(primask);
+
+	return true;
+}
+/**
+ * @brief IN transfer finished, send whatever has been queued meanwhile
+ * Called from CDC_TransmitCplt_FS(), in the USB interrupt.
+ * @return None.
+ */
+void usb_stream_tx_complete(void)
+{
+	// one transfer at a time, a bulk buffer in flight is free now
+	bulk_in_flight = false;
+	usb_stream_kick();
+}
+/**
+ * @brief Send a short transfer if the queued data is older than the deadline
+ * Called from the main loop, at least once per millisecond tick while data is waiting.
+ * @return None.
+ */
+void usb_stream_poll(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	usb_stream_kick();
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Send what is queued now, short of a full batch
+ * For latency sensitive frames, e.g. the timesync.c requests. Main loop only.
+ * @return None.
+ */
+void usb_stream_flush(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	flush_requested = ring_used(&tx_ring) != 0;
+	usb_stream_kick();
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Set the batching limits
+ * bytes is clamped to 1 ~ USB_STREAM_XFER_LEN, ms = 0 sends every frame right away.
+ * @return None.
+ */
+void usb_stream_set_batch(uint16_t bytes, uint16_t ms)
+{
+	if(bytes == 0)
+		bytes = 1;
+	if(bytes > USB_STREAM_XFER_LEN)
+		bytes = USB_STREAM_XFER_LEN;
+
+	__disable_irq();
+	flush_bytes = bytes;
+	deadline_ms = ms;
+	__enable_irq();
+}
+/**
+ * @brief Bulk buffer for the main loop to fill
+ * @return USB_STREAM_BULK_LEN bytes, NULL while both buffers are queued or in flight.
+ */
+uint8_t* usb_stream_bulk_buffer(void)
+{
+	uint8_t* buf = NULL;
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if(bulk_queued + bulk_in_flight < 2)
+		buf = bulk_buf[(bulk_next + bulk_queued) % 2];
+	__set_PRIMASK(primask);
+
+	return buf;
+}
+/**
+ * @brief Queue the buffer usb_stream_bulk_buffer() returned, it is sent as one transfer of len bytes
+ * len must hold whole frames, USB_STREAM_BULK_LEN at most. Main loop only.
+ * @return None.
+ */
+void usb_stream_bulk_send(uint16_t len)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if(bulk_queued + bulk_in_flight < 2 && len <= USB_STREAM_BULK_LEN)
+	{
+		bulk_len[(bulk_next + bulk_queued) % 2] = len;
+		bulk_queued++;
+		usb_stream_kick();
+	}
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief Drop the bulk buffers not sent yet, the one in flight still completes
+ * @return None.
+ */
+void usb_stream_bulk_cancel(void)
+{
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	tx_bulk_cancelled += bulk_queued;
+	bulk_queued = 0;
+	__set_PRIMASK(primask);
+}
+/**
+ * @brief The device is configured by the host, frames can be sent
+ * @return false before the enumeration and after the cable is pulled.
+ */
+bool usb_stream_connected(void)
+{
+	return hUsbDeviceFS.dev_state == USBD_STATE_CONFIGURED;
+}
+/**
+ * @brief Copy the transmission counters
+ * @return None.
+ */
+void usb_stream_get_stats(usb_stream_stats* stats)
+{
+	__disable_irq();
+	stats->frames = tx_frames;
+	stats->dropped_frames = tx_ring.dropped;
+	stats->dropped_bytes = tx_ring.dropped_bytes;
+	stats->transfers = tx_transfers;
+	stats->deadline_transfers = tx_deadline_transfers;
+	stats->bytes = tx_bytes;
+	stats->queued = ring_used(&tx_ring);
+	stats->high_water = tx_ring.high_water;
+	stats->bulk_transfers = tx_bulk_transfers;
+	stats->bulk_cancelled = tx_bulk_cancelled;
+	__enable_irq();
+}
+/**
+ * @brief Clear the transmission counters, queued data is kept
+ * @return None.
+ */
+void usb_stream_reset_stats(void)
+{
+	__disable_irq();
+	tx_frames = 0;
+	tx_transfers = 0;
+	tx_deadline_transfers = 0;
+	tx_bytes = 0;
+	tx_bulk_transfers = 0;
+	tx_bulk_cancelled = 0;
+	tx_ring.dropped = 0;
+	tx_ring.dropped_bytes = 0;
+	tx_ring.high_water = ring_used(&tx_ring);
+	__enable_irq();
+}
+
+
+/* Static Functions */
+/*
+ * Start the next transfer if the device is configured, the IN endpoint is idle
+ * and either enough data is queued or the oldest byte reached the deadline,
+ * or else the next bulk buffer if the ring was sent up to a frame boundary.
+ * Must not be interrupted by the USB interrupt, so the ring has exactly one consumer.
+ */
+static void usb_stream_kick(void)
+{
+	USBD_CDC_HandleTypeDef* hcdc = (USBD_CDC_HandleTypeDef*)hUsbDeviceFS.pClassData;
+	uint16_t len;
+	bool deadline, drain;
+
+	// nothing can be sent before enumeration, frames wait in the ring meanwhile
+	if(hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED || hcdc == NULL)
+	{
+		// a transfer cut by a cable pull never completes, the next enumeration clears TxState
+		bulk_in_flight = false;
+		return;
+	}
+	if(hcdc->TxState != 0)
+		return;
+
+	len = ring_used(&tx_ring);
+	deadline = len != 0 && (flush_requested || HAL_GetTick() - pending_since >= deadline_ms);
+
+	if(bulk_queued != 0 && ring_whole && len < flush_bytes && !deadline)
+	{
+		if(CDC_Transmit_FS(bulk_buf[bulk_next], bulk_len[bulk_next]) == USBD_OK)
+		{
+			tx_bulk_transfers++;
+			tx_bytes += bulk_len[bulk_next];
+			bulk_next = (bulk_next + 1) % 2;
+			bulk_queued--;
+			bulk_in_flight = true;
+		}
+		return;
+	}
+
+	if(len == 0)
+		return;
+	// a bulk buffer waits for the ring to be sent up to its end, the ring only holds whole frames
+	drain = deadline || bulk_queued != 0;
+	if(len < flush_bytes && !drain)
+		return;
+
+	if(len > sizeof(tx_xfer))
+		len = sizeof(tx_xfer);
+	// full packets only, unless the deadline forces the tail out
+	if(!drain && len >= USB_STREAM_PACKET_LEN)
+		len -= len % USB_STREAM_PACKET_LEN;
+
+	len = ring_peek(&tx_ring, tx_xfer, len);
+
+	if(CDC_Transmit_FS(tx_xfer, len) == USBD_OK)
+	{
+		ring_consume(&tx_ring, len);
+		tx_transfers++;
+		tx_bytes += len;
+		if(deadline)
+			tx_deadline_transfers++;
+		ring_whole = ring_used(&tx_ring) == 0;
+		// the remainder was written after the bytes just sent, restart its deadline from now
+		if(!ring_whole)
+			pending_since = HAL_GetTick();
+		else
+			flush_requested = false;
+	}
+}
@@ -0,0 +1,63 @@
+/*
+ * hal_stub.h
+ *
+ * Knobs of the simulated peripherals behind the HAL stubs.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_HAL_STUB_H_
+#define HOST_HAL_STUB_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#define HAL_STUB_SPI_HZ					5000000		// 80 MHz PCLK2 / SPI_BAUDRATEPRESCALER_16
+#define HAL_STUB_DMA_SETUP_NS			1000		// DMA start and completion interrupt
+#define HAL_STUB_USB_PACKETS_PER_MS		19			// full-speed bulk, an idle bus
+#define HAL_STUB_RTC_EPOCH				1691600055u	// 2023-08-09 16:54:15 UTC, MX_RTC_Init()
+#define HAL_STUB_TIM_CLK_HZ				80000000u	// APB1 timer clock
+#define HAL_STUB_USB_OUT_NS				20000		// OUT packet, from the start of the frame to CDC_Receive_FS()
+#define HAL_STUB_USB_OUT_QUEUE			8
+#define HAL_STUB_USB_HOSTS				2			// PC readers of the IN endpoint
+#define HAL_STUB_QSPI_KER_HZ			80000000u	// QUADSPI kernel clock, SYSCLK
+
+typedef struct
+{
+	uint32_t transfers;
+	uint32_t busy;					// CDC_Transmit_FS() refused, previous transfer in flight
+	uint64_t bytes;
+	uint64_t packets;				// 64 byte packets, short packets and ZLPs included
+	uint64_t first_ns;				// first and last transfer completion
+	uint64_t last_ns;
+	uint32_t pulls;					// cable pulls
+	uint32_t lost_transfers;		// in flight when the cable was pulled
+} hal_stub_usb_stats;
+
+// the PC side of the IN endpoint, sees every transfer when it completes
+typedef void (*hal_stub_usb_host_fn)(const uint8_t* data, uint16_t len);
+
+// power on: GPIO, SPI1, QUADSPI, RTC, USB (configured), the sensors and the flash (its array is kept)
+void hal_stub_reset(void);
+
+// frequency error of the PLL, TIM2 runs this many ppm fast (negative: slow) against the RTC
+void hal_stub_clock_config(int32_t pll_ppm);
+// frequency error of the RTC crystal, before the smooth calibration
+void hal_stub_rtc_config(int32_t crystal_ppm);
+
+// USB host side: packets per 1 ms frame, and the interval the host polls the IN endpoint at (0: always)
+void hal_stub_usb_config(uint32_t packets_per_ms, uint32_t poll_ms);
+// everything sent to the host is appended here, NULL to drop it
+void hal_stub_usb_capture(FILE* f);
+void hal_stub_usb_get_stats(hal_stub_usb_stats* stats);
+// one more reader, up to HAL_STUB_USB_HOSTS
+void hal_stub_usb_host(hal_stub_usb_host_fn fn);
+// the PC writes to the OUT endpoint, app_usb_receive() gets it in the next 1 ms frame
+void hal_stub_usb_receive(const uint8_t* data, uint16_t len);
+// Cable pulled: the device is suspended, the transfer in flight and the OUT packets not delivered are lost.
+// Plugged in again: enumerated at once, configured with the IN endpoint idle, as after CDC_Init().
+void hal_stub_usb_connect(bool on);
+
+#endif /* HOST_HAL_STUB_H_ */
@@ -0,0 +1,50 @@
+/*
+ * icm20948_sim.h
+ *
+ * Register level model of the ICM20948 and of the AK09916 behind its I2C master,
+ * driven over the simulated SPI1 (Src/hal_stub.c).
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_ICM20948_SIM_H_
+#define HOST_ICM20948_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// data ready times kept for the latency measurement
+#define ICM_SIM_DRDY_LOG_LEN			4096
+
+typedef struct
+{
+	uint32_t samples;				// gyroscope / accelerometer ODR ticks
+	uint32_t drdy_pulses;			// INT1 pulses
+	uint32_t fifo_overflows;
+	uint32_t fifo_bytes;			// bytes written into the FIFO
+	uint32_t mag_measurements;
+	uint32_t mag_overruns;			// AK09916 DOR, a measurement nobody read
+	uint32_t slv0_reads;
+	uint32_t slv4_transfers;
+	uint32_t spi_transfers;			// CS-low windows
+	uint32_t spi_bytes;
+	uint32_t bank_writes;
+	uint32_t spi_errors;			// transfer without CS low
+} icm_sim_stats;
+
+void icm_sim_reset(void);
+
+// SPI1 slave side, one call per DMA transfer within one CS-low window
+void icm_sim_cs(bool low);
+void icm_sim_spi_transfer(const uint8_t* tx, uint8_t* rx, uint16_t len);
+
+// current output data rate
+double icm_sim_odr_hz(void);
+
+// oldest logged data ready time, false if the log is empty
+bool icm_sim_pop_drdy(uint64_t* t_ns);
+
+void icm_sim_get_stats(icm_sim_stats* stats);
+
+#endif /* HOST_ICM20948_SIM_H_ */
@@ -0,0 +1,30 @@
+/*
+ * motion.h
+ *
+ * Motion fed into the simulated sensors, synthetic or replayed from a recording.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_MOTION_H_
+#define HOST_MOTION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct
+{
+	double accel[3];				// g
+	double gyro[3];					// dps
+	double mag[3];					// uT
+	double temperature;				// degC
+} motion_state;
+
+// replay a CSV with the columns written by python/frame_decoder.py, looped
+bool motion_load_csv(const char* path);
+// the board lies still until then, so that the driver calibration sees gravity only
+void motion_start(uint64_t t_ns);
+void motion_sample(uint64_t t_ns, motion_state* m);
+
+#endif /* HOST_MOTION_H_ */
@@ -0,0 +1,58 @@
+/*
+ * mt25ql512_sim.h
+ *
+ * Command level model of the MT25QL512 NOR flash behind the simulated QUADSPI (Src/hal_stub.c).
+ * The array is backed by a file, so it keeps its content across runs and across hal_stub_reset().
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_MT25QL512_SIM_H_
+#define HOST_MT25QL512_SIM_H_
+
+#include "stm32l4xx_hal.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MT25QL512_SIM_SIZE				0x04000000u
+#define MT25QL512_SIM_SUBSECTOR_SIZE	4096
+// typical timings of the datasheet
+#define MT25QL512_SIM_PAGE_NS			120000ull
+#define MT25QL512_SIM_SUBSECTOR_NS		50000000ull
+#define MT25QL512_SIM_SECTOR_NS			150000000ull
+
+typedef struct
+{
+	uint32_t commands;
+	uint32_t page_programs;
+	uint64_t bytes_programmed;
+	uint32_t subsector_erases;
+	uint32_t sector_erases;
+	uint32_t max_erase_count;		// erases of the most erased subsector
+	uint32_t ignored;				// program or erase without WRITE ENABLE, command while busy
+	uint32_t protocol_errors;		// unknown command, wrong address length, line count or dummy cycles
+	uint32_t torn;					// program or erase cut by a power loss
+} mt25ql512_sim_stats;
+
+// backing file, created and erased (0xFF) if missing, NULL for an erased array in memory
+bool mt25ql512_sim_open(const char* path);
+void mt25ql512_sim_close(void);
+
+// Power on. A program or an erase still running is torn: only its first half has taken effect.
+// The array itself is not touched otherwise.
+void mt25ql512_sim_reset(void);
+
+// one command, data is written to the device or read from it (len bytes)
+bool mt25ql512_sim_command(const QSPI_CommandTypeDef* cmd, uint8_t* data, uint32_t len);
+// the memory-mapped read command, checked once when the QUADSPI enters memory-mapped mode
+bool mt25ql512_sim_mapped_command(const QSPI_CommandTypeDef* cmd);
+// time until the running program or erase is over, 0 if the device is ready
+uint64_t mt25ql512_sim_busy_ns(void);
+
+// the array, MT25QL512_SIM_SIZE bytes
+uint8_t* mt25ql512_sim_array(void);
+
+void mt25ql512_sim_get_stats(mt25ql512_sim_stats* stats);
+
+#endif /* HOST_MT25QL512_SIM_H_ */
@@ -0,0 +1,41 @@
+/*
+ * pc_dump.h
+ *
+ * PC side of the flash dump of flash_dump.c, like python/frame_decoder.py dump=: sends COMMAND_DUMP, keeps the
+ * blocks whose CRC matches and resumes from the end of the last good one after a cable pull or a bad block.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_PC_DUMP_H_
+#define HOST_PC_DUMP_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PC_DUMP_UNPLUGGED_NS			200000000	// the cable stays out this long
+#define PC_DUMP_REOPEN_NS				50000000	// from the enumeration to the PC application sending the resume
+
+typedef struct
+{
+	uint32_t commands;				// COMMAND_DUMP sent, the first one and the resumes
+	uint32_t frames;				// FRAME_TYPE_DUMP frames received
+	uint32_t bad_frames;			// malformed or failing their frame CRC
+	uint32_t blocks;				// kept, their CRC matched
+	uint32_t bad_blocks;			// CRC mismatch or bytes missing, sent again
+	uint32_t differ;				// blocks kept that differ from the flash array
+	uint32_t pulls;					// cable pulls
+	uint64_t bytes;					// kept
+	uint64_t discarded;				// received but not kept, sent again after a resume
+	uint64_t start_ns;				// first command, last block kept
+	uint64_t done_ns;
+	bool done;
+} pc_dump_stats;
+
+// dump length bytes from address, with pulls cable pulls spread over it
+void pc_dump_start(uint32_t address, uint32_t length, uint32_t pulls);
+bool pc_dump_done(void);
+void pc_dump_get_stats(pc_dump_stats* stats);
+
+#endif /* HOST_PC_DUMP_H_ */
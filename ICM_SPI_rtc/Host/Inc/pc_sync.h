@@ -0,0 +1,31 @@
+/*
+ * pc_sync.h
+ *
+ * PC side of the timesync.c exchange, answers the FRAME_TYPE_SYNC requests like python/frame_decoder.py.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_PC_SYNC_H_
+#define HOST_PC_SYNC_H_
+
+#include <stdint.h>
+
+#define PC_SYNC_READ_MIN_NS				50000		// the PC application reads a transfer this long after it completed
+#define PC_SYNC_READ_MAX_NS				2000000		// up to this, uniformly
+#define PC_SYNC_TURNAROUND_NS			100000		// from the read to the reply being written
+
+typedef struct
+{
+	uint32_t requests;
+	uint32_t replies;
+} pc_sync_stats;
+
+// PC clock: the RTC start time (HAL_STUB_RTC_EPOCH at virtual time 0) plus offset_us, and it starts answering
+void pc_sync_start(int64_t offset_us);
+// microseconds since 1970-01-01 UTC on the PC clock
+uint64_t pc_sync_now_us(void);
+void pc_sync_get_stats(pc_sync_stats* stats);
+
+#endif /* HOST_PC_SYNC_H_ */
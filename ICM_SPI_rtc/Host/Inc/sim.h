@@ -0,0 +1,59 @@
+/*
+ * sim.h
+ *
+ * Virtual time for the host build.
+ * Peripherals schedule events (DMA done, sensor sample, USB transfer done), an event is the
+ * interrupt of that peripheral: it runs once its time is reached and interrupts are not masked.
+ * Firmware code itself takes no virtual time, unless sim_set_cpu_scale() charges the host time it used.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_SIM_H_
+#define HOST_SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIM_MAX_EVENTS					32
+#define SIM_NS_PER_MS					1000000ull
+#define SIM_NS_PER_S					1000000000ull
+// one HAL_GetTick() call of a polling loop
+#define SIM_POLL_NS						200
+
+typedef void (*sim_event_fn)(void* ctx);
+
+typedef struct
+{
+	uint64_t events;				// interrupts run
+	uint64_t wfi;					// __WFI() calls
+	uint64_t sleep_ns;				// virtual time spent in __WFI()
+	uint64_t cpu_ns;				// virtual time charged for firmware code
+} sim_stats;
+
+void sim_reset(void);
+uint64_t sim_now(void);
+
+// interrupt after delay_ns, one pending event per fn / ctx pair
+void sim_schedule(uint64_t delay_ns, sim_event_fn fn, void* ctx);
+void sim_cancel(sim_event_fn fn, void* ctx);
+
+// let time pass, due interrupts run unless masked
+void sim_advance(uint64_t ns);
+// sleep until the next interrupt or SysTick
+void sim_wait_for_interrupt(void);
+
+// interrupt masking, PRIMASK
+void sim_irq_mask(bool masked);
+bool sim_irq_masked(void);
+
+// virtual ns charged per host ns spent in firmware code, 0 = firmware code is free
+void sim_set_cpu_scale(double scale);
+// called at the entry and the exit of every HAL stub
+void sim_enter(void);
+void sim_leave(void);
+
+void sim_get_stats(sim_stats* stats);
+
+#endif /* HOST_SIM_H_ */
@@ -0,0 +1,317 @@
+/*
+ * stm32l4xx_hal.h
+ *
+ * Host build stand-in for the STM32L4 HAL and the CMSIS core intrinsics.
+ * Only what Core/ uses is declared, the behaviour lives in Src/hal_stub.c on top of the
+ * virtual time simulator (sim.h).
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_STM32L4XX_HAL_H_
+#define HOST_STM32L4XX_HAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+/* Common */
+typedef enum
+{
+	HAL_OK = 0x00,
+	HAL_ERROR = 0x01,
+	HAL_BUSY = 0x02,
+	HAL_TIMEOUT = 0x03
+} HAL_StatusTypeDef;
+
+typedef enum
+{
+	RESET = 0,
+	SET = !RESET
+} FlagStatus, ITStatus;
+
+#define UNUSED(X)						(void)X
+
+// the target compiler ignores it in front of a typedef as well
+#define __packed
+
+
+/* CMSIS core, interrupts are simulator events (sim.h) */
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __WFI(void);
+#define __DMB()							__sync_synchronize()
+#define __NOP()							do { } while(0)
+
+typedef enum
+{
+	EXTI1_IRQn = 7
+} IRQn_Type;
+
+
+/* GPIO */
+typedef struct
+{
+	uint32_t ODR;
+	uint32_t IDR;
+} GPIO_TypeDef;
+
+extern GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+#define GPIOA							(&sim_gpioa)
+#define GPIOB							(&sim_gpiob)
+#define GPIOC							(&sim_gpioc)
+
+typedef enum
+{
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_0						((uint16_t)0x0001)
+#define GPIO_PIN_1						((uint16_t)0x0002)
+#define GPIO_PIN_2						((uint16_t)0x0004)
+#define GPIO_PIN_3						((uint16_t)0x0008)
+#define GPIO_PIN_4						((uint16_t)0x0010)
+#define GPIO_PIN_5						((uint16_t)0x0020)
+#define GPIO_PIN_6						((uint16_t)0x0040)
+#define GPIO_PIN_7						((uint16_t)0x0080)
+#define GPIO_PIN_8						((uint16_t)0x0100)
+#define GPIO_PIN_9						((uint16_t)0x0200)
+#define GPIO_PIN_10						((uint16_t)0x0400)
+#define GPIO_PIN_11						((uint16_t)0x0800)
+#define GPIO_PIN_12						((uint16_t)0x1000)
+#define GPIO_PIN_13						((uint16_t)0x2000)
+#define GPIO_PIN_14						((uint16_t)0x4000)
+#define GPIO_PIN_15						((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+
+/* SPI */
+typedef struct
+{
+	uint32_t BaudRate;				// Hz, the transfer time of the simulated DMA
+} SPI_InitTypeDef;
+
+typedef struct
+{
+	SPI_InitTypeDef Init;
+	volatile uint32_t State;
+} SPI_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef* hspi, uint8_t* pTxData, uint8_t* pRxData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef* hspi);
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef* hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef* hspi);
+
+
+/* RTC */
+typedef struct
+{
+	uint8_t Hours;
+	uint8_t Minutes;
+	uint8_t Seconds;
+	uint8_t TimeFormat;
+	uint32_t SubSeconds;
+	uint32_t SecondFraction;
+	uint32_t DayLightSaving;
+	uint32_t StoreOperation;
+} RTC_TimeTypeDef;
+
+typedef struct
+{
+	uint8_t WeekDay;
+	uint8_t Month;
+	uint8_t Date;
+	uint8_t Year;
+} RTC_DateTypeDef;
+
+typedef struct
+{
+	uint32_t AsynchPrediv;
+	uint32_t SynchPrediv;
+} RTC_InitTypeDef;
+
+typedef struct
+{
+	RTC_InitTypeDef Init;
+} RTC_HandleTypeDef;
+
+typedef struct
+{
+	RTC_TimeTypeDef AlarmTime;
+	uint32_t AlarmMask;
+	uint32_t AlarmSubSecondMask;
+	uint32_t Alarm;
+} RTC_AlarmTypeDef;
+
+#define RTC_FORMAT_BIN					0x00000000u
+#define RTC_FORMAT_BCD					0x00000001u
+#define RTC_DAYLIGHTSAVING_NONE			0x00000000u
+#define RTC_STOREOPERATION_RESET		0x00000000u
+#define RTC_SHIFTADD1S_RESET			0x00000000u
+#define RTC_SHIFTADD1S_SET				0x80000000u
+#define RTC_SMOOTHCALIB_PERIOD_32SEC	0x00000000u
+#define RTC_SMOOTHCALIB_PLUSPULSES_RESET	0x00000000u
+#define RTC_SMOOTHCALIB_PLUSPULSES_SET	0x00008000u
+#define RTC_BKP_DR0						0x00u
+#define RTC_BKP_DR1						0x01u
+#define RTC_BKP_DR2						0x02u
+#define RTC_BKP_DR3						0x03u
+#define RTC_BKP_DR4						0x04u
+#define RTC_BKP_DR5						0x05u
+#define RTC_BKP_NUMBER					32u
+
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef* hrtc, RTC_TimeTypeDef* sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef* hrtc, RTC_DateTypeDef* sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef* hrtc, RTC_TimeTypeDef* sTime, uint32_t Format);
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef* hrtc, RTC_DateTypeDef* sDate, uint32_t Format);
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef* hrtc, uint32_t ShiftAdd1S, uint32_t ShiftSubFS);
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef* hrtc, uint32_t SmoothCalibPeriod, uint32_t SmoothCalibPlusPulses,
+		uint32_t SmoothCalibMinusPulsesValue);
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister, uint32_t Data);
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister);
+// alarm A fires on every second, as configured by MX_RTC_Init()
+void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef* hrtc);
+
+
+/* TIM, base counter only */
+typedef struct
+{
+	uint32_t Prescaler;
+	uint32_t Period;
+} TIM_Base_InitTypeDef;
+
+typedef struct
+{
+	TIM_Base_InitTypeDef Init;
+	uint32_t running;
+} TIM_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim);
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef* htim);
+// the counter follows the virtual time, hal_stub_clock_config() sets its frequency error
+uint32_t hal_stub_tim_counter(TIM_HandleTypeDef* htim);
+#define __HAL_TIM_GET_COUNTER(__HANDLE__)	hal_stub_tim_counter(__HANDLE__)
+
+
+/* QUADSPI, indirect, automatic polling and memory-mapped modes, one MT25QL512 behind it (mt25ql512_sim.h) */
+typedef struct
+{
+	uint32_t ClockPrescaler;		// the bus runs at HAL_STUB_QSPI_KER_HZ / (ClockPrescaler + 1)
+	uint32_t FifoThreshold;
+	uint32_t SampleShifting;
+	uint32_t FlashSize;
+	uint32_t ChipSelectHighTime;
+	uint32_t ClockMode;
+	uint32_t FlashID;
+	uint32_t DualFlash;
+} QSPI_InitTypeDef;
+
+typedef enum
+{
+	HAL_QSPI_STATE_RESET = 0x00,
+	HAL_QSPI_STATE_READY = 0x01,
+	HAL_QSPI_STATE_BUSY = 0x02,
+	HAL_QSPI_STATE_BUSY_INDIRECT_TX = 0x12,
+	HAL_QSPI_STATE_BUSY_INDIRECT_RX = 0x22,
+	HAL_QSPI_STATE_BUSY_AUTO_POLLING = 0x42,
+	HAL_QSPI_STATE_BUSY_MEM_MAPPED = 0x82,
+	HAL_QSPI_STATE_ABORT = 0x08,
+	HAL_QSPI_STATE_ERROR = 0x04
+} HAL_QSPI_StateTypeDef;
+
+typedef struct
+{
+	QSPI_InitTypeDef Init;
+	volatile HAL_QSPI_StateTypeDef State;
+	volatile uint32_t ErrorCode;
+} QSPI_HandleTypeDef;
+
+typedef struct
+{
+	uint32_t Instruction;
+	uint32_t Address;
+	uint32_t AlternateBytes;
+	uint32_t AddressSize;
+	uint32_t AlternateBytesSize;
+	uint32_t DummyCycles;
+	uint32_t InstructionMode;
+	uint32_t AddressMode;
+	uint32_t AlternateByteMode;
+	uint32_t DataMode;
+	uint32_t NbData;
+	uint32_t DdrMode;
+	uint32_t DdrHoldHalfCycle;
+	uint32_t SIOOMode;
+} QSPI_CommandTypeDef;
+
+typedef struct
+{
+	uint32_t Match;
+	uint32_t Mask;
+	uint32_t Interval;
+	uint32_t StatusBytesSize;
+	uint32_t MatchMode;
+	uint32_t AutomaticStop;
+} QSPI_AutoPollingTypeDef;
+
+typedef struct
+{
+	uint32_t TimeOutPeriod;
+	uint32_t TimeOutActivation;
+} QSPI_MemoryMappedTypeDef;
+
+#define QSPI_INSTRUCTION_NONE			0x00000000u
+#define QSPI_INSTRUCTION_1_LINE			0x00000100u
+#define QSPI_INSTRUCTION_2_LINES		0x00000200u
+#define QSPI_INSTRUCTION_4_LINES		0x00000300u
+#define QSPI_ADDRESS_NONE				0x00000000u
+#define QSPI_ADDRESS_1_LINE				0x00000400u
+#define QSPI_ADDRESS_2_LINES			0x00000800u
+#define QSPI_ADDRESS_4_LINES			0x00000C00u
+#define QSPI_ADDRESS_8_BITS				0x00000000u
+#define QSPI_ADDRESS_16_BITS			0x00001000u
+#define QSPI_ADDRESS_24_BITS			0x00002000u
+#define QSPI_ADDRESS_32_BITS			0x00003000u
+#define QSPI_ALTERNATE_BYTES_NONE		0x00000000u
+#define QSPI_DATA_NONE					0x00000000u
+#define QSPI_DATA_1_LINE				0x01000000u
+#define QSPI_DATA_2_LINES				0x02000000u
+#define QSPI_DATA_4_LINES				0x03000000u
+#define QSPI_DDR_MODE_DISABLE			0x00000000u
+#define QSPI_DDR_HHC_ANALOG_DELAY		0x00000000u
+#define QSPI_SIOO_INST_EVERY_CMD		0x00000000u
+#define QSPI_MATCH_MODE_AND				0x00000000u
+#define QSPI_MATCH_MODE_OR				0x00800000u
+#define QSPI_AUTOMATIC_STOP_DISABLE		0x00000000u
+#define QSPI_AUTOMATIC_STOP_ENABLE		0x00400000u
+#define QSPI_TIMEOUT_COUNTER_DISABLE	0x00000000u
+#define QSPI_TIMEOUT_COUNTER_ENABLE		0x00000008u
+
+// the memory-mapped window is the simulated flash array
+#define QSPI_BASE						((uintptr_t)hal_stub_qspi_base())
+const uint8_t* hal_stub_qspi_base(void);
+
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef* hqspi, uint8_t* pData, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef* hqspi, uint8_t* pData, uint32_t Timeout);
+HAL_StatusTypeDef HAL_QSPI_Transmit_DMA(QSPI_HandleTypeDef* hqspi, uint8_t* pData);
+HAL_StatusTypeDef HAL_QSPI_AutoPolling_IT(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, QSPI_AutoPollingTypeDef* cfg);
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, QSPI_MemoryMappedTypeDef* cfg);
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef* hqspi);
+void HAL_QSPI_TxCpltCallback(QSPI_HandleTypeDef* hqspi);
+void HAL_QSPI_StatusMatchCallback(QSPI_HandleTypeDef* hqspi);
+void HAL_QSPI_ErrorCallback(QSPI_HandleTypeDef* hqspi);
+
+
+/* System */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+#endif /* HOST_STM32L4XX_HAL_H_ */
@@ -0,0 +1,44 @@
+/*
+ * usbd_cdc.h
+ *
+ * Host build stand-in for the ST USB device library CDC class, only the state usb_stream.c looks at.
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_USBD_CDC_H_
+#define HOST_USBD_CDC_H_
+
+#include <stdint.h>
+
+#define CDC_DATA_FS_MAX_PACKET_SIZE		64U
+
+typedef enum
+{
+	USBD_OK = 0U,
+	USBD_BUSY,
+	USBD_EMEM,
+	USBD_FAIL
+} USBD_StatusTypeDef;
+
+#define USBD_STATE_DEFAULT				0x01U
+#define USBD_STATE_ADDRESSED			0x02U
+#define USBD_STATE_CONFIGURED			0x03U
+#define USBD_STATE_SUSPENDED			0x04U
+
+typedef struct
+{
+	uint8_t* TxBuffer;
+	uint32_t TxLength;
+	volatile uint32_t TxState;
+	volatile uint32_t RxState;
+} USBD_CDC_HandleTypeDef;
+
+typedef struct
+{
+	volatile uint8_t dev_state;
+	void* pClassData;
+} USBD_HandleTypeDef;
+
+#endif /* HOST_USBD_CDC_H_ */
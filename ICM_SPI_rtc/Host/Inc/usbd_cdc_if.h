@@ -0,0 +1,22 @@
+/*
+ * usbd_cdc_if.h
+ *
+ * Host build stand-in for USB_DEVICE/App/usbd_cdc_if.h, the transfers go to the simulated host (Src/hal_stub.c).
+ *
+ *  Created on: Oct 16, 2026
+ *      Author: xmj_j
+ */
+
+#ifndef HOST_USBD_CDC_IF_H_
+#define HOST_USBD_CDC_IF_H_
+
+#include "usbd_cdc.h"
+#include "rtc.h"
+#include "icm20948.h"
+
+#define APP_RX_DATA_SIZE				1024
+#define APP_TX_DATA_SIZE				1024
+
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len);
+
+#endif /* HOST_USBD_CDC_IF_H_ */
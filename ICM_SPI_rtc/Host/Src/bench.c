@@ -0,0 +1,654 @@
+/**
+ * @file bench.c
+ * @brief Host build entry point: runs the firmware pipeline (Core/Src/app.c) against the simulated board
+ *
+ * The same code as on the NUCLEO runs here: icm20948.c over the SPI1 DMA transport, time.c, frame.c,
+ * ring_buffer.c and usb_stream.c. Only the HAL underneath is simulated (hal_stub.c, icm20948_sim.c).
+ *
+ * Reported:
+ * - host CPU time of every app_process() call, the cost of the pipeline on this machine;
+ * - virtual latency from the INT1 data ready pulse to the frame being queued for USB;
+ * - SPI, sample ring, USB and sensor model counters;
+ * - with -s, the time sync with a simulated PC (pc_sync.c): the RTC crystal is off by rtc_ppm and the PC clock
+ *   by offset_ms, the error of the sample timestamps against the PC clock over the second half of the run.
+ * - with -q, a check of mt25ql512.c against the flash model before the run: erase, page programs on DMA with
+ *   the automatic polling, read back through the memory-mapped window, with the virtual time each one took;
+ *   it overwrites the last 64 KB of the flash.
+ * - the flash log (flash_log.c) after the run: staging and flash counters, then the log is read back block by
+ *   block, the page CRCs and the record numbers are checked. -F keeps the flash array in a file between runs.
+ *   Random time ranges are then looked up with flash_log_find() and checked against the blocks read back, once
+ *   with the time index built while logging and once with the one loaded by a new mount.
+ * - with -P, power losses spread over the run, each one while the flash programs or erases: the board is powered
+ *   on again and the log mounted, no record committed before the loss may be missing. The counters of the
+ *   pipeline start again at every power on.
+ * - with -D, the first blocks of the log read back over USB with COMMAND_DUMP (flash_dump.c) after the run, by a
+ *   simulated PC (pc_dump.c) that checks the block CRCs against the flash array, while the samples go on. The
+ *   cable is pulled the number of times given, the PC resumes from its last good block each time.
+ *
+ * Usage: icm_bench [-n samples] [-d divider] [-f binary|text] [-m motion.csv] [-o capture.bin]
+ *                  [-c cpu_scale] [-b flush_bytes] [-l deadline_ms] [-u packets_per_ms] [-p poll_ms]
+ *                  [-t pll_error_ppm] [-s rtc_ppm[,offset_ms]] [-F flash.bin] [-q] [-P cuts]
+ *                  [-D blocks[,pulls]] [-v]
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "app.h"
+#include "icm20948.h"
+#include "time.h"
+#include "usb_stream.h"
+#include "timebase.h"
+#include "timesync.h"
+#include "pc_sync.h"
+#include "pc_dump.h"
+#include "mt25ql512.h"
+#include "flash_log.h"
+#include "flash_dump.h"
+#include "frame.h"
+#include "hal_stub.h"
+#include "icm20948_sim.h"
+#include "motion.h"
+#include "mt25ql512_sim.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+
+// defined by main.c on the board
+RTC_TimeTypeDef sTime = {0};
+RTC_DateTypeDef sDate = {0};
+
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+} bench_stat;
+
+
+static uint64_t host_ns(void);
+static void stat_add(bench_stat* s, uint64_t v);
+static void stat_print(const char* name, const bench_stat* s, const char* unit, double div);
+static bool flash_test(void);
+static uint32_t log_blocks(uint32_t* order);
+static void log_check(void);
+static void index_check(const char* when);
+static uint32_t power_cut(void);
+static void dump_check(uint32_t blocks, uint32_t pulls, uint32_t packets_per_ms);
+static void flash_done(bool ok, void* ctx);
+static void usage(void);
+
+
+//ICM raw data ready, as in main.c
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	if(GPIO_Pin == ICM_INT_Pin)
+	{
+		app_data_ready();
+	}
+}
+
+//RTC second boundary, as in main.c
+void HAL_RTC_AlarmAEventCallback(RTC_HandleTypeDef *hrtc)
+{
+	timebase_rtc_second();
+}
+
+void Error_Handler(void)
+{
+	fprintf(stderr, "Error_Handler()\n");
+	exit(1);
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t samples = 10000;
+	int divider = -1;
+	const char* motion_file = NULL;
+	const char* capture_file = NULL;
+	FILE* capture = NULL;
+	double cpu_scale = 0;
+	int flush_bytes = -1, deadline_ms = -1;
+	uint32_t packets_per_ms = HAL_STUB_USB_PACKETS_PER_MS, poll_ms = 0;
+	int32_t pll_ppm = 0;
+	int sync = 0, rtc_ppm = 0, offset_ms = 0;
+	int64_t error_us, error_max_us = 0;
+	const char* flash_file = NULL;
+	int flash_check = 0;
+	uint32_t cuts = 0, cut = 0, lost = 0, mount_reads_max = 0, torn_pages = 0;
+	uint32_t dump_blocks = 0, dump_pulls = 0;
+	int verbose = 0;
+	int opt;
+
+	bench_stat cpu = { 0, 0, UINT64_MAX, 0 };
+	bench_stat latency = { 0, 0, UINT64_MAX, 0 };
+	uint64_t t0, t_start, t_end, drdy;
+	uint32_t i, ring_dropped, ring_high_water;
+
+	icm20948_spi_stats spi;
+	app_stats app;
+	usb_stream_stats usb;
+	hal_stub_usb_stats host_usb;
+	icm_sim_stats model;
+	sim_stats vm;
+	timebase_stats tb;
+	timesync_stats ts;
+	pc_sync_stats pc;
+	mt25ql512_stats flash;
+	flash_log_stats flash_log;
+	mt25ql512_sim_stats flash_model;
+
+	while((opt = getopt(argc, argv, "n:d:f:m:o:c:b:l:u:p:t:s:F:qP:D:vh")) != -1)
+	{
+		switch(opt)
+		{
+		case 'n': samples = strtoul(optarg, NULL, 0); break;
+		case 'd': divider = atoi(optarg); break;
+		case 'f':
+			if(!strcmp(optarg, "text"))
+				tx_format = output_text;
+			else if(!strcmp(optarg, "binary"))
+				tx_format = output_binary;
+			else
+				usage();
+			break;
+		case 'm': motion_file = optarg; break;
+		case 'o': capture_file = optarg; break;
+		case 'c': cpu_scale = atof(optarg); break;
+		case 'b': flush_bytes = atoi(optarg); break;
+		case 'l': deadline_ms = atoi(optarg); break;
+		case 'u': packets_per_ms = strtoul(optarg, NULL, 0); break;
+		case 'p': poll_ms = strtoul(optarg, NULL, 0); break;
+		case 't': pll_ppm = atoi(optarg); break;
+		case 's':
+			sync = 1;
+			if(sscanf(optarg, "%d,%d", &rtc_ppm, &offset_ms) < 1)
+				usage();
+			break;
+		case 'F': flash_file = optarg; break;
+		case 'q': flash_check = 1; break;
+		case 'P': cuts = strtoul(optarg, NULL, 0); break;
+		case 'D':
+			if(sscanf(optarg, "%u,%u", &dump_blocks, &dump_pulls) < 1 || dump_blocks == 0 ||
+					dump_blocks > FLASH_LOG_BLOCKS)
+				usage();
+			break;
+		case 'v': verbose = 1; break;
+		default: usage();
+		}
+	}
+
+	if(motion_file && !motion_load_csv(motion_file))
+	{
+		fprintf(stderr, "cannot load %s\n", motion_file);
+		return 1;
+	}
+	if(capture_file && !(capture = fopen(capture_file, "wb")))
+	{
+		fprintf(stderr, "cannot create %s\n", capture_file);
+		return 1;
+	}
+	if(!mt25ql512_sim_open(flash_file))
+	{
+		fprintf(stderr, "cannot map %s\n", flash_file ? flash_file : "the flash array");
+		return 1;
+	}
+	// the firmware printf()s go to the SWO on the board, hidden unless -v
+	if(!verbose)
+		freopen("/dev/null", "w", stdout);
+
+	hal_stub_reset();
+	hal_stub_clock_config(pll_ppm);
+	hal_stub_rtc_config(rtc_ppm);
+	if(sync)
+		pc_sync_start((int64_t)offset_ms * 1000);
+	hal_stub_usb_config(packets_per_ms, poll_ms);
+	hal_stub_usb_capture(capture);
+
+	if(flash_check && !flash_test())
+		return 1;
+	app_init();
+	if(divider >= 0)
+	{
+		icm20948_gyro_sample_rate_divider(divider);
+		icm20948_accel_sample_rate_divider(divider);
+	}
+	if(flush_bytes >= 0 || deadline_ms >= 0)
+		usb_stream_set_batch(flush_bytes >= 0 ? flush_bytes : USB_STREAM_FLUSH_BYTES,
+				deadline_ms >= 0 ? deadline_ms : USB_STREAM_DEADLINE_MS);
+
+	// measure from here: init traffic and the samples before are not counted
+	motion_start(sim_now());
+	icm20948_reset_spi_stats();
+	while(icm_sim_pop_drdy(&drdy));
+	sim_set_cpu_scale(cpu_scale);
+	t_start = sim_now();
+
+	for(i = 0; i < samples; )
+	{
+		if(cut < cuts && i >= (uint64_t)samples * (cut + 1) / (cuts + 1))
+		{
+			lost += power_cut();
+			flash_log_get_stats(&flash_log);
+			if(flash_log.mount_reads > mount_reads_max)
+				mount_reads_max = flash_log.mount_reads;
+			torn_pages += flash_log.torn_pages;
+			cut++;
+			if(divider >= 0)
+			{
+				icm20948_gyro_sample_rate_divider(divider);
+				icm20948_accel_sample_rate_divider(divider);
+			}
+			if(flush_bytes >= 0 || deadline_ms >= 0)
+				usb_stream_set_batch(flush_bytes >= 0 ? flush_bytes : USB_STREAM_FLUSH_BYTES,
+						deadline_ms >= 0 ? deadline_ms : USB_STREAM_DEADLINE_MS);
+			motion_start(sim_now());
+			while(icm_sim_pop_drdy(&drdy));
+			t_start = sim_now();
+		}
+
+		t0 = host_ns();
+		if(!app_process())
+			continue;
+		i++;
+		stat_add(&cpu, host_ns() - t0);
+
+		if(icm_sim_pop_drdy(&drdy))
+			stat_add(&latency, sim_now() - drdy);
+
+		if(sync && i >= samples / 2)
+		{
+			error_us = (int64_t)(timebase_us(timebase_ticks()) - pc_sync_now_us());
+			if(error_us > error_max_us || -error_us > error_max_us)
+				error_max_us = error_us < 0 ? -error_us : error_us;
+		}
+	}
+
+	// the sensor keeps sampling while the USB drains, nothing reads sample_ring any more
+	ring_dropped = sample_ring.dropped;
+	ring_high_water = sample_ring.high_water;
+
+	// let the last frames drain, and the last pages reach the flash
+	sim_set_cpu_scale(0);
+	HAL_Delay(USB_STREAM_DEADLINE_MS + 100);
+	t_end = sim_now();
+	flash_log_flush();
+	while(!flash_log_idle())
+	{
+		__WFI();
+		flash_log_process();
+	}
+
+	icm20948_get_spi_stats(&spi);
+	app_get_stats(&app);
+	usb_stream_get_stats(&usb);
+	hal_stub_usb_get_stats(&host_usb);
+	icm_sim_get_stats(&model);
+	sim_get_stats(&vm);
+	timebase_get_stats(&tb);
+	timesync_get_stats(&ts);
+	pc_sync_get_stats(&pc);
+	mt25ql512_get_stats(&flash);
+	mt25ql512_sim_get_stats(&flash_model);
+	flash_log_get_stats(&flash_log);
+
+	fprintf(stderr, "samples            %u at %.1f Hz, %s frames, %.3f s virtual\n", samples, icm_sim_odr_hz(),
+			tx_format == output_binary ? "binary" : "text", (t_end - t_start) / 1e9);
+	stat_print("host cpu/sample", &cpu, "us", 1e3);
+	stat_print("drdy->queued", &latency, "us", 1e3);
+	if(ring_dropped)
+		fprintf(stderr, "                   latency is approximate, samples were dropped\n");
+	fprintf(stderr, "spi                %u transactions, %u bank selects, %u skipped, %u errors, %u samples lost to a full queue\n",
+			spi.transactions, spi.bank_selects, spi.bank_selects_skipped, spi.errors, app.spi_dropped);
+	fprintf(stderr, "sample ring        %u dropped, high water %u / %u bytes\n",
+			ring_dropped, ring_high_water, sample_ring.size);
+	fprintf(stderr, "usb stream         %u frames, %u dropped, %u transfers (%u on deadline), high water %u / %u bytes\n",
+			usb.frames, usb.dropped_frames, usb.transfers, usb.deadline_transfers, usb.high_water, USB_STREAM_RING_SIZE);
+	fprintf(stderr, "usb host           %llu bytes, %llu packets, %.1f bytes/packet, %.1f kB/s\n",
+			(unsigned long long)host_usb.bytes, (unsigned long long)host_usb.packets,
+			host_usb.packets ? (double)host_usb.bytes / host_usb.packets : 0,
+			host_usb.last_ns > t_start ? host_usb.bytes / ((host_usb.last_ns - t_start) / 1e9) / 1e3 : 0);
+	fprintf(stderr, "timebase           %u RTC seconds, %u rejected, TIM2 %u ticks/s%s\n",
+			tb.seconds, tb.rejected, tb.ticks_per_second, tb.locked ? "" : " (nominal)");
+	if(sync)
+	{
+		fprintf(stderr, "time sync          %u rounds, %u steps, %u/%u replies, calibration %d ppb (crystal %+d ppm)\n",
+				ts.rounds, ts.steps, ts.replies, ts.requests, ts.calib_ppb, rtc_ppm);
+		fprintf(stderr, "                   last offset %d us, round trip %u us, error vs PC %lld us now, %lld us max\n",
+				ts.offset_us, ts.delay_us, (long long)(timebase_us(timebase_ticks()) - pc_sync_now_us()),
+				(long long)error_max_us);
+	}
+	fprintf(stderr, "sensor model       %u samples, %u mag, %u mag overruns, %u fifo overflows\n",
+			model.samples, model.mag_measurements, model.mag_overruns, model.fifo_overflows);
+	fprintf(stderr, "flash log          %u records, %u dropped, %u pages, %u blocks opened, %u erases, %u errors, "
+			"staging high water %u / %u pages\n", flash_log.records, flash_log.dropped_records, flash_log.pages,
+			flash_log.blocks, flash_log.erases, flash_log.errors, flash_log.staging_high_water, FLASH_LOG_STAGING_PAGES);
+	log_check();
+	index_check("live");
+	// mount again, the index comes from the checkpoints
+	while(mt25ql512_busy())
+		__WFI();
+	flash_log_init();
+	index_check("mounted");
+	if(cuts)
+		fprintf(stderr, "power cuts         %u, %u flash operations torn, %u torn pages found, %u committed records lost, "
+				"mount %u reads max\n", cuts, flash_model.torn, torn_pages, lost, mount_reads_max);
+	if(flash_check || flash_file)
+	{
+		fprintf(stderr, "flash              %u pages, %u subsector / %u sector erases, %u errors\n",
+				flash.pages, flash.subsector_erases, flash.sector_erases, flash.errors);
+		fprintf(stderr, "flash model        %u commands, %u ignored, %u protocol errors, %u erases max per subsector\n",
+				flash_model.commands, flash_model.ignored, flash_model.protocol_errors, flash_model.max_erase_count);
+	}
+	if(dump_blocks)
+		dump_check(dump_blocks, dump_pulls, packets_per_ms);
+	fprintf(stderr, "cpu                %.1f %% asleep, %llu interrupts\n",
+			100.0 * vm.sleep_ns / (sim_now() ? sim_now() : 1), (unsigned long long)vm.events);
+
+	if(capture)
+		fclose(capture);
+	mt25ql512_sim_close();
+	return 0;
+}
+
+
+/* Static Functions */
+static uint64_t host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+static void stat_add(bench_stat* s, uint64_t v)
+{
+	s->count++;
+	s->sum += v;
+	if(v < s->min)
+		s->min = v;
+	if(v > s->max)
+		s->max = v;
+}
+static void stat_print(const char* name, const bench_stat* s, const char* unit, double div)
+{
+	if(!s->count)
+	{
+		fprintf(stderr, "%-18s -\n", name);
+		return;
+	}
+	fprintf(stderr, "%-18s mean %.2f, min %.2f, max %.2f %s\n", name,
+			s->sum / div / s->count, s->min / div, s->max / div, unit);
+}
+//Valid blocks of the flash array, sorted by sequence number
+static uint32_t log_blocks(uint32_t* order)
+{
+	const uint8_t* array = mt25ql512_sim_array();
+	const flash_log_block_header* block;
+	uint32_t blocks = 0, b, i;
+
+	for(b = 0; b < FLASH_LOG_BLOCKS; b++)
+	{
+		block = (const flash_log_block_header*)(array + FLASH_LOG_BASE + b * FLASH_LOG_BLOCK_SIZE);
+		if(block->magic != FLASH_LOG_MAGIC || block->version != FLASH_LOG_VERSION ||
+				block->crc != crc16_ccitt((const uint8_t*)block, offsetof(flash_log_block_header, crc), 0xFFFF))
+			continue;
+		for(i = blocks++; i > 0; i--)
+		{
+			if((int32_t)(((const flash_log_block_header*)(array + FLASH_LOG_BASE + order[i - 1] * FLASH_LOG_BLOCK_SIZE))->seq -
+					block->seq) < 0)
+				break;
+			order[i] = order[i - 1];
+		}
+		order[i] = b;
+	}
+	return blocks;
+}
+//Read the log back in block order: the page CRCs, and the record numbers follow on but for the dropped records
+static void log_check(void)
+{
+	static uint32_t order[FLASH_LOG_BLOCKS];
+	const uint8_t* array = mt25ql512_sim_array();
+	const flash_log_page_header* page;
+	uint32_t blocks = log_blocks(order), pages = 0, bad = 0, records = 0, missing = 0, next = 0;
+	uint64_t first_us = 0, last_us = 0;
+	uint32_t i, j;
+	uint16_t crc;
+	bool started = false;
+
+	for(i = 0; i < blocks; i++)
+	{
+		for(j = 1; j < FLASH_LOG_PAGES; j++)
+		{
+			page = (const flash_log_page_header*)(array + FLASH_LOG_BASE + order[i] * FLASH_LOG_BLOCK_SIZE +
+					j * FLASH_LOG_PAGE_SIZE);
+			if(page->count == 0xFF)
+				break;
+			crc = crc16_ccitt((const uint8_t*)page, offsetof(flash_log_page_header, crc), 0xFFFF);
+			if(page->count > FLASH_LOG_RECORDS_PER_PAGE ||
+					page->crc != crc16_ccitt((const uint8_t*)(page + 1), page->count * FLASH_LOG_RECORD_LEN, crc))
+			{
+				bad++;
+				continue;
+			}
+			if(started && page->first_record != next)
+				missing += page->first_record - next;
+			if(!started)
+				first_us = page->timestamp_us;
+			started = true;
+			next = page->first_record + page->count;
+			last_us = page->timestamp_us + ((const flash_log_record*)(page + 1))[page->count - 1].offset_us;
+			records += page->count;
+			pages++;
+		}
+	}
+
+	fprintf(stderr, "flash log check    %u blocks, %u pages, %u records over %.3f s, %u bad pages, %u records missing\n",
+			blocks, pages, records, (int64_t)(last_us - first_us) / 1e6, bad, missing);
+}
+//Power lost in the middle of a flash operation, then on again: committed records the new mount does not have
+static uint32_t power_cut(void)
+{
+	flash_log_stats before, after;
+	uint32_t i;
+
+	for(i = 0; i < 1000 && !mt25ql512_busy(); i++)
+		app_process();
+	sim_advance(rand() % MT25QL512_SIM_PAGE_NS);
+	flash_log_get_stats(&before);
+
+	hal_stub_reset();
+	app_init();
+	flash_log_get_stats(&after);
+	return (int32_t)(before.committed - after.committed) > 0 ? before.committed - after.committed : 0;
+}
+//The first blocks of the log read back by the simulated PC, the samples go on meanwhile
+static void dump_check(uint32_t blocks, uint32_t pulls, uint32_t packets_per_ms)
+{
+	uint32_t length = blocks * FLASH_DUMP_BLOCK_SIZE;
+	uint64_t timeout;
+	double s;
+	usb_stream_stats before, usb;
+	hal_stub_usb_stats host;
+	flash_dump_stats dump;
+	pc_dump_stats pc;
+
+	if(tx_format != output_binary)
+	{
+		fprintf(stderr, "flash dump         needs binary frames\n");
+		return;
+	}
+
+	// the log stops, so the flash array stays as it was read
+	flash_log_enable(false);
+	while(!flash_log_idle())
+	{
+		__WFI();
+		flash_log_process();
+	}
+	usb_stream_get_stats(&before);
+
+	// at 250 kB/s at least
+	timeout = sim_now() + length * 4000ull + pulls * (PC_DUMP_UNPLUGGED_NS + PC_DUMP_REOPEN_NS) + SIM_NS_PER_S;
+	pc_dump_start(FLASH_LOG_BASE, length, pulls);
+	while(!pc_dump_done() && sim_now() < timeout)
+		app_process();
+
+	usb_stream_get_stats(&usb);
+	hal_stub_usb_get_stats(&host);
+	flash_dump_get_stats(&dump);
+	pc_dump_get_stats(&pc);
+	s = ((pc.done ? pc.done_ns : sim_now()) - pc.start_ns) / 1e9;
+
+	fprintf(stderr, "flash dump         %u KB in %.3f s, %.0f kB/s, %.1f %% of %u packets/ms, %u blocks kept, "
+			"%u bad blocks, %u differ from the flash, %u bad frames%s\n", length / 1024, s, pc.bytes / s / 1e3,
+			100.0 * pc.bytes / s / 1e3 / (packets_per_ms * USB_STREAM_PACKET_LEN), packets_per_ms, pc.blocks,
+			pc.bad_blocks, pc.differ, pc.bad_frames, pc.done ? "" : ", NOT DONE");
+	fprintf(stderr, "                   %u cable pulls, %u transfers lost, %u dumps, %.1f KB sent again, "
+			"%u bulk buffers cancelled, %u flash waits, %u sample frames dropped\n", pc.pulls, host.lost_transfers,
+			pc.commands, pc.discarded / 1024.0, usb.bulk_cancelled, dump.flash_waits,
+			usb.dropped_frames - before.dropped_frames);
+}
+//Random time ranges: flash_log_find() against the spans of the blocks read back from the flash array
+static void index_check(const char* when)
+{
+	static uint32_t order[FLASH_LOG_BLOCKS], seq[FLASH_LOG_BLOCKS];
+	static flash_log_span span[FLASH_LOG_BLOCKS];
+	const uint8_t* array = mt25ql512_sim_array();
+	const flash_log_page_header* page;
+	const flash_log_record* record;
+	flash_log_range range;
+	flash_log_stats log;
+	uint32_t blocks = log_blocks(order), n = 0, wrong = 0, queries = 10000;
+	uint32_t from, to, lo, hi, i, j;
+	uint64_t t0, ns;
+	uint16_t crc;
+
+	// span of every block with a good page, as the firmware has it
+	for(i = 0; i < blocks; i++)
+	{
+		span[n].first_s = FLASH_LOG_NO_TIME;
+		for(j = 1; j < FLASH_LOG_PAGES; j++)
+		{
+			page = (const flash_log_page_header*)(array + FLASH_LOG_BASE + order[i] * FLASH_LOG_BLOCK_SIZE +
+					j * FLASH_LOG_PAGE_SIZE);
+			crc = crc16_ccitt((const uint8_t*)page, offsetof(flash_log_page_header, crc), 0xFFFF);
+			if(page->count > FLASH_LOG_RECORDS_PER_PAGE ||
+					page->crc != crc16_ccitt((const uint8_t*)(page + 1), page->count * FLASH_LOG_RECORD_LEN, crc))
+				continue;
+			record = (const flash_log_record*)(page + 1);
+			if(span[n].first_s == FLASH_LOG_NO_TIME)
+				span[n].first_s = page->timestamp_us / 1000000;
+			span[n].last_s = (page->timestamp_us + (page->count ? record[page->count - 1].offset_us : 0)) / 1000000;
+		}
+		if(span[n].first_s == FLASH_LOG_NO_TIME)
+			continue;
+		seq[n] = ((const flash_log_block_header*)(array + FLASH_LOG_BASE + order[i] * FLASH_LOG_BLOCK_SIZE))->seq;
+		// a search needs the time to go forward
+		if(n && (span[n].first_s < span[n - 1].last_s || span[n].last_s < span[n].first_s))
+		{
+			fprintf(stderr, "index check        skipped, the time goes back in the log (-F runs, -P)\n");
+			return;
+		}
+		n++;
+	}
+	if(!n)
+		return;
+
+	ns = 0;
+	for(i = 0; i < queries; i++)
+	{
+		from = span[0].first_s - 5 + rand() % (span[n - 1].last_s - span[0].first_s + 10);
+		to = from + rand() % 60;
+		for(lo = 0; lo < n && span[lo].last_s < from; lo++);
+		for(hi = lo; hi < n && span[hi].first_s <= to; hi++);
+
+		t0 = host_ns();
+		flash_log_find(from, to, &range);
+		ns += host_ns() - t0;
+		if(range.blocks != hi - lo || (range.blocks && (range.first_seq != seq[lo] ||
+				range.first_s != span[lo].first_s || range.last_s != span[hi - 1].last_s)))
+			wrong++;
+	}
+
+	flash_log_get_stats(&log);
+	fprintf(stderr, "index check        %s: %u blocks, %u queries, %u wrong, %.2f us per query, %u spans rebuilt\n",
+			when, n, queries, wrong, ns / 1e3 / queries, log.spans_rebuilt);
+}
+//last sector of the flash: sector erase, subsector erase, a pattern programmed page by page on DMA, read back
+static bool flash_test(void)
+{
+	static uint8_t pattern[MT25QL512_SECTOR_SIZE];
+	const uint32_t base = MT25QL512_SIZE - MT25QL512_SECTOR_SIZE;
+	const uint8_t* mapped;
+	volatile int done;
+	uint64_t t0, erase_ns, subsector_ns, program_ns;
+	uint32_t i, errors = 0;
+
+	for(i = 0; i < sizeof(pattern); i++)
+		pattern[i] = (uint8_t)(i * 7 + (i >> 8));
+
+	if(!mt25ql512_init())
+	{
+		fprintf(stderr, "flash              not found\n");
+		return false;
+	}
+
+	t0 = sim_now();
+	if(!mt25ql512_erase(base, MT25QL512_SECTOR_SIZE))
+		errors++;
+	erase_ns = sim_now() - t0;
+
+	t0 = sim_now();
+	if(!mt25ql512_erase(base, MT25QL512_SUBSECTOR_SIZE))
+		errors++;
+	subsector_ns = sim_now() - t0;
+
+	// the CPU sleeps while a page programs
+	t0 = sim_now();
+	for(i = 0; i < sizeof(pattern); i += MT25QL512_PAGE_SIZE)
+	{
+		done = 0;
+		if(!mt25ql512_program_async(base + i, pattern + i, MT25QL512_PAGE_SIZE, flash_done, (void*)&done))
+		{
+			errors++;
+			break;
+		}
+		while(!done)
+		{
+			__WFI();
+			mt25ql512_poll();
+		}
+		if(done < 0)
+			errors++;
+	}
+	program_ns = sim_now() - t0;
+
+	mapped = mt25ql512_mapped(base);
+	if(!mapped || memcmp(mapped, pattern, sizeof(pattern)))
+		errors++;
+
+	fprintf(stderr, "flash test         64 KB erase %.1f ms, 4 KB erase %.1f ms, page program %.1f us (%.2f MB/s), %s\n",
+			erase_ns / 1e6, subsector_ns / 1e6, program_ns / 1e3 / (sizeof(pattern) / MT25QL512_PAGE_SIZE),
+			sizeof(pattern) / (program_ns / 1e9) / 1e6, errors ? "FAILED" : "read back ok");
+	return errors == 0;
+}
+static void flash_done(bool ok, void* ctx)
+{
+	*(volatile int*)ctx = ok ? 1 : -1;
+}
+static void usage(void)
+{
+	fprintf(stderr,
+			"usage: icm_bench [-n samples] [-d divider] [-f binary|text] [-m motion.csv] [-o capture.bin]\n"
+			"                 [-c cpu_scale] [-b flush_bytes] [-l deadline_ms] [-u packets_per_ms] [-p poll_ms]\n"
+			"                 [-t pll_error_ppm] [-s rtc_ppm[,offset_ms]] [-F flash.bin] [-q] [-P cuts]\n"
+			"                 [-D blocks[,pulls]] [-v]\n");
+	exit(2);
+}
@@ -0,0 +1,746 @@
+/**
+ * @file hal_stub.c
+ * @brief HAL, CMSIS and USB CDC stand-ins for the host build
+ *
+ * GPIO PA4 is the chip select of the simulated ICM20948, SPI1 DMA transfers go to its register model
+ * and complete after the time the bytes take on the bus.
+ * The RTC counts virtual time with an optional crystal error, smooth calibration and shifts, and raises alarm A
+ * on every second. TIM2 runs from the PLL with an optional error.
+ * CDC_Transmit_FS() hands the data to a simulated host that drains the IN endpoint at full-speed bulk rate,
+ * then the completion runs usb_stream_tx_complete() like CDC_TransmitCplt_FS() does on the board.
+ * What the host writes to the OUT endpoint reaches app_usb_receive() in the next 1 ms frame, like CDC_Receive_FS().
+ * A cable pull suspends the device and loses the transfer in flight, the IN endpoint is idle again once plugged in.
+ * QUADSPI commands go to the MT25QL512 model (mt25ql512_sim.c) and take the time of their phases on the bus:
+ * blocking calls advance the virtual time, the DMA transmit and the automatic polling complete in an interrupt.
+ * The memory-mapped window is the model's array, reads through it take no time.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "hal_stub.h"
+#include "icm20948_sim.h"
+#include "mt25ql512_sim.h"
+#include "sim.h"
+#include "main.h"
+#include "spi.h"
+#include "rtc.h"
+#include "tim.h"
+#include "quadspi.h"
+#include "usbd_cdc_if.h"
+#include "usb_stream.h"
+#include "app.h"
+#include <string.h>
+
+
+GPIO_TypeDef sim_gpioa, sim_gpiob, sim_gpioc;
+SPI_HandleTypeDef hspi1 = { .Init.BaudRate = HAL_STUB_SPI_HZ };
+RTC_HandleTypeDef hrtc = { .Init.AsynchPrediv = 127, .Init.SynchPrediv = 255 };
+TIM_HandleTypeDef htim2 = { .Init.Prescaler = 79, .Init.Period = 0xFFFFFFFF };
+QSPI_HandleTypeDef hqspi = { .Init.ClockPrescaler = 1, .Init.FlashSize = 25 };
+USBD_HandleTypeDef hUsbDeviceFS;
+
+static USBD_CDC_HandleTypeDef hcdc;
+
+// RTC: calendar time in ns since 1970 rtc_base_value_ns at virtual time rtc_base_ns
+static uint64_t rtc_base_value_ns;
+static uint64_t rtc_base_ns;
+static int32_t rtc_error_ppm;
+static double rtc_calibration;
+static uint32_t rtc_backup[RTC_BKP_NUMBER];
+
+// TIM2: counter value at virtual time tim_base_ns
+static int32_t pll_error_ppm;
+static uint64_t tim_base_ns;
+static uint32_t tim_base_count;
+
+static uint32_t usb_packets_per_ms = HAL_STUB_USB_PACKETS_PER_MS;
+static uint32_t usb_poll_ms;
+static FILE* usb_capture;
+static hal_stub_usb_stats usb_stats;
+static hal_stub_usb_host_fn usb_host[HAL_STUB_USB_HOSTS];
+
+// OUT packets written by the host, delivered in order
+typedef struct
+{
+	uint8_t data[CDC_DATA_FS_MAX_PACKET_SIZE];
+	uint16_t len;
+} usb_out_packet;
+
+// QUADSPI: command of the next data phase, DMA source, automatic polling
+static QSPI_CommandTypeDef qspi_cmd;
+static bool qspi_cmd_pending;
+static uint8_t* qspi_tx_data;
+static QSPI_AutoPollingTypeDef qspi_polling;
+
+static usb_out_packet usb_out[HAL_STUB_USB_OUT_QUEUE];
+static uint64_t usb_out_due[HAL_STUB_USB_OUT_QUEUE];
+static uint32_t usb_out_head, usb_out_count;
+
+
+static void spi_dma_done(void* ctx);
+static void usb_in_done(void* ctx);
+static void qspi_tx_done(void* ctx);
+static void qspi_poll(void* ctx);
+static uint64_t qspi_bus_ns(const QSPI_CommandTypeDef* cmd);
+static void usb_out_done(void* ctx);
+static void rtc_alarm(void* ctx);
+static void rtc_schedule_alarm(void);
+static uint64_t rtc_value_ns(void);
+static void rtc_rebase(void);
+static void seconds_to_rtc(uint32_t seconds, RTC_TimeTypeDef* time, RTC_DateTypeDef* date);
+static uint32_t rtc_to_seconds(const RTC_TimeTypeDef* time, const RTC_DateTypeDef* date);
+
+
+/**
+ * @brief Power on, virtual time restarts at 0
+ * @return None.
+ */
+void hal_stub_reset(void)
+{
+	// before the time restarts: a program or an erase still running is torn
+	mt25ql512_sim_reset();
+	sim_reset();
+
+	memset(&sim_gpioa, 0, sizeof(sim_gpioa));
+	memset(&sim_gpiob, 0, sizeof(sim_gpiob));
+	memset(&sim_gpioc, 0, sizeof(sim_gpioc));
+	// CS idles high
+	sim_gpioa.ODR = ICM20948_SPI_CS_PIN_NUMBER;
+	hspi1.State = 0;
+
+	rtc_base_value_ns = HAL_STUB_RTC_EPOCH * SIM_NS_PER_S;
+	rtc_base_ns = 0;
+	rtc_calibration = 0;
+	memset(rtc_backup, 0, sizeof(rtc_backup));
+	rtc_schedule_alarm();
+
+	hqspi.State = HAL_QSPI_STATE_READY;
+	qspi_cmd_pending = false;
+
+	htim2.running = 0;
+	tim_base_ns = 0;
+	tim_base_count = 0;
+
+	memset(&hcdc, 0, sizeof(hcdc));
+	memset(&usb_stats, 0, sizeof(usb_stats));
+	usb_out_head = 0;
+	usb_out_count = 0;
+	hUsbDeviceFS.dev_state = USBD_STATE_CONFIGURED;
+	hUsbDeviceFS.pClassData = &hcdc;
+
+	icm_sim_reset();
+}
+void hal_stub_clock_config(int32_t pll_ppm)
+{
+	pll_error_ppm = pll_ppm;
+}
+void hal_stub_rtc_config(int32_t crystal_ppm)
+{
+	rtc_rebase();
+	rtc_error_ppm = crystal_ppm;
+	rtc_schedule_alarm();
+}
+void hal_stub_usb_config(uint32_t packets_per_ms, uint32_t poll_ms)
+{
+	usb_packets_per_ms = packets_per_ms ? packets_per_ms : 1;
+	usb_poll_ms = poll_ms;
+}
+void hal_stub_usb_capture(FILE* f)
+{
+	usb_capture = f;
+}
+void hal_stub_usb_get_stats(hal_stub_usb_stats* stats)
+{
+	*stats = usb_stats;
+}
+void hal_stub_usb_host(hal_stub_usb_host_fn fn)
+{
+	int i;
+
+	for(i = 0; i < HAL_STUB_USB_HOSTS; i++)
+	{
+		if(usb_host[i] == fn || !usb_host[i])
+		{
+			usb_host[i] = fn;
+			return;
+		}
+	}
+}
+void hal_stub_usb_receive(const uint8_t* data, uint16_t len)
+{
+	uint32_t slot;
+	uint64_t frame;
+
+	if(hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED)
+		return;
+
+	while(len)
+	{
+		if(usb_out_count == HAL_STUB_USB_OUT_QUEUE)
+			return;
+
+		slot = (usb_out_head + usb_out_count++) % HAL_STUB_USB_OUT_QUEUE;
+		usb_out[slot].len = len < CDC_DATA_FS_MAX_PACKET_SIZE ? len : CDC_DATA_FS_MAX_PACKET_SIZE;
+		memcpy(usb_out[slot].data, data, usb_out[slot].len);
+		frame = (sim_now() / SIM_NS_PER_MS + 1) * SIM_NS_PER_MS;
+		usb_out_due[slot] = frame + HAL_STUB_USB_OUT_NS;
+		data += usb_out[slot].len;
+		len -= usb_out[slot].len;
+	}
+	if(usb_out_count)
+		sim_schedule(usb_out_due[usb_out_head] - sim_now(), usb_out_done, NULL);
+}
+
+void hal_stub_usb_connect(bool on)
+{
+	sim_enter();
+	if(!on && hUsbDeviceFS.dev_state == USBD_STATE_CONFIGURED)
+	{
+		if(hcdc.TxState != 0)
+			usb_stats.lost_transfers++;
+		sim_cancel(usb_in_done, NULL);
+		sim_cancel(usb_out_done, NULL);
+		usb_out_count = 0;
+		usb_stats.pulls++;
+		hUsbDeviceFS.dev_state = USBD_STATE_SUSPENDED;
+	}
+	else if(on && hUsbDeviceFS.dev_state != USBD_STATE_CONFIGURED)
+	{
+		hcdc.TxState = 0;
+		hUsbDeviceFS.dev_state = USBD_STATE_CONFIGURED;
+	}
+	sim_leave();
+}
+
+
+/* CMSIS */
+void __disable_irq(void)
+{
+	sim_enter();
+	sim_irq_mask(true);
+	sim_leave();
+}
+void __enable_irq(void)
+{
+	sim_enter();
+	sim_irq_mask(false);
+	sim_leave();
+}
+uint32_t __get_PRIMASK(void)
+{
+	return sim_irq_masked();
+}
+void __set_PRIMASK(uint32_t primask)
+{
+	sim_enter();
+	sim_irq_mask(primask & 1);
+	sim_leave();
+}
+void __WFI(void)
+{
+	sim_enter();
+	sim_wait_for_interrupt();
+	sim_leave();
+}
+
+
+/* System */
+uint32_t HAL_GetTick(void)
+{
+	uint32_t tick;
+
+	sim_enter();
+	sim_advance(SIM_POLL_NS);
+	tick = (uint32_t)(sim_now() / SIM_NS_PER_MS);
+	sim_leave();
+
+	return tick;
+}
+void HAL_Delay(uint32_t Delay)
+{
+	sim_enter();
+	sim_advance(Delay * SIM_NS_PER_MS);
+	sim_leave();
+}
+
+
+/* GPIO */
+void HAL_GPIO_WritePin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	sim_enter();
+	if(PinState == GPIO_PIN_RESET)
+		GPIOx->ODR &= ~GPIO_Pin;
+	else
+		GPIOx->ODR |= GPIO_Pin;
+
+	if(GPIOx == ICM20948_SPI_CS_PIN_PORT && GPIO_Pin == ICM20948_SPI_CS_PIN_NUMBER)
+		icm_sim_cs(PinState == GPIO_PIN_RESET);
+	sim_leave();
+}
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+
+/* SPI */
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef* hspi, uint8_t* pTxData, uint8_t* pRxData, uint16_t Size)
+{
+	uint64_t bus_ns;
+
+	if(hspi->State)
+		return HAL_BUSY;
+	if(Size == 0)
+		return HAL_ERROR;
+
+	sim_enter();
+	// the model answers right away, the DMA interrupt comes once the bytes are clocked out
+	icm_sim_spi_transfer(pTxData, pRxData, Size);
+	hspi->State = 1;
+	bus_ns = (uint64_t)Size * 8 * SIM_NS_PER_S / hspi->Init.BaudRate;
+	sim_schedule(bus_ns + HAL_STUB_DMA_SETUP_NS, spi_dma_done, hspi);
+	sim_leave();
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef* hspi)
+{
+	sim_enter();
+	sim_cancel(spi_dma_done, hspi);
+	hspi->State = 0;
+	sim_leave();
+
+	return HAL_OK;
+}
+
+
+/* RTC, binary format only */
+HAL_StatusTypeDef HAL_RTC_GetTime(RTC_HandleTypeDef* hrtc, RTC_TimeTypeDef* sTime, uint32_t Format)
+{
+	RTC_DateTypeDef date;
+	uint64_t value = rtc_value_ns();
+
+	seconds_to_rtc((uint32_t)(value / SIM_NS_PER_S), sTime, &date);
+	// SubSeconds counts down from SynchPrediv
+	sTime->SecondFraction = hrtc->Init.SynchPrediv;
+	sTime->SubSeconds = hrtc->Init.SynchPrediv -
+			(uint32_t)(value % SIM_NS_PER_S * (hrtc->Init.SynchPrediv + 1) / SIM_NS_PER_S);
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RTC_GetDate(RTC_HandleTypeDef* hrtc, RTC_DateTypeDef* sDate, uint32_t Format)
+{
+	RTC_TimeTypeDef time;
+
+	seconds_to_rtc((uint32_t)(rtc_value_ns() / SIM_NS_PER_S), &time, sDate);
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RTC_SetTime(RTC_HandleTypeDef* hrtc, RTC_TimeTypeDef* sTime, uint32_t Format)
+{
+	RTC_TimeTypeDef time;
+	RTC_DateTypeDef date;
+
+	HAL_RTC_GetTime(hrtc, &time, Format);
+	HAL_RTC_GetDate(hrtc, &date, Format);
+	time.Hours = sTime->Hours;
+	time.Minutes = sTime->Minutes;
+	time.Seconds = sTime->Seconds;
+
+	// setting the time restarts the prescalers, the next second is 1 s away
+	rtc_base_value_ns = rtc_to_seconds(&time, &date) * SIM_NS_PER_S;
+	rtc_base_ns = sim_now();
+	rtc_schedule_alarm();
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RTC_SetDate(RTC_HandleTypeDef* hrtc, RTC_DateTypeDef* sDate, uint32_t Format)
+{
+	RTC_TimeTypeDef time;
+	RTC_DateTypeDef date;
+	uint64_t value = rtc_value_ns();
+
+	HAL_RTC_GetTime(hrtc, &time, Format);
+	HAL_RTC_GetDate(hrtc, &date, Format);
+	date.Year = sDate->Year;
+	date.Month = sDate->Month;
+	date.Date = sDate->Date;
+
+	rtc_base_value_ns = rtc_to_seconds(&time, &date) * SIM_NS_PER_S + value % SIM_NS_PER_S;
+	rtc_base_ns = sim_now();
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RTCEx_SetSynchroShift(RTC_HandleTypeDef* hrtc, uint32_t ShiftAdd1S, uint32_t ShiftSubFS)
+{
+	if(ShiftSubFS > hrtc->Init.SynchPrediv)
+		return HAL_ERROR;
+
+	rtc_rebase();
+	if(ShiftAdd1S == RTC_SHIFTADD1S_SET)
+		rtc_base_value_ns += SIM_NS_PER_S;
+	rtc_base_value_ns -= ShiftSubFS * SIM_NS_PER_S / (hrtc->Init.SynchPrediv + 1);
+	rtc_schedule_alarm();
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef* hrtc, uint32_t SmoothCalibPeriod, uint32_t SmoothCalibPlusPulses,
+		uint32_t SmoothCalibMinusPulsesValue)
+{
+	double pulses = (SmoothCalibPlusPulses == RTC_SMOOTHCALIB_PLUSPULSES_SET ? 512.0 : 0.0) - SmoothCalibMinusPulsesValue;
+
+	if(SmoothCalibMinusPulsesValue > 511)
+		return HAL_ERROR;
+
+	// RM0394: f_cal = f_rtcclk * (1 + (CALP * 512 - CALM) / (2^20 + CALM - CALP * 512))
+	rtc_rebase();
+	rtc_calibration = pulses / (1048576.0 - pulses);
+	rtc_schedule_alarm();
+
+	return HAL_OK;
+}
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister, uint32_t Data)
+{
+	rtc_backup[BackupRegister] = Data;
+}
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister)
+{
+	return rtc_backup[BackupRegister];
+}
+
+
+/* USB CDC */
+/**
+ * @brief Same contract as usbd_cdc_if.c: USBD_BUSY while the previous transfer is in flight
+ * The host reads the transfer in 64 byte packets, plus a ZLP if it ends on a packet boundary.
+ * @return USBD_OK / USBD_BUSY.
+ */
+uint8_t CDC_Transmit_FS(uint8_t* Buf, uint16_t Len)
+{
+	uint64_t packets, start, done;
+
+	if(hcdc.TxState != 0)
+	{
+		usb_stats.busy++;
+		return USBD_BUSY;
+	}
+
+	sim_enter();
+	hcdc.TxState = 1;
+	hcdc.TxBuffer = Buf;
+	hcdc.TxLength = Len;
+
+	if(usb_capture)
+		fwrite(Buf, 1, Len, usb_capture);
+
+	packets = (Len + CDC_DATA_FS_MAX_PACKET_SIZE - 1) / CDC_DATA_FS_MAX_PACKET_SIZE;
+	if(Len % CDC_DATA_FS_MAX_PACKET_SIZE == 0)
+		packets++;
+
+	// a polling host only starts reading at its next poll
+	start = sim_now();
+	if(usb_poll_ms)
+		start = (start / (usb_poll_ms * SIM_NS_PER_MS) + 1) * usb_poll_ms * SIM_NS_PER_MS;
+	done = start + packets * SIM_NS_PER_MS / usb_packets_per_ms;
+
+	usb_stats.transfers++;
+	usb_stats.bytes += Len;
+	usb_stats.packets += packets;
+	sim_schedule(done - sim_now(), usb_in_done, NULL);
+	sim_leave();
+
+	return USBD_OK;
+}
+
+
+/* QUADSPI, indirect mode on one MT25QL512 */
+/**
+ * @brief Without a data phase the command runs right away, otherwise it waits for the data call
+ * @return HAL_BUSY unless the QUADSPI is idle, HAL_ERROR if the device ignored the command.
+ */
+HAL_StatusTypeDef HAL_QSPI_Command(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, uint32_t Timeout)
+{
+	bool ok;
+
+	if(hqspi->State != HAL_QSPI_STATE_READY)
+		return HAL_BUSY;
+
+	qspi_cmd = *cmd;
+	qspi_cmd_pending = cmd->DataMode != QSPI_DATA_NONE;
+	if(qspi_cmd_pending)
+		return HAL_OK;
+
+	sim_enter();
+	ok = mt25ql512_sim_command(cmd, NULL, 0);
+	sim_advance(qspi_bus_ns(cmd));
+	sim_leave();
+
+	return ok ? HAL_OK : HAL_ERROR;
+}
+HAL_StatusTypeDef HAL_QSPI_Transmit(QSPI_HandleTypeDef* hqspi, uint8_t* pData, uint32_t Timeout)
+{
+	bool ok;
+
+	if(hqspi->State != HAL_QSPI_STATE_READY || !qspi_cmd_pending)
+		return HAL_ERROR;
+
+	sim_enter();
+	qspi_cmd_pending = false;
+	ok = mt25ql512_sim_command(&qspi_cmd, pData, qspi_cmd.NbData);
+	sim_advance(qspi_bus_ns(&qspi_cmd));
+	sim_leave();
+
+	return ok ? HAL_OK : HAL_ERROR;
+}
+HAL_StatusTypeDef HAL_QSPI_Receive(QSPI_HandleTypeDef* hqspi, uint8_t* pData, uint32_t Timeout)
+{
+	return HAL_QSPI_Transmit(hqspi, pData, Timeout);
+}
+/**
+ * @brief The device gets the data once the DMA has clocked it out, then HAL_QSPI_TxCpltCallback()
+ * @return HAL_ERROR without a command waiting for its data phase.
+ */
+HAL_StatusTypeDef HAL_QSPI_Transmit_DMA(QSPI_HandleTypeDef* hqspi, uint8_t* pData)
+{
+	if(hqspi->State != HAL_QSPI_STATE_READY || !qspi_cmd_pending)
+		return HAL_ERROR;
+
+	sim_enter();
+	qspi_cmd_pending = false;
+	qspi_tx_data = pData;
+	hqspi->State = HAL_QSPI_STATE_BUSY_INDIRECT_TX;
+	sim_schedule(qspi_bus_ns(&qspi_cmd) + HAL_STUB_DMA_SETUP_NS, qspi_tx_done, hqspi);
+	sim_leave();
+
+	return HAL_OK;
+}
+/**
+ * @brief Read the status every Interval cycles until (status & Mask) matches, then HAL_QSPI_StatusMatchCallback()
+ * Only the AND match mode with the automatic stop, as mt25ql512.c uses it.
+ * @return HAL_ERROR for another configuration.
+ */
+HAL_StatusTypeDef HAL_QSPI_AutoPolling_IT(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, QSPI_AutoPollingTypeDef* cfg)
+{
+	if(hqspi->State != HAL_QSPI_STATE_READY)
+		return HAL_BUSY;
+	if(cfg->MatchMode != QSPI_MATCH_MODE_AND || cfg->AutomaticStop != QSPI_AUTOMATIC_STOP_ENABLE ||
+			cfg->StatusBytesSize != 1 || cmd->NbData != 1)
+		return HAL_ERROR;
+
+	sim_enter();
+	qspi_cmd = *cmd;
+	qspi_polling = *cfg;
+	hqspi->State = HAL_QSPI_STATE_BUSY_AUTO_POLLING;
+	sim_schedule(qspi_bus_ns(cmd), qspi_poll, hqspi);
+	sim_leave();
+
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_QSPI_MemoryMapped(QSPI_HandleTypeDef* hqspi, QSPI_CommandTypeDef* cmd, QSPI_MemoryMappedTypeDef* cfg)
+{
+	bool ok;
+
+	if(hqspi->State != HAL_QSPI_STATE_READY)
+		return HAL_BUSY;
+
+	sim_enter();
+	ok = mt25ql512_sim_mapped_command(cmd);
+	if(ok)
+		hqspi->State = HAL_QSPI_STATE_BUSY_MEM_MAPPED;
+	sim_leave();
+
+	return ok ? HAL_OK : HAL_ERROR;
+}
+HAL_StatusTypeDef HAL_QSPI_Abort(QSPI_HandleTypeDef* hqspi)
+{
+	sim_enter();
+	sim_cancel(qspi_tx_done, hqspi);
+	sim_cancel(qspi_poll, hqspi);
+	qspi_cmd_pending = false;
+	hqspi->State = HAL_QSPI_STATE_READY;
+	sim_leave();
+
+	return HAL_OK;
+}
+const uint8_t* hal_stub_qspi_base(void)
+{
+	return mt25ql512_sim_array();
+}
+
+
+/* TIM2 */
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim)
+{
+	tim_base_count = hal_stub_tim_counter(htim);
+	tim_base_ns = sim_now();
+	htim->running = 1;
+	return HAL_OK;
+}
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef* htim)
+{
+	tim_base_count = hal_stub_tim_counter(htim);
+	htim->running = 0;
+	return HAL_OK;
+}
+uint32_t hal_stub_tim_counter(TIM_HandleTypeDef* htim)
+{
+	double hz = (double)HAL_STUB_TIM_CLK_HZ / (htim->Init.Prescaler + 1) * (1.0 + pll_error_ppm * 1e-6);
+
+	if(!htim->running)
+		return tim_base_count;
+	return tim_base_count + (uint32_t)(uint64_t)((sim_now() - tim_base_ns) * hz / SIM_NS_PER_S);
+}
+
+
+/* Static Functions */
+static void spi_dma_done(void* ctx)
+{
+	SPI_HandleTypeDef* hspi = ctx;
+
+	hspi->State = 0;
+	HAL_SPI_TxRxCpltCallback(hspi);
+}
+//QUADSPI transfer complete: the last byte is out, the device starts the program
+static void qspi_tx_done(void* ctx)
+{
+	QSPI_HandleTypeDef* hqspi = ctx;
+	bool ok = mt25ql512_sim_command(&qspi_cmd, qspi_tx_data, qspi_cmd.NbData);
+
+	hqspi->State = HAL_QSPI_STATE_READY;
+	if(ok)
+		HAL_QSPI_TxCpltCallback(hqspi);
+	else
+		HAL_QSPI_ErrorCallback(hqspi);
+}
+//one automatic polling read, the next one Interval cycles later, or as soon as the device is due to be ready
+static void qspi_poll(void* ctx)
+{
+	QSPI_HandleTypeDef* hqspi = ctx;
+	uint64_t clock_hz = HAL_STUB_QSPI_KER_HZ / (hqspi->Init.ClockPrescaler + 1);
+	uint64_t interval = qspi_polling.Interval * SIM_NS_PER_S / clock_hz;
+	uint64_t busy;
+	uint8_t status = 0;
+
+	mt25ql512_sim_command(&qspi_cmd, &status, 1);
+	if((status & qspi_polling.Mask) == qspi_polling.Match)
+	{
+		hqspi->State = HAL_QSPI_STATE_READY;
+		HAL_QSPI_StatusMatchCallback(hqspi);
+		return;
+	}
+
+	// the reads in between would all miss, skip them
+	busy = mt25ql512_sim_busy_ns();
+	if(interval && busy > interval)
+		interval = (busy + interval - 1) / interval * interval;
+	sim_schedule(interval + qspi_bus_ns(&qspi_cmd), qspi_poll, hqspi);
+}
+//instruction, address, dummy cycles and data phases of a command at the QUADSPI clock
+static uint64_t qspi_bus_ns(const QSPI_CommandTypeDef* cmd)
+{
+	static const uint32_t lines[4] = { 0, 1, 2, 4 };
+	uint64_t clock_hz = HAL_STUB_QSPI_KER_HZ / (hqspi.Init.ClockPrescaler + 1);
+	uint32_t instruction_lines = lines[(cmd->InstructionMode >> 8) & 3];
+	uint32_t address_lines = lines[(cmd->AddressMode >> 10) & 3];
+	uint32_t data_lines = lines[(cmd->DataMode >> 24) & 3];
+	uint64_t cycles = cmd->DummyCycles;
+
+	if(instruction_lines)
+		cycles += 8 / instruction_lines;
+	if(address_lines)
+		cycles += 8 * ((cmd->AddressSize >> 12) + 1) / address_lines;
+	if(data_lines)
+		cycles += 8ull * cmd->NbData / data_lines;
+
+	return cycles * SIM_NS_PER_S / clock_hz;
+}
+//USBD_CDC_DataIn(): the IN transfer is done, CDC_TransmitCplt_FS() queues the next one
+static void usb_in_done(void* ctx)
+{
+	int i;
+
+	if(!usb_stats.first_ns)
+		usb_stats.first_ns = sim_now();
+	usb_stats.last_ns = sim_now();
+	for(i = 0; i < HAL_STUB_USB_HOSTS && usb_host[i]; i++)
+		usb_host[i](hcdc.TxBuffer, hcdc.TxLength);
+
+	hcdc.TxState = 0;
+	usb_stream_tx_complete();
+}
+//USBD_CDC_DataOut(): CDC_Receive_FS() hands the packet to the application
+static void usb_out_done(void* ctx)
+{
+	usb_out_packet* packet = &usb_out[usb_out_head];
+
+	usb_out_head = (usb_out_head + 1) % HAL_STUB_USB_OUT_QUEUE;
+	usb_out_count--;
+	if(usb_out_count)
+		sim_schedule(usb_out_due[usb_out_head] - sim_now(), usb_out_done, NULL);
+
+	app_usb_receive(packet->data, packet->len);
+}
+//days from 1970-01-01 to a civil date and back, proleptic Gregorian
+static void seconds_to_rtc(uint32_t seconds, RTC_TimeTypeDef* time, RTC_DateTypeDef* date)
+{
+	int32_t z = seconds / 86400 + 719468;
+	int32_t era = z / 146097;
+	uint32_t doe = z - era * 146097;
+	uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	uint32_t mp = (5 * doy + 2) / 153;
+	uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+	uint32_t year = yoe + era * 400 + (month <= 2);
+
+	memset(time, 0, sizeof(*time));
+	time->Hours = seconds / 3600 % 24;
+	time->Minutes = seconds / 60 % 60;
+	time->Seconds = seconds % 60;
+
+	date->Year = year - 2000;
+	date->Month = month;
+	date->Date = doy - (153 * mp + 2) / 5 + 1;
+	// 1970-01-01 was a Thursday, RTC_WEEKDAY_MONDAY = 1
+	date->WeekDay = (seconds / 86400 + 3) % 7 + 1;
+}
+static uint32_t rtc_to_seconds(const RTC_TimeTypeDef* time, const RTC_DateTypeDef* date)
+{
+	int32_t y = 2000 + date->Year - (date->Month <= 2);
+	int32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t mp = date->Month > 2 ? date->Month - 3 : date->Month + 9;
+	uint32_t doy = (153 * mp + 2) / 5 + date->Date - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	uint32_t days = era * 146097 + doe - 719468;
+
+	return days * 86400 + time->Hours * 3600 + time->Minutes * 60 + time->Seconds;
+}
+//alarm A, all fields masked: every time the second increments
+static void rtc_alarm(void* ctx)
+{
+	rtc_schedule_alarm();
+	HAL_RTC_AlarmAEventCallback(&hrtc);
+}
+static void rtc_schedule_alarm(void)
+{
+	double rate = (1.0 + rtc_error_ppm * 1e-6) * (1.0 + rtc_calibration);
+	uint64_t left = SIM_NS_PER_S - rtc_value_ns() % SIM_NS_PER_S;
+
+	// rounded up, the second has incremented when the interrupt runs
+	sim_schedule((uint64_t)(left / rate) + 1, rtc_alarm, NULL);
+}
+//the RTC runs at the crystal frequency, corrected by the smooth calibration
+static uint64_t rtc_value_ns(void)
+{
+	double rate = (1.0 + rtc_error_ppm * 1e-6) * (1.0 + rtc_calibration);
+
+	return rtc_base_value_ns + (uint64_t)((sim_now() - rtc_base_ns) * rate);
+}
+//before the rate or the value changes
+static void rtc_rebase(void)
+{
+	rtc_base_value_ns = rtc_value_ns();
+	rtc_base_ns = sim_now();
+}
@@ -0,0 +1,542 @@
+/**
+ * @file icm20948_sim.c
+ * @brief Simulated ICM20948 and AK09916 for the host build
+ *
+ * The model covers what Core/Src/icm20948.c relies on:
+ * 1. Four user banks of registers, REG_BANK_SEL, auto-incrementing bursts, clear-on-read status registers.
+ * 2. Device reset, sleep, full-scale selection, sample rate divider, gyroscope and accelerometer user offsets.
+ * 3. The sample clock: output registers, RAW_DATA_0_RDY and the INT1 pulse (HAL_GPIO_EXTI_Callback()).
+ * 4. FIFO in stream and snapshot mode, FIFO_EN_1 / FIFO_EN_2 record layout, FIFO_COUNT, FIFO_R_W, overflow.
+ * 5. The I2C master: I2C_SLV0 reads or writes at every master cycle (EXT_SLV_SENS_DATA mirroring),
+ *    I2C_SLV4 single transfers with I2C_MST_STATUS done / NACK. I2C_SLV1 ~ 3 are not modelled.
+ * 6. The AK09916: WIA, continuous and single measurement modes, ST1 DRDY / DOR, ST2 HOFL and the data lock
+ *    released by reading ST2, soft reset.
+ *
+ * Timing is cycle-approximate: register effects are immediate, the SPI transfer time is modelled
+ * by the DMA completion in hal_stub.c, the sample and I2C master clocks run on virtual time.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "icm20948_sim.h"
+#include "icm20948.h"
+#include "motion.h"
+#include "sim.h"
+#include <math.h>
+#include <string.h>
+
+#define ICM_SIM_FIFO_SIZE				ICM20948_FIFO_SIZE
+#define ICM_SIM_BASE_RATE_HZ			1125.0	// gyroscope / accelerometer ODR before the divider
+#define ICM_SIM_I2C_BASE_RATE_HZ		1100.0	// I2C_MST_ODR_CONFIG base rate
+
+#define AK_WIA1							0x00
+#define AK_TMPS							0x17
+#define AK_REG_COUNT					0x40
+#define AK_MAX_LSB						32752	// 4912 uT
+
+
+static uint8_t regs[4][128];
+static uint8_t bank;
+static bool cs_low;
+
+static uint8_t fifo[ICM_SIM_FIFO_SIZE];
+static uint16_t fifo_head;
+static uint16_t fifo_count;
+
+static uint8_t ak[AK_REG_COUNT];
+
+static uint64_t drdy_log[ICM_SIM_DRDY_LOG_LEN];
+static uint32_t drdy_head;
+static uint32_t drdy_tail;
+
+static icm_sim_stats stats;
+
+
+static uint8_t reg_read(uint8_t reg);
+static void reg_write(uint8_t reg, uint8_t val);
+static void device_reset(void);
+static bool asleep(void);
+
+static void sample_tick(void* ctx);
+static void i2c_tick(void* ctx);
+static void i2c_master_cycle(void);
+static void update_outputs(void);
+static void fifo_push_sample(void);
+static void fifo_push(const uint8_t* data, uint16_t len);
+
+static void ak_reset(void);
+static uint8_t ak_read(uint8_t reg);
+static void ak_write(uint8_t reg, uint8_t val);
+static void ak_tick(void* ctx);
+static uint64_t ak_period_ns(void);
+
+static void put_be16(uint8_t* p, double val);
+static int16_t get_be16(const uint8_t* p);
+
+
+/**
+ * @brief Power on: registers at their reset values, clocks started
+ * @return None.
+ */
+void icm_sim_reset(void)
+{
+	memset(&stats, 0, sizeof(stats));
+	drdy_head = drdy_tail = 0;
+	cs_low = false;
+
+	device_reset();
+	ak_reset();
+
+	sim_schedule((uint64_t)(SIM_NS_PER_S / ICM_SIM_BASE_RATE_HZ), sample_tick, NULL);
+	sim_schedule(SIM_NS_PER_MS, i2c_tick, NULL);
+}
+/**
+ * @brief Chip select of SPI1, PA4
+ * @return None.
+ */
+void icm_sim_cs(bool low)
+{
+	if(low && !cs_low)
+		stats.spi_transfers++;
+	cs_low = low;
+}
+/**
+ * @brief One full-duplex transfer: register address first, then data, the address auto-increments
+ * except on FIFO_R_W. rx[0] is the dummy byte clocked out during the address.
+ * @return None.
+ */
+void icm_sim_spi_transfer(const uint8_t* tx, uint8_t* rx, uint16_t len)
+{
+	uint8_t reg = tx[0] & 0x7F;
+	bool read = tx[0] & READ;
+	uint16_t i;
+
+	if(!cs_low)
+	{
+		stats.spi_errors++;
+		memset(rx, 0xFF, len);
+		return;
+	}
+	stats.spi_bytes += len;
+
+	rx[0] = 0x00;
+	for(i = 1; i < len; i++)
+	{
+		if(read)
+			rx[i] = reg_read(reg);
+		else
+		{
+			rx[i] = 0x00;
+			reg_write(reg, tx[i]);
+		}
+
+		if(!(bank == 0 && reg == B0_FIFO_R_W))
+			reg = (reg + 1) & 0x7F;
+	}
+}
+/**
+ * @brief Gyroscope / accelerometer output data rate, 1.125 kHz / (1 + GYRO_SMPLRT_DIV)
+ * @return Hz.
+ */
+double icm_sim_odr_hz(void)
+{
+	return ICM_SIM_BASE_RATE_HZ / (1 + regs[2][B2_GYRO_SMPLRT_DIV]);
+}
+/**
+ * @brief Oldest data ready pulse not yet consumed by the bench
+ * @return false if none is logged.
+ */
+bool icm_sim_pop_drdy(uint64_t* t_ns)
+{
+	if(drdy_tail == drdy_head)
+		return false;
+
+	*t_ns = drdy_log[drdy_tail % ICM_SIM_DRDY_LOG_LEN];
+	drdy_tail++;
+	return true;
+}
+/**
+ * @brief Copy of the model counters
+ * @return None.
+ */
+void icm_sim_get_stats(icm_sim_stats* out)
+{
+	*out = stats;
+}
+
+
+/* Static Functions */
+static uint8_t reg_read(uint8_t reg)
+{
+	uint8_t val;
+
+	if(reg == REG_BANK_SEL)
+		return bank << 4;
+
+	val = regs[bank][reg];
+	if(bank != 0)
+		return val;
+
+	switch(reg)
+	{
+	// clear on read
+	case B0_I2C_MST_STATUS:
+	case B0_INT_STATUS:
+	case B0_INT_STATUS_1:
+	case B0_INT_STATUS_2:
+	case B0_INT_STATUS_3:
+		regs[0][reg] = 0;
+		break;
+	case B0_FIFO_COUNTH:
+		val = (fifo_count >> 8) & 0x1F;
+		break;
+	case B0_FIFO_COUNTL:
+		val = fifo_count & 0xFF;
+		break;
+	case B0_FIFO_R_W:
+		if(fifo_count == 0)
+			return 0xFF;
+		val = fifo[fifo_head];
+		fifo_head = (fifo_head + 1) % ICM_SIM_FIFO_SIZE;
+		fifo_count--;
+		break;
+	}
+
+	return val;
+}
+static void reg_write(uint8_t reg, uint8_t val)
+{
+	if(reg == REG_BANK_SEL)
+	{
+		bank = (val >> 4) & 0x03;
+		stats.bank_writes++;
+		return;
+	}
+
+	if(bank == 0)
+	{
+		switch(reg)
+		{
+		// read only
+		case B0_WHO_AM_I:
+		case B0_I2C_MST_STATUS:
+		case B0_INT_STATUS:
+		case B0_INT_STATUS_1:
+		case B0_INT_STATUS_2:
+		case B0_INT_STATUS_3:
+		case B0_FIFO_COUNTH:
+		case B0_FIFO_COUNTL:
+			return;
+		case B0_PWR_MGMT_1:
+			// DEVICE_RESET, the bit clears itself
+			if(val & 0x80)
+			{
+				device_reset();
+				return;
+			}
+			break;
+		case B0_USER_CTRL:
+			// I2C_MST_RST: abort the pending single transfer
+			if(val & 0x02)
+				regs[3][B3_I2C_SLV4_CTRL] &= ~0x80;
+			// SRAM_RST
+			if(val & 0x04)
+				fifo_head = fifo_count = 0;
+			// the reset bits clear themselves
+			val &= ~0x0E;
+			break;
+		case B0_FIFO_RST:
+			if(val & 0x1F)
+				fifo_head = fifo_count = 0;
+			break;
+		case B0_FIFO_R_W:
+			fifo_push(&val, 1);
+			return;
+		default:
+			// sensor outputs and EXT_SLV_SENS_DATA are read only
+			if(reg >= B0_ACCEL_XOUT_H && reg <= B0_EXT_SLV_SENS_DATA_23)
+				return;
+			break;
+		}
+	}
+
+	regs[bank][reg] = val;
+}
+//register reset values, page 31
+static void device_reset(void)
+{
+	memset(regs, 0, sizeof(regs));
+	bank = 0;
+	fifo_head = fifo_count = 0;
+
+	regs[0][B0_WHO_AM_I] = ICM20948_ID;
+	regs[0][B0_PWR_MGMT_1] = 0x41;
+	regs[0][B0_LP_CONFIG] = 0x40;
+	regs[2][B2_GYRO_CONFIG_1] = 0x01;
+	regs[2][B2_ACCEL_CONFIG] = 0x01;
+}
+//PWR_MGMT_1 SLEEP
+static bool asleep(void)
+{
+	return regs[0][B0_PWR_MGMT_1] & 0x40;
+}
+
+//Gyroscope / accelerometer ODR tick
+static void sample_tick(void* ctx)
+{
+	uint64_t period = (uint64_t)(SIM_NS_PER_S / icm_sim_odr_hz());
+
+	sim_schedule(period, sample_tick, NULL);
+	if(asleep())
+		return;
+
+	stats.samples++;
+	update_outputs();
+
+	// without I2C_MST_CYCLE the I2C master runs at the sensor ODR
+	if(!(regs[0][B0_LP_CONFIG] & 0x40))
+		i2c_master_cycle();
+
+	if(regs[0][B0_USER_CTRL] & 0x40)
+		fifo_push_sample();
+
+	// RAW_DATA_0_RDY_INT, and the INT1 pulse if enabled
+	regs[0][B0_INT_STATUS_1] |= 0x01;
+	if(regs[0][B0_INT_ENABLE_1] & 0x01)
+	{
+		stats.drdy_pulses++;
+		if(drdy_head - drdy_tail < ICM_SIM_DRDY_LOG_LEN)
+			drdy_log[drdy_head++ % ICM_SIM_DRDY_LOG_LEN] = sim_now();
+		HAL_GPIO_EXTI_Callback(ICM_INT_Pin);
+	}
+}
+//I2C master duty cycle clock, 1.1 kHz / 2^I2C_MST_ODR_CONFIG, only with LP_CONFIG I2C_MST_CYCLE
+static void i2c_tick(void* ctx)
+{
+	uint8_t odr_config = regs[3][B3_I2C_MST_ODR_CONFIG] & 0x0F;
+
+	sim_schedule((uint64_t)(SIM_NS_PER_S * (double)(1u << odr_config) / ICM_SIM_I2C_BASE_RATE_HZ), i2c_tick, NULL);
+
+	if(regs[0][B0_LP_CONFIG] & 0x40)
+		i2c_master_cycle();
+}
+//One I2C master cycle: I2C_SLV0, then a pending I2C_SLV4 single transfer
+static void i2c_master_cycle(void)
+{
+	uint8_t* b3 = regs[3];
+	uint8_t len, reg, i;
+
+	// USER_CTRL I2C_MST_EN
+	if(!(regs[0][B0_USER_CTRL] & 0x20))
+		return;
+
+	// I2C_SLV0_CTRL: EN, LENG[3:0]
+	if(b3[B3_I2C_SLV0_CTRL] & 0x80)
+	{
+		len = b3[B3_I2C_SLV0_CTRL] & 0x0F;
+		reg = b3[B3_I2C_SLV0_REG];
+
+		if((b3[B3_I2C_SLV0_ADDR] & 0x7F) != MAG_SLAVE_ADDR)
+			regs[0][B0_I2C_MST_STATUS] |= 0x01;				// I2C_SLV0_NACK
+		else if(b3[B3_I2C_SLV0_ADDR] & READ)
+		{
+			stats.slv0_reads++;
+			for(i = 0; i < len; i++)
+				regs[0][B0_EXT_SLV_SENS_DATA_00 + i] = ak_read(reg + i);
+		}
+		else
+			ak_write(reg, b3[B3_I2C_SLV0_DO]);
+	}
+
+	// I2C_SLV4_CTRL: EN, cleared when the transfer is done
+	if(b3[B3_I2C_SLV4_CTRL] & 0x80)
+	{
+		stats.slv4_transfers++;
+		b3[B3_I2C_SLV4_CTRL] &= ~0x80;
+
+		if((b3[B3_I2C_SLV4_ADDR] & 0x7F) != MAG_SLAVE_ADDR)
+			regs[0][B0_I2C_MST_STATUS] |= 0x40 | 0x10;		// I2C_SLV4_DONE, I2C_SLV4_NACK
+		else
+		{
+			if(b3[B3_I2C_SLV4_ADDR] & READ)
+				b3[B3_I2C_SLV4_DI] = ak_read(b3[B3_I2C_SLV4_REG]);
+			else
+				ak_write(b3[B3_I2C_SLV4_REG], b3[B3_I2C_SLV4_DO]);
+			regs[0][B0_I2C_MST_STATUS] |= 0x40;
+		}
+	}
+}
+//ACCEL_XOUT_H ~ TEMP_OUT_L from the motion, the full-scale range and the user offsets
+static void update_outputs(void)
+{
+	motion_state m;
+	uint8_t* b0 = regs[0];
+	int accel_fs = (regs[2][B2_ACCEL_CONFIG] >> 1) & 0x03;
+	int gyro_fs = (regs[2][B2_GYRO_CONFIG_1] >> 1) & 0x03;
+	double accel_lsb = 16384.0 / (1 << accel_fs);
+	double gyro_lsb = 131.0 / (1 << gyro_fs);
+	double offset;
+	int i;
+
+	motion_sample(sim_now(), &m);
+
+	for(i = 0; i < 3; i++)
+	{
+		// XA_OFFS: 15 bit, 0.98 mg per LSB, bit 0 reserved
+		offset = (get_be16(&regs[1][B1_XA_OFFS_H + 3 * i]) & ~1) * 8.0 / (1 << accel_fs);
+		put_be16(&b0[B0_ACCEL_XOUT_H + 2 * i], m.accel[i] * accel_lsb + offset);
+
+		// XG_OFFS_USR: 4 LSB of the 250 dps range per LSB
+		offset = get_be16(&regs[2][B2_XG_OFFS_USRH + 2 * i]) * 4.0 / (1 << gyro_fs);
+		put_be16(&b0[B0_GYRO_XOUT_H + 2 * i], m.gyro[i] * gyro_lsb + offset);
+	}
+
+	put_be16(&b0[B0_TEMP_OUT_H], (m.temperature - 21.0) * ICM20948_TEMP_LSB_PER_DEGC);
+}
+//One FIFO record, in register order: accelerometer, gyroscope x, y, z, temperature, I2C_SLV0 data
+static void fifo_push_sample(void)
+{
+	uint8_t en2 = regs[0][B0_FIFO_EN_2];
+
+	if(en2 & 0x10)
+		fifo_push(&regs[0][B0_ACCEL_XOUT_H], 6);
+	if(en2 & 0x02)
+		fifo_push(&regs[0][B0_GYRO_XOUT_H], 2);
+	if(en2 & 0x04)
+		fifo_push(&regs[0][B0_GYRO_YOUT_H], 2);
+	if(en2 & 0x08)
+		fifo_push(&regs[0][B0_GYRO_ZOUT_H], 2);
+	if(en2 & 0x01)
+		fifo_push(&regs[0][B0_TEMP_OUT_H], 2);
+	if(regs[0][B0_FIFO_EN_1] & 0x01)
+		fifo_push(&regs[0][B0_EXT_SLV_SENS_DATA_00], regs[3][B3_I2C_SLV0_CTRL] & 0x0F);
+}
+//FIFO_MODE 0: stream, the oldest bytes are overwritten; 1: snapshot, new bytes are dropped
+static void fifo_push(const uint8_t* data, uint16_t len)
+{
+	uint16_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		if(fifo_count == ICM_SIM_FIFO_SIZE)
+		{
+			if(!(regs[0][B0_INT_STATUS_2] & 0x1F))
+				stats.fifo_overflows++;
+			regs[0][B0_INT_STATUS_2] |= 0x1F;
+
+			if(regs[0][B0_FIFO_MODE] & 0x01)
+				return;
+			fifo_head = (fifo_head + 1) % ICM_SIM_FIFO_SIZE;
+			fifo_count--;
+		}
+		fifo[(fifo_head + fifo_count) % ICM_SIM_FIFO_SIZE] = data[i];
+		fifo_count++;
+		stats.fifo_bytes++;
+	}
+}
+
+//AK09916 power on
+static void ak_reset(void)
+{
+	memset(ak, 0, sizeof(ak));
+	ak[AK_WIA1] = 0x48;
+	ak[MAG_WIA2] = AK09916_ID;
+	sim_cancel(ak_tick, NULL);
+}
+static uint8_t ak_read(uint8_t reg)
+{
+	uint8_t val;
+
+	if(reg >= AK_REG_COUNT)
+		return 0;
+	val = ak[reg];
+
+	// reading ST2 ends the data read, DRDY and DOR are released
+	if(reg == MAG_ST2)
+		ak[MAG_ST1] &= ~0x03;
+
+	return val;
+}
+static void ak_write(uint8_t reg, uint8_t val)
+{
+	switch(reg)
+	{
+	case MAG_CNTL2:
+		ak[MAG_CNTL2] = val & 0x1F;
+		if(ak_period_ns())
+			sim_schedule(ak_period_ns(), ak_tick, NULL);
+		else
+			sim_cancel(ak_tick, NULL);
+		break;
+	case MAG_CNTL3:
+		// SRST
+		if(val & 0x01)
+			ak_reset();
+		break;
+	}
+}
+//One magnetometer measurement
+static void ak_tick(void* ctx)
+{
+	motion_state m;
+	double lsb;
+	bool overflow = false;
+	int i;
+
+	motion_sample(sim_now(), &m);
+	stats.mag_measurements++;
+
+	// a measurement that was never read: data overrun
+	if(ak[MAG_ST1] & 0x01)
+	{
+		ak[MAG_ST1] |= 0x02;
+		stats.mag_overruns++;
+	}
+
+	for(i = 0; i < 3; i++)
+	{
+		lsb = m.mag[i] / AK09916_UT_PER_LSB;
+		if(fabs(lsb) > AK_MAX_LSB)
+			overflow = true;
+		lsb = lsb > INT16_MAX ? INT16_MAX : lsb < INT16_MIN ? INT16_MIN : lsb;
+		ak[MAG_HXL + 2 * i] = (uint8_t)((int16_t)lsb);
+		ak[MAG_HXH + 2 * i] = (uint8_t)((uint16_t)(int16_t)lsb >> 8);
+	}
+	ak[MAG_ST2] = overflow ? 0x08 : 0x00;
+	ak[MAG_ST1] |= 0x01;
+
+	// single measurement mode goes back to power down
+	if(ak[MAG_CNTL2] == single_measurement_mode)
+		ak[MAG_CNTL2] = power_down_mode;
+	if(ak_period_ns())
+		sim_schedule(ak_period_ns(), ak_tick, NULL);
+}
+//CNTL2 MODE[4:0], continuous measurement mode 1 ~ 4 = 10, 20, 50, 100 Hz
+static uint64_t ak_period_ns(void)
+{
+	switch(ak[MAG_CNTL2])
+	{
+	case single_measurement_mode:		return 8 * SIM_NS_PER_MS;
+	case continuous_measurement_10hz:	return SIM_NS_PER_S / 10;
+	case continuous_measurement_20hz:	return SIM_NS_PER_S / 20;
+	case continuous_measurement_50hz:	return SIM_NS_PER_S / 50;
+	case continuous_measurement_100hz:	return SIM_NS_PER_S / 100;
+	default:							return 0;
+	}
+}
+
+static void put_be16(uint8_t* p, double val)
+{
+	int16_t v;
+
+	val = round(val);
+	v = val > INT16_MAX ? INT16_MAX : val < INT16_MIN ? INT16_MIN : (int16_t)val;
+	p[0] = (uint8_t)((uint16_t)v >> 8);
+	p[1] = (uint8_t)v;
+}
+static int16_t get_be16(const uint8_t* p)
+{
+	return (int16_t)(p[0] << 8 | p[1]);
+}
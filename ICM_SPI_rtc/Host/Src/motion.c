@@ -0,0 +1,191 @@
+/**
+ * @file motion.c
+ * @brief Motion source of the simulated ICM20948 and AK09916
+ *
+ * Synthetic: the board lies flat (1 g on z, 20 uT north, 40 uT down) and after motion_start()
+ * swings around z while wobbling around x and y.
+ * Recorded: the rows of a frame_decoder.py CSV are replayed at their timestamps, in a loop.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "motion.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOTION_PI						3.14159265358979323846
+
+
+typedef struct
+{
+	double t;						// s from the first row
+	motion_state m;
+} motion_row;
+
+static motion_row* rows;
+static size_t row_count;
+static uint64_t start_ns = UINT64_MAX;
+static uint32_t noise_seed = 1;
+
+
+static double noise(double amplitude);
+static void still(motion_state* m);
+
+
+/**
+ * @brief Load a recording, columns seq, timestamp_us, x_accel ~ z_accel, x_gyro ~ z_gyro, x_mag ~ z_mag, temperature
+ * Rows without magnetometer or temperature keep the previous value.
+ * @return false if the file cannot be read or holds no rows.
+ */
+bool motion_load_csv(const char* path)
+{
+	FILE* f = fopen(path, "r");
+	char line[512];
+	motion_state last;
+	double t0 = -1;
+
+	if(!f)
+		return false;
+
+	still(&last);
+	free(rows);
+	rows = NULL;
+	row_count = 0;
+
+	while(fgets(line, sizeof(line), f))
+	{
+		double v[12];
+		int n = 0;
+		char* p = line;
+		char* end;
+
+		// header, or an empty line
+		if(line[0] < '0' || line[0] > '9')
+			continue;
+
+		while(n < 12)
+		{
+			v[n] = strtod(p, &end);
+			if(end == p)
+				v[n] = NAN;
+			n++;
+			p = strchr(end, ',');
+			if(!p)
+				break;
+			p++;
+		}
+		if(n < 8)
+			continue;
+
+		for(int i = 0; i < 3; i++)
+		{
+			last.accel[i] = v[2 + i];
+			last.gyro[i] = v[5 + i];
+			if(n > 8 + i && !isnan(v[8 + i]))
+				last.mag[i] = v[8 + i];
+		}
+		if(n > 11 && !isnan(v[11]))
+			last.temperature = v[11];
+
+		if(t0 < 0)
+			t0 = v[1];
+
+		rows = realloc(rows, (row_count + 1) * sizeof(*rows));
+		rows[row_count].t = (v[1] - t0) / 1e6;
+		rows[row_count].m = last;
+		row_count++;
+	}
+
+	fclose(f);
+	return row_count > 0;
+}
+/**
+ * @brief Start the motion, before this the board lies still
+ * @return None.
+ */
+void motion_start(uint64_t t_ns)
+{
+	start_ns = t_ns;
+}
+/**
+ * @brief Sensor input at virtual time t_ns, with a little noise
+ * @return None.
+ */
+void motion_sample(uint64_t t_ns, motion_state* m)
+{
+	double t;
+	int i;
+
+	still(m);
+
+	if(t_ns >= start_ns)
+	{
+		t = (t_ns - start_ns) / 1e9;
+
+		if(row_count)
+		{
+			double period = rows[row_count - 1].t + 0.01;
+			double tr = fmod(t, period);
+			size_t lo = 0, hi = row_count - 1;
+
+			// last row at or before tr
+			while(lo < hi)
+			{
+				size_t mid = (lo + hi + 1) / 2;
+				if(rows[mid].t <= tr)
+					lo = mid;
+				else
+					hi = mid - 1;
+			}
+			*m = rows[lo].m;
+		}
+		else
+		{
+			// 0.5 Hz swing of +-90 dps around z, the heading follows the integrated rate
+			double heading = -90.0 / MOTION_PI * cos(MOTION_PI * t) * MOTION_PI / 180.0;
+			double tilt = 0.1 * sin(2 * MOTION_PI * 1.3 * t);
+
+			m->gyro[0] = 15.0 * cos(2 * MOTION_PI * 1.3 * t);
+			m->gyro[1] = 10.0 * sin(2 * MOTION_PI * 0.7 * t);
+			m->gyro[2] = 90.0 * sin(MOTION_PI * t);
+
+			m->accel[0] = sin(tilt);
+			m->accel[1] = 0.05 * sin(2 * MOTION_PI * 0.7 * t);
+			m->accel[2] = cos(tilt);
+
+			m->mag[0] = 20.0 * cos(heading);
+			m->mag[1] = -20.0 * sin(heading);
+			m->mag[2] = -40.0;
+
+			m->temperature = 25.0 + 0.5 * sin(2 * MOTION_PI * t / 60.0);
+		}
+	}
+
+	for(i = 0; i < 3; i++)
+	{
+		m->accel[i] += noise(0.002);
+		m->gyro[i] += noise(0.05);
+		m->mag[i] += noise(0.3);
+	}
+}
+
+
+/* Static Functions */
+//uniform noise, deterministic so that runs can be compared
+static double noise(double amplitude)
+{
+	noise_seed = noise_seed * 1103515245u + 12345u;
+	return amplitude * (((noise_seed >> 8) & 0xFFFF) / 32768.0 - 1.0);
+}
+static void still(motion_state* m)
+{
+	memset(m, 0, sizeof(*m));
+	m->accel[2] = 1.0;
+	m->mag[0] = 20.0;
+	m->mag[2] = -40.0;
+	m->temperature = 25.0;
+}
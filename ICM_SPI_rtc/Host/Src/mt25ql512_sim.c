@@ -0,0 +1,412 @@
+/**
+ * @file mt25ql512_sim.c
+ * @brief Simulated MT25QL512 serial NOR flash for the host build
+ *
+ * The model covers what Core/Src/mt25ql512.c relies on:
+ * 1. RESET ENABLE / RESET MEMORY, READ ID, READ STATUS, READ / CLEAR FLAG STATUS, WRITE ENABLE / DISABLE,
+ *    ENTER / EXIT 4-BYTE ADDRESS MODE.
+ * 2. Reads (0x03, 0x13) and the quad I/O fast read (0xEC, 10 dummy cycles) used by the memory-mapped mode.
+ * 3. Page programs (0x02, 0x12, 0x3E): bits only go from 1 to 0, the address wraps inside the page.
+ * 4. 4 KB subsector and 64 KB sector erases (0x20, 0x21, 0xD8, 0xDC), erase counts per subsector.
+ * 5. Write enable latch, busy time of a program or an erase (typical datasheet values), flag status ready bit.
+ *
+ * Every command is checked against the extended SPI protocol: the instruction on one line, the address length
+ * of the command or of the address mode, the line counts and the dummy cycles. A wrong one is counted and ignored.
+ * A program or an erase takes effect once its busy time is over, a reset before that tears it.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "mt25ql512_sim.h"
+#include "sim.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SECTOR_SIZE						65536
+#define PAGE_SIZE						256
+#define SUBSECTORS						(MT25QL512_SIM_SIZE / MT25QL512_SIM_SUBSECTOR_SIZE)
+
+// address length of a command
+#define ADDR_NONE						0
+#define ADDR_MODE						1		// 3 or 4 bytes, as the address mode
+#define ADDR_4B							4
+
+
+typedef enum
+{
+	op_none,
+	op_program,
+	op_erase
+} sim_op;
+
+static uint8_t* array;
+static int fd = -1;
+
+// volatile state
+static bool wel;
+static bool addr_4b;
+static bool reset_enabled;
+static uint8_t flag_errors;
+
+// running program or erase, applied once busy_until is reached
+static sim_op op;
+static uint64_t busy_until;
+static uint32_t op_addr;
+static uint32_t op_len;
+static uint8_t op_data[PAGE_SIZE];
+
+static uint32_t erase_count[SUBSECTORS];
+static mt25ql512_sim_stats stats;
+
+
+static uint32_t lines(uint32_t mode, uint32_t shift);
+static bool check(const QSPI_CommandTypeDef* cmd, int addr, uint32_t addr_lines, uint32_t data_lines, uint32_t dummy);
+static void settle(void);
+static void apply(uint32_t len);
+static void erase(uint32_t addr, uint32_t size);
+
+
+/**
+ * @brief Map the backing file, or an erased array in memory
+ * @return false if the file cannot be created or mapped.
+ */
+bool mt25ql512_sim_open(const char* path)
+{
+	struct stat st;
+	void* p;
+
+	mt25ql512_sim_close();
+
+	if(!path)
+	{
+		p = mmap(NULL, MT25QL512_SIM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(p == MAP_FAILED)
+			return false;
+		array = p;
+		memset(array, 0xFF, MT25QL512_SIM_SIZE);
+		return true;
+	}
+
+	if((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0)
+		return false;
+	if(fstat(fd, &st) < 0 || (st.st_size != MT25QL512_SIM_SIZE && ftruncate(fd, MT25QL512_SIM_SIZE) < 0))
+	{
+		mt25ql512_sim_close();
+		return false;
+	}
+	p = mmap(NULL, MT25QL512_SIM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if(p == MAP_FAILED)
+	{
+		mt25ql512_sim_close();
+		return false;
+	}
+	array = p;
+	// a new file reads as zeros, a new device as erased
+	if(st.st_size < MT25QL512_SIM_SIZE)
+		memset(array + st.st_size, 0xFF, MT25QL512_SIM_SIZE - st.st_size);
+	return true;
+}
+void mt25ql512_sim_close(void)
+{
+	if(array)
+		munmap(array, MT25QL512_SIM_SIZE);
+	if(fd >= 0)
+		close(fd);
+	array = NULL;
+	fd = -1;
+}
+void mt25ql512_sim_reset(void)
+{
+	if(!array)
+		mt25ql512_sim_open(NULL);
+
+	settle();
+	if(op != op_none)
+	{
+		// power lost half way
+		stats.torn++;
+		if(op == op_program)
+			apply(op_len / 2);
+		else
+			erase(op_addr, op_len / 2);
+		op = op_none;
+	}
+
+	wel = false;
+	addr_4b = false;
+	reset_enabled = false;
+	flag_errors = 0;
+}
+/**
+ * @brief One command on the bus: check it against the protocol, then run it
+ * @return false if the device ignored it.
+ */
+bool mt25ql512_sim_command(const QSPI_CommandTypeDef* cmd, uint8_t* data, uint32_t len)
+{
+	uint32_t addr = cmd->Address;
+	uint32_t i;
+	bool was_reset_enabled = reset_enabled;
+
+	settle();
+	stats.commands++;
+	reset_enabled = false;
+
+	if(lines(cmd->InstructionMode, 8) != 1)
+	{
+		stats.protocol_errors++;
+		return false;
+	}
+
+	// only the status registers answer while a program or an erase runs
+	if(op != op_none && cmd->Instruction != 0x05 && cmd->Instruction != 0x70)
+	{
+		stats.ignored++;
+		return false;
+	}
+
+	switch(cmd->Instruction)
+	{
+	case 0x66:
+		if(!check(cmd, ADDR_NONE, 0, 0, 0))
+			return false;
+		reset_enabled = true;
+		return true;
+
+	case 0x99:
+		if(!check(cmd, ADDR_NONE, 0, 0, 0))
+			return false;
+		if(!was_reset_enabled)
+		{
+			stats.ignored++;
+			return false;
+		}
+		mt25ql512_sim_reset();
+		return true;
+
+	case 0x9F:
+		if(!check(cmd, ADDR_NONE, 0, 1, 0))
+			return false;
+		for(i = 0; i < len; i++)
+			data[i] = i == 0 ? 0x20 : i == 1 ? 0xBA : i == 2 ? 0x20 : 0x00;
+		return true;
+
+	case 0x05:
+		if(!check(cmd, ADDR_NONE, 0, 1, 0))
+			return false;
+		for(i = 0; i < len; i++)
+			data[i] = (op != op_none ? 0x01 : 0) | (wel ? 0x02 : 0);
+		return true;
+
+	case 0x70:
+		if(!check(cmd, ADDR_NONE, 0, 1, 0))
+			return false;
+		for(i = 0; i < len; i++)
+			data[i] = (op == op_none ? 0x80 : 0) | flag_errors | (addr_4b ? 0x01 : 0);
+		return true;
+
+	case 0x50:
+		if(!check(cmd, ADDR_NONE, 0, 0, 0))
+			return false;
+		flag_errors = 0;
+		return true;
+
+	case 0x06:
+	case 0x04:
+		if(!check(cmd, ADDR_NONE, 0, 0, 0))
+			return false;
+		wel = cmd->Instruction == 0x06;
+		return true;
+
+	case 0xB7:
+	case 0xE9:
+		// needs WRITE ENABLE
+		if(!check(cmd, ADDR_NONE, 0, 0, 0))
+			return false;
+		if(!wel)
+		{
+			stats.ignored++;
+			return false;
+		}
+		addr_4b = cmd->Instruction == 0xB7;
+		wel = false;
+		return true;
+
+	case 0x03:
+	case 0x13:
+	case 0xEC:
+		if(cmd->Instruction == 0xEC ? !check(cmd, ADDR_4B, 4, 4, 10) :
+				!check(cmd, cmd->Instruction == 0x13 ? ADDR_4B : ADDR_MODE, 1, 1, 0))
+			return false;
+		// a read wraps around at the end of the device
+		for(i = 0; i < len; i++)
+			data[i] = array[(addr + i) % MT25QL512_SIM_SIZE];
+		return true;
+
+	case 0x02:
+	case 0x12:
+	case 0x3E:
+		if(cmd->Instruction == 0x3E ? !check(cmd, ADDR_4B, 4, 4, 0) :
+				!check(cmd, cmd->Instruction == 0x12 ? ADDR_4B : ADDR_MODE, 1, 1, 0))
+			return false;
+		if(!wel || len == 0)
+		{
+			stats.ignored++;
+			return false;
+		}
+		// past the end of the page, the data wraps to its start, only the last 256 bytes are kept
+		if(len > PAGE_SIZE)
+		{
+			data += len - PAGE_SIZE;
+			addr += len - PAGE_SIZE;
+			len = PAGE_SIZE;
+		}
+		op = op_program;
+		op_addr = addr % MT25QL512_SIM_SIZE;
+		op_len = len;
+		memcpy(op_data, data, len);
+		busy_until = sim_now() + MT25QL512_SIM_PAGE_NS;
+		wel = false;
+		stats.page_programs++;
+		stats.bytes_programmed += len;
+		return true;
+
+	case 0x20:
+	case 0x21:
+	case 0xD8:
+	case 0xDC:
+		if(!check(cmd, cmd->Instruction == 0x21 || cmd->Instruction == 0xDC ? ADDR_4B : ADDR_MODE, 1, 0, 0))
+			return false;
+		if(!wel)
+		{
+			stats.ignored++;
+			return false;
+		}
+		op = op_erase;
+		if(cmd->Instruction == 0x20 || cmd->Instruction == 0x21)
+		{
+			op_len = MT25QL512_SIM_SUBSECTOR_SIZE;
+			busy_until = sim_now() + MT25QL512_SIM_SUBSECTOR_NS;
+			stats.subsector_erases++;
+		}
+		else
+		{
+			op_len = SECTOR_SIZE;
+			busy_until = sim_now() + MT25QL512_SIM_SECTOR_NS;
+			stats.sector_erases++;
+		}
+		op_addr = addr % MT25QL512_SIM_SIZE & ~(op_len - 1);
+		wel = false;
+		return true;
+
+	default:
+		stats.protocol_errors++;
+		return false;
+	}
+}
+bool mt25ql512_sim_mapped_command(const QSPI_CommandTypeDef* cmd)
+{
+	settle();
+	if(op != op_none)
+	{
+		stats.ignored++;
+		return false;
+	}
+	if(lines(cmd->InstructionMode, 8) != 1)
+	{
+		stats.protocol_errors++;
+		return false;
+	}
+
+	switch(cmd->Instruction)
+	{
+	case 0x03:
+		return check(cmd, ADDR_MODE, 1, 1, 0);
+	case 0x13:
+		return check(cmd, ADDR_4B, 1, 1, 0);
+	case 0xEC:
+		return check(cmd, ADDR_4B, 4, 4, 10);
+	default:
+		stats.protocol_errors++;
+		return false;
+	}
+}
+uint64_t mt25ql512_sim_busy_ns(void)
+{
+	settle();
+	return op != op_none ? busy_until - sim_now() : 0;
+}
+uint8_t* mt25ql512_sim_array(void)
+{
+	if(!array)
+		mt25ql512_sim_open(NULL);
+	return array;
+}
+void mt25ql512_sim_get_stats(mt25ql512_sim_stats* stats_out)
+{
+	uint32_t i;
+
+	stats.max_erase_count = 0;
+	for(i = 0; i < SUBSECTORS; i++)
+		if(erase_count[i] > stats.max_erase_count)
+			stats.max_erase_count = erase_count[i];
+	*stats_out = stats;
+}
+
+
+/* Static Functions */
+//QSPI_CCR line count field: 0 none, 1, 2 or 4 lines
+static uint32_t lines(uint32_t mode, uint32_t shift)
+{
+	static const uint32_t count[4] = { 0, 1, 2, 4 };
+
+	return count[(mode >> shift) & 3];
+}
+//the command phases against what the instruction expects
+static bool check(const QSPI_CommandTypeDef* cmd, int addr, uint32_t addr_lines, uint32_t data_lines, uint32_t dummy)
+{
+	uint32_t addr_bytes = addr == ADDR_NONE ? 0 : addr == ADDR_4B || addr_4b ? 4 : 3;
+	bool ok = lines(cmd->AddressMode, 10) == addr_lines && lines(cmd->DataMode, 24) == data_lines &&
+			cmd->DummyCycles == dummy && cmd->AlternateByteMode == QSPI_ALTERNATE_BYTES_NONE &&
+			cmd->DdrMode == QSPI_DDR_MODE_DISABLE;
+
+	if(addr != ADDR_NONE)
+		ok = ok && (cmd->AddressSize >> 12) + 1 == addr_bytes;
+	if(!ok)
+		stats.protocol_errors++;
+	return ok;
+}
+//the running program or erase takes effect once its time is over
+static void settle(void)
+{
+	if(op == op_none || sim_now() < busy_until)
+		return;
+
+	if(op == op_program)
+		apply(op_len);
+	else
+		erase(op_addr, op_len);
+	op = op_none;
+}
+//program the first len bytes of op_data, NOR: 1 -> 0 only
+static void apply(uint32_t len)
+{
+	uint32_t page = op_addr & ~(PAGE_SIZE - 1);
+	uint32_t i;
+
+	for(i = 0; i < len; i++)
+		array[page + (op_addr + i) % PAGE_SIZE] &= op_data[i];
+}
+static void erase(uint32_t addr, uint32_t size)
+{
+	uint32_t i;
+
+	memset(array + addr, 0xFF, size);
+	for(i = addr / MT25QL512_SIM_SUBSECTOR_SIZE; i < (addr + size + MT25QL512_SIM_SUBSECTOR_SIZE - 1) /
+			MT25QL512_SIM_SUBSECTOR_SIZE; i++)
+		erase_count[i]++;
+}
@@ -0,0 +1,249 @@
+/**
+ * @file pc_dump.c
+ * @brief Simulated PC reading the flash back with COMMAND_DUMP
+ *
+ * Reads the IN transfers as they complete and collects the FRAME_TYPE_DUMP frames of the block being sent.
+ * At its FRAME_TYPE_DUMP_CRC frame the block is kept if it is whole and its CRC matches, and compared with
+ * the flash array; otherwise the dump is asked for again from the end of the last block kept.
+ * The cable is pulled the number of times asked for, spread over the dump: the block being received is lost,
+ * the cable is plugged in again after PC_DUMP_UNPLUGGED_NS and the PC application resumes the dump
+ * PC_DUMP_REOPEN_NS later, as python/frame_decoder.py does when it is started again.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "pc_dump.h"
+#include "hal_stub.h"
+#include "mt25ql512_sim.h"
+#include "frame.h"
+#include "command.h"
+#include "flash_dump.h"
+#include "sim.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+static uint32_t dump_length;
+static uint32_t dump_end;
+static uint32_t resume;					// end of the last block kept
+static uint32_t pulls_asked;
+static bool pull_due;
+// waiting for the first frame of the dump asked for last, the frames still in flight before it are dropped
+static bool waiting;
+static uint16_t command_seq;
+
+// frame being received, frame_len > sizeof(frame_buf): too long, dropped at the 0x00
+static uint8_t frame_buf[FRAME_DUMP_ENCODED_LEN(FLASH_DUMP_CHUNK)];
+static uint16_t frame_len;
+
+static uint8_t block[FLASH_DUMP_BLOCK_SIZE];
+static uint32_t block_address;
+static uint32_t block_fill;
+static bool block_bad;
+
+static pc_dump_stats stats;
+
+
+static void usb_host_read(const uint8_t* data, uint16_t len);
+static void handle_frame(const uint8_t* encoded, uint16_t len);
+static void handle_crc(const uint8_t* payload);
+static void send_dump(void* ctx);
+static void pull(void* ctx);
+static void plug(void* ctx);
+static uint16_t block_crc(void);
+static uint32_t get_u32(const uint8_t* p);
+
+
+void pc_dump_start(uint32_t address, uint32_t length, uint32_t pulls)
+{
+	memset(&stats, 0, sizeof(stats));
+	dump_length = length;
+	dump_end = address + length;
+	resume = address;
+	pulls_asked = pulls;
+	pull_due = false;
+	frame_len = 0;
+	stats.start_ns = sim_now();
+	hal_stub_usb_host(usb_host_read);
+	send_dump(NULL);
+}
+bool pc_dump_done(void)
+{
+	return stats.done;
+}
+void pc_dump_get_stats(pc_dump_stats* stats_out)
+{
+	*stats_out = stats;
+}
+
+
+/* Static Functions */
+//one IN transfer, split into frames
+static void usb_host_read(const uint8_t* data, uint16_t len)
+{
+	uint16_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		if(data[i] != 0x00)
+		{
+			if(frame_len < sizeof(frame_buf))
+				frame_buf[frame_len] = data[i];
+			if(frame_len <= sizeof(frame_buf))
+				frame_len++;
+			continue;
+		}
+		if(frame_len > sizeof(frame_buf))
+			stats.bad_frames++;
+		else if(frame_len)
+			handle_frame(frame_buf, frame_len);
+		frame_len = 0;
+	}
+}
+static void handle_frame(const uint8_t* encoded, uint16_t len)
+{
+	static uint8_t frame[sizeof(frame_buf)];
+	uint16_t n = frame_decode(encoded, len, frame);
+	uint32_t address, size;
+
+	if(n == 0)
+	{
+		stats.bad_frames++;
+		return;
+	}
+	if(stats.done || (frame[1] != FRAME_TYPE_DUMP && frame[1] != FRAME_TYPE_DUMP_CRC))
+		return;
+
+	if(frame[1] == FRAME_TYPE_DUMP_CRC)
+	{
+		if(!waiting && n >= FRAME_HEADER_LEN + FRAME_DUMP_CRC_PAYLOAD)
+			handle_crc(frame + FRAME_HEADER_LEN);
+		return;
+	}
+
+	if(n < FRAME_HEADER_LEN + FRAME_DUMP_HEADER_LEN)
+	{
+		stats.bad_frames++;
+		return;
+	}
+	address = get_u32(frame + FRAME_HEADER_LEN);
+	size = n - FRAME_HEADER_LEN - FRAME_DUMP_HEADER_LEN;
+
+	if(waiting && ((frame[2] | frame[3] << 8) != 0 || address != resume))
+	{
+		stats.discarded += size;
+		return;
+	}
+	waiting = false;
+	stats.frames++;
+
+	// a frame missing: the block is not kept
+	if(address != block_address + block_fill || block_fill + size > sizeof(block))
+	{
+		block_bad = true;
+		return;
+	}
+	memcpy(block + block_fill, frame + FRAME_HEADER_LEN + FRAME_DUMP_HEADER_LEN, size);
+	block_fill += size;
+}
+//end of a block: kept, or the dump is asked for again from its start
+static void handle_crc(const uint8_t* payload)
+{
+	uint32_t address = get_u32(payload), length = get_u32(payload + 4), left = get_u32(payload + 10);
+	uint16_t crc = payload[8] | payload[9] << 8;
+
+	if(block_bad || address != block_address || length != block_fill ||
+			block_crc() != crc)
+	{
+		stats.bad_blocks++;
+		stats.discarded += block_fill;
+		send_dump(NULL);
+		return;
+	}
+
+	stats.blocks++;
+	stats.bytes += length;
+	if(memcmp(block, mt25ql512_sim_array() + address, length))
+		stats.differ++;
+	resume = address + length;
+	block_address = resume;
+	block_fill = 0;
+	if(left == 0)
+	{
+		stats.done = true;
+		stats.done_ns = sim_now();
+		return;
+	}
+
+	// the next pull, a random time into the next block
+	if(!pull_due && stats.pulls < pulls_asked &&
+			stats.bytes >= (uint64_t)dump_length * (stats.pulls + 1) / (pulls_asked + 1))
+	{
+		pull_due = true;
+		sim_schedule(rand() % (20 * SIM_NS_PER_MS), pull, NULL);
+	}
+}
+//COMMAND_DUMP from the end of the last block kept to the end, as python/frame_decoder.py sends it
+static void send_dump(void* ctx)
+{
+	uint8_t frame[FRAME_HEADER_LEN + 1 + 8 + FRAME_CRC_LEN];
+	uint8_t encoded[sizeof(frame) + 2];
+	uint32_t args[2] = { resume, dump_end - resume };
+	uint16_t len, crc;
+	int i;
+
+	memset(frame, 0, FRAME_HEADER_LEN);
+	frame[0] = FRAME_VERSION;
+	frame[1] = FRAME_TYPE_COMMAND;
+	frame[2] = (uint8_t)++command_seq;
+	frame[3] = (uint8_t)(command_seq >> 8);
+	frame[FRAME_HEADER_LEN] = COMMAND_DUMP;
+	for(i = 0; i < 8; i++)
+		frame[FRAME_HEADER_LEN + 1 + i] = (uint8_t)(args[i / 4] >> (8 * (i % 4)));
+	crc = crc16_ccitt(frame, sizeof(frame) - FRAME_CRC_LEN, 0xFFFF);
+	frame[sizeof(frame) - 2] = (uint8_t)crc;
+	frame[sizeof(frame) - 1] = (uint8_t)(crc >> 8);
+
+	len = cobs_encode(frame, sizeof(frame), encoded);
+	encoded[len++] = 0x00;
+	hal_stub_usb_receive(encoded, len);
+
+	stats.commands++;
+	waiting = true;
+	block_address = resume;
+	block_fill = 0;
+	block_bad = false;
+}
+//the block being received is lost with the transfer in flight
+static void pull(void* ctx)
+{
+	hal_stub_usb_connect(false);
+	pull_due = false;
+	stats.pulls++;
+	stats.discarded += block_fill;
+	block_fill = 0;
+	frame_len = 0;
+	waiting = true;
+	sim_schedule(PC_DUMP_UNPLUGGED_NS, plug, NULL);
+}
+static void plug(void* ctx)
+{
+	hal_stub_usb_connect(true);
+	sim_schedule(PC_DUMP_REOPEN_NS, send_dump, NULL);
+}
+//crc16_ccitt() takes 64 KB - 1 at most
+static uint16_t block_crc(void)
+{
+	uint16_t crc = 0xFFFF;
+	uint32_t i;
+
+	for(i = 0; i < block_fill; i += FLASH_DUMP_CHUNK)
+		crc = crc16_ccitt(block + i, block_fill - i < FLASH_DUMP_CHUNK ? block_fill - i : FLASH_DUMP_CHUNK, crc);
+	return crc;
+}
+static uint32_t get_u32(const uint8_t* p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
@@ -0,0 +1,118 @@
+/**
+ * @file pc_sync.c
+ * @brief Simulated PC answering the time sync requests of timesync.c
+ *
+ * Reads the IN transfers as they complete, splits them into frames and answers every FRAME_TYPE_SYNC
+ * request with a COMMAND_SYNC_REPLY frame on the OUT endpoint. The PC application sees a transfer
+ * PC_SYNC_READ_MIN_NS to PC_SYNC_READ_MAX_NS after it completed, t2 is taken then, so the IN direction
+ * has the jitter and the OUT direction the 1 ms frame wait, as on a real USB host.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "pc_sync.h"
+#include "hal_stub.h"
+#include "frame.h"
+#include "command.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+static int64_t clock_offset_us;
+static uint8_t frame_buf[FRAME_MAX_TEXT_ENCODED_LEN];
+static uint16_t frame_len;
+static uint16_t reply_seq;
+static uint64_t reply_t2;
+static pc_sync_stats stats;
+
+
+static void usb_host_read(const uint8_t* data, uint16_t len);
+static void handle_frame(const uint8_t* encoded, uint16_t len, uint64_t t2);
+static void send_reply(void* ctx);
+
+
+void pc_sync_start(int64_t offset_us)
+{
+	clock_offset_us = offset_us;
+	frame_len = 0;
+	memset(&stats, 0, sizeof(stats));
+	srand(1);
+	hal_stub_usb_host(usb_host_read);
+}
+uint64_t pc_sync_now_us(void)
+{
+	return HAL_STUB_RTC_EPOCH * 1000000ull + sim_now() / 1000 + clock_offset_us;
+}
+void pc_sync_get_stats(pc_sync_stats* stats_out)
+{
+	*stats_out = stats;
+}
+
+
+/* Static Functions */
+//one IN transfer, the frames it completes are read after the PC latency
+static void usb_host_read(const uint8_t* data, uint16_t len)
+{
+	uint64_t latency = PC_SYNC_READ_MIN_NS + (uint64_t)rand() % (PC_SYNC_READ_MAX_NS - PC_SYNC_READ_MIN_NS);
+	uint64_t t2 = pc_sync_now_us() + latency / 1000;
+	uint16_t i;
+
+	for(i = 0; i < len; i++)
+	{
+		if(data[i] == 0x00)
+		{
+			handle_frame(frame_buf, frame_len, t2);
+			frame_len = 0;
+		}
+		else if(frame_len < sizeof(frame_buf))
+			frame_buf[frame_len++] = data[i];
+	}
+}
+static void handle_frame(const uint8_t* encoded, uint16_t len, uint64_t t2)
+{
+	uint8_t frame[FRAME_MAX_TEXT_ENCODED_LEN];
+	uint16_t n = cobs_decode(encoded, len, frame);
+
+	if(n < FRAME_HEADER_LEN + FRAME_CRC_LEN || frame[1] != FRAME_TYPE_SYNC)
+		return;
+	if(crc16_ccitt(frame, n - FRAME_CRC_LEN, 0xFFFF) != (frame[n - 2] | frame[n - 1] << 8))
+		return;
+
+	stats.requests++;
+	reply_seq = frame[2] | frame[3] << 8;
+	reply_t2 = t2;
+	sim_schedule((t2 - pc_sync_now_us()) * 1000 + PC_SYNC_TURNAROUND_NS, send_reply, NULL);
+}
+//FRAME_TYPE_COMMAND frame, as python/frame_decoder.py sends it
+static void send_reply(void* ctx)
+{
+	uint8_t frame[FRAME_HEADER_LEN + 1 + 18 + FRAME_CRC_LEN];
+	uint8_t encoded[sizeof(frame) + 2];
+	uint64_t t3 = pc_sync_now_us();
+	uint16_t len, crc;
+	int i;
+
+	memset(frame, 0, FRAME_HEADER_LEN);
+	frame[0] = FRAME_VERSION;
+	frame[1] = FRAME_TYPE_COMMAND;
+	frame[FRAME_HEADER_LEN] = COMMAND_SYNC_REPLY;
+	frame[FRAME_HEADER_LEN + 1] = (uint8_t)reply_seq;
+	frame[FRAME_HEADER_LEN + 2] = (uint8_t)(reply_seq >> 8);
+	for(i = 0; i < 8; i++)
+	{
+		frame[FRAME_HEADER_LEN + 3 + i] = (uint8_t)(reply_t2 >> (8 * i));
+		frame[FRAME_HEADER_LEN + 11 + i] = (uint8_t)(t3 >> (8 * i));
+	}
+	crc = crc16_ccitt(frame, sizeof(frame) - FRAME_CRC_LEN, 0xFFFF);
+	frame[sizeof(frame) - 2] = (uint8_t)crc;
+	frame[sizeof(frame) - 1] = (uint8_t)(crc >> 8);
+
+	len = cobs_encode(frame, sizeof(frame), encoded);
+	encoded[len++] = 0x00;
+	hal_stub_usb_receive(encoded, len);
+	stats.replies++;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file sim.c
+ * @brief Virtual time and interrupts for the host build
+ *
+ * Time only moves when the firmware waits: a HAL_GetTick() polling loop, HAL_Delay(), __WFI(),
+ * or, with a CPU scale set, by the host time the firmware code took between two HAL calls.
+ * Pending events run in time order whenever interrupts are enabled, one at a time,
+ * like interrupts of equal priority.
+ *
+ * @author Xu Mujie
+ * @date 2026.10.16
+ * @version 1.0
+ */
+
+#include "sim.h"
+#include <string.h>
+#include <time.h>
+
+
+typedef struct
+{
+	uint64_t at;
+	sim_event_fn fn;
+	void* ctx;
+	bool used;
+} sim_event;
+
+static sim_event events[SIM_MAX_EVENTS];
+static uint64_t now;
+static bool masked;
+static bool in_isr;
+
+static double cpu_scale;
+static uint64_t host_mark;
+
+static sim_stats stats;
+
+
+static uint64_t host_ns(void);
+static sim_event* next_event(void);
+static void dispatch(void);
+
+
+/**
+ * @brief Back to time 0, no events, interrupts enabled
+ * @return None.
+ */
+void sim_reset(void)
+{
+	memset(events, 0, sizeof(events));
+	memset(&stats, 0, sizeof(stats));
+	now = 0;
+	masked = false;
+	in_isr = false;
+	host_mark = host_ns();
+}
+/**
+ * @brief Virtual time
+ * @return ns since sim_reset().
+ */
+uint64_t sim_now(void)
+{
+	return now;
+}
+/**
+ * @brief Raise an interrupt in delay_ns, replaces the pending one of the same fn / ctx
+ * @return None.
+ */
+void sim_schedule(uint64_t delay_ns, sim_event_fn fn, void* ctx)
+{
+	sim_event* free_slot = NULL;
+	int i;
+
+	for(i = 0; i < SIM_MAX_EVENTS; i++)
+	{
+		if(events[i].used && events[i].fn == fn && events[i].ctx == ctx)
+		{
+			free_slot = &events[i];
+			break;
+		}
+		if(!events[i].used && !free_slot)
+			free_slot = &events[i];
+	}
+	if(!free_slot)
+		return;
+
+	*free_slot = (sim_event){ now + delay_ns, fn, ctx, true };
+}
+/**
+ * @brief Drop a pending interrupt
+ * @return None.
+ */
+void sim_cancel(sim_event_fn fn, void* ctx)
+{
+	int i;
+
+	for(i = 0; i < SIM_MAX_EVENTS; i++)
+		if(events[i].used && events[i].fn == fn && events[i].ctx == ctx)
+			events[i].used = false;
+}
+/**
+ * @brief Let ns pass, the interrupts due meanwhile run at their own time unless masked
+ * @return None.
+ */
+void sim_advance(uint64_t ns)
+{
+	uint64_t target = now + ns;
+	sim_event* e;
+
+	while(!masked && !in_isr && (e = next_event()) != NULL && e->at <= target)
+	{
+		if(e->at > now)
+			now = e->at;
+		dispatch();
+	}
+
+	if(target > now)
+		now = target;
+}
+/**
+ * @brief __WFI(): sleep until the next event or the next 1 ms SysTick, whichever comes first
+ * A pending interrupt wakes the core up even when masked, it runs once interrupts are enabled.
+ * @return None.
+ */
+void sim_wait_for_interrupt(void)
+{
+	sim_event* e = next_event();
+	uint64_t wake = (now / SIM_NS_PER_MS + 1) * SIM_NS_PER_MS;
+
+	stats.wfi++;
+
+	if(e && e->at <= now)
+	{
+		dispatch();
+		return;
+	}
+	if(e && e->at < wake)
+		wake = e->at;
+
+	stats.sleep_ns += wake - now;
+	now = wake;
+	dispatch();
+}
+/**
+ * @brief Set or clear PRIMASK, clearing it runs the pending interrupts
+ * @return None.
+ */
+void sim_irq_mask(bool mask)
+{
+	masked = mask;
+	dispatch();
+}
+bool sim_irq_masked(void)
+{
+	return masked;
+}
+/**
+ * @brief Charge scale virtual ns for every host ns spent in firmware code
+ * @return None.
+ */
+void sim_set_cpu_scale(double scale)
+{
+	cpu_scale = scale;
+	host_mark = host_ns();
+}
+/**
+ * @brief Entry of a HAL stub, the firmware code since the last sim_leave() used the CPU
+ * @return None.
+ */
+void sim_enter(void)
+{
+	uint64_t spent;
+
+	if(cpu_scale <= 0)
+		return;
+
+	spent = (uint64_t)((host_ns() - host_mark) * cpu_scale);
+	now += spent;
+	stats.cpu_ns += spent;
+}
+/**
+ * @brief Exit of a HAL stub, firmware code runs from here
+ * @return None.
+ */
+void sim_leave(void)
+{
+	if(cpu_scale > 0)
+		host_mark = host_ns();
+}
+/**
+ * @brief Copy of the simulator counters
+ * @return None.
+ */
+void sim_get_stats(sim_stats* out)
+{
+	*out = stats;
+}
+
+
+/* Static Functions */
+static uint64_t host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * SIM_NS_PER_S + ts.tv_nsec;
+}
+//earliest pending event
+static sim_event* next_event(void)
+{
+	sim_event* e = NULL;
+	int i;
+
+	for(i = 0; i < SIM_MAX_EVENTS; i++)
+		if(events[i].used && (!e || events[i].at < e->at))
+			e = &events[i];
+
+	return e;
+}
+//run every due event, the handler is the firmware interrupt and may schedule new events
+static void dispatch(void)
+{
+	sim_event* e;
+	sim_event run;
+
+	while(!masked && !in_isr && (e = next_event()) != NULL && e->at <= now)
+	{
+		run = *e;
+		e->used = false;
+
+		in_isr = true;
+		stats.events++;
+		sim_leave();
+		run.fn(run.ctx);
+		sim_enter();
+		in_isr = false;
+	}
+}
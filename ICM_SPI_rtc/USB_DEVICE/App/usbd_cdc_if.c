@@ -22,6 +22,8 @@
 #include "usbd_cdc_if.h"
 
 /* USER CODE BEGIN INCLUDE */
+#include "usb_stream.h"
+#include "app.h"
 
 /* USER CODE END INCLUDE */
 
@@ -32,7 +34,6 @@
 /* USER CODE BEGIN PV */
 /* Private variables ---------------------------------------------------------*/
 //uint8_t Buffer[7];
-extern char received_data[1000];
 extern icm_20948_data imu_data;
 //extern char usbd_ch;
 //extern int Flag;
@@ -265,6 +266,8 @@ static int8_t CDC_Control_FS(uint8_t cmd, uint8_t* pbuf, uint16_t length)
 static int8_t CDC_Receive_FS(uint8_t* Buf, uint32_t *Len)
 {
   /* USER CODE BEGIN 6 */
+  //handled before the endpoint is armed again, the next packet lands in the same buffer
+  app_usb_receive(Buf, *Len);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, &Buf[0]);
   USBD_CDC_ReceivePacket(&hUsbDeviceFS);
 //  usbd_ch = Buf[0];
@@ -318,6 +321,8 @@ static int8_t CDC_TransmitCplt_FS(uint8_t *Buf, uint32_t *Len, uint8_t epnum)
   UNUSED(Buf);
   UNUSED(Len);
   UNUSED(epnum);
+  //send the frames queued while this transfer was in flight
+  usb_stream_tx_complete();
   /* USER CODE END 13 */
   return result;
 }
@@ -0,0 +1,533 @@
+"""Reference decoder for the binary sample frames sent over the USB VCP.
+
+The frame layout is documented in ICM_SPI_rtc/Core/Inc/frame.h.
+Frames are COBS encoded and separated by 0x00 bytes.
+Text and log frames are printed to stderr, the log messages are formatted
+with the LOG_MESSAGES list of ICM_SPI_rtc/Core/Inc/log.h.
+On a serial port the time sync requests (ICM_SPI_rtc/Core/Inc/timesync.h) are
+answered with this PC's clock, so the device RTC follows it, and the commands
+given after the file names (ICM_SPI_rtc/Core/Inc/command.h) are sent first,
+their responses are printed to stderr.
+A flash dump (ICM_SPI_rtc/Core/Inc/flash_dump.h) is written to <samples>.flash at the
+flash addresses, a block only once its CRC matched: a cut dump is resumed into the same
+file with the dump= command printed on exit.
+
+Usage:
+    python frame_decoder.py COM5 samples.csv        # read from the serial port
+    python frame_decoder.py capture.bin samples.csv # decode a raw capture file
+    python frame_decoder.py COM5 samples.csv sync odr=100 scale=1,3 stats
+    python frame_decoder.py COM5 samples.csv stop dump=0x10000,0x3FF0000
+
+Commands:
+    start, stop                 start or stop the samples
+    odr=<Hz>                    sample rate, the nearest one the sensor has is set
+    scale=<accel>,<gyro>        full scale indexes 0 ~ 3, - keeps one unchanged
+    bw=<gyro>,<accel>           low pass filter bandwidth in Hz, - keeps one unchanged
+    config                      sample rate, full scale and bandwidth in use
+    format=text|binary          output format
+    stats                       device counters
+    log=on|off                  start or stop the flash log
+    log_stats                   flash log counters
+    find=<from>,<to>            flash log blocks with samples in the range, unix seconds or
+                                UTC times such as 2026-10-16T12:00:00, both included
+    dump=<address>,<length>     read the flash back raw, 0x10000 is the first log block,
+                                a length of 0 stops the dump running
+    sync                        set the RTC to this PC's clock now
+    tz=<rule or preset name>    time zone, e.g. tz=Europe/Berlin
+    profile, profile_reset      Debug builds only
+"""
+
+import binascii
+import calendar
+import csv
+import os
+import re
+import struct
+import sys
+import time
+
+FRAME_VERSION = 1
+FRAME_TYPE_SAMPLE = 0x01
+FRAME_TYPE_TEXT = 0x02
+FRAME_TYPE_LOG = 0x03
+FRAME_TYPE_SYNC = 0x04
+FRAME_TYPE_COMMAND = 0x05
+FRAME_TYPE_RESPONSE = 0x06
+FRAME_TYPE_DUMP = 0x07
+FRAME_TYPE_DUMP_CRC = 0x08
+
+SYNC_PAYLOAD = struct.Struct("<iIi")
+
+# command ids, statuses and the COMMAND_GET_STATS result of command.h
+COMMAND_START = 0x01
+COMMAND_STOP = 0x02
+COMMAND_SET_ODR = 0x03
+COMMAND_SET_SCALE = 0x04
+COMMAND_SET_FORMAT = 0x05
+COMMAND_GET_STATS = 0x06
+COMMAND_SYNC_TIME = 0x07
+COMMAND_SYNC_REPLY = 0x08
+COMMAND_SET_TIME_ZONE = 0x09
+COMMAND_PROFILE = 0x0A
+COMMAND_PROFILE_RESET = 0x0B
+COMMAND_SET_BANDWIDTH = 0x0C
+COMMAND_GET_CONFIG = 0x0D
+COMMAND_SET_LOGGING = 0x0E
+COMMAND_GET_LOG_STATS = 0x0F
+COMMAND_FIND_LOG = 0x10
+COMMAND_DUMP = 0x11
+COMMAND_STATUS = {0: "ok", 1: "unknown command", 2: "bad arguments", 3: "failed"}
+OUTPUT_FORMATS = {"text": 0, "binary": 1}
+
+SYNC_REPLY_ARGS = struct.Struct("<HQQ")
+CONFIG = struct.Struct("<IBI")
+STATS = struct.Struct("<BB8IiIiIII")
+STATS_FIELDS = ("streaming", "format", "samples", "samples_dropped", "usb_frames", "usb_dropped",
+                "spi_errors", "rtc_seconds", "rtc_rejected", "sync_rounds", "offset_us", "delay_us",
+                "calib_ppb", "last_sync", "commands", "commands_rejected")
+LOG_STATS = struct.Struct("<B8IH2I2H")
+LOG_RANGE = struct.Struct("<5I")
+DUMP_RESULT = struct.Struct("<II")
+DUMP_CRC = struct.Struct("<IIHI")
+DUMP_BLOCK_SIZE = 0x10000
+LOG_STATS_FIELDS = ("running", "records", "records_dropped", "pages", "blocks", "erases", "errors",
+                    "used_blocks", "head_block", "staging_high_water", "committed", "checkpoints",
+                    "torn_pages", "mount_reads")
+
+LOG_HEADER = struct.Struct("<HBBI")
+LOG_LEVELS = {1: "ERROR", 2: "WARN", 3: "INFO", 4: "DEBUG"}
+LOG_H = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                     "..", "ICM_SPI_rtc", "Core", "Inc", "log.h")
+
+FIELD_ACCEL = 0x0001
+FIELD_GYRO = 0x0002
+FIELD_MAG = 0x0004
+FIELD_TEMP = 0x0008
+FIELD_SCALE = 0x0010
+
+HEADER = struct.Struct("<BBHHQ")
+
+# full scale index -> LSB per unit, same tables as icm20948.c
+GYRO_LSB_PER_DPS = (131.0, 65.5, 32.8, 16.4)
+ACCEL_LSB_PER_G = (16384.0, 8192.0, 4096.0, 2048.0)
+MAG_UT_PER_LSB = 0.15
+TEMP_LSB_PER_DEGC = 333.87
+TEMP_OFFSET_DEGC = 21.0
+
+CSV_COLUMNS = ["seq", "timestamp_us",
+               "x_accel", "y_accel", "z_accel",
+               "x_gyro", "y_gyro", "z_gyro",
+               "x_mag", "y_mag", "z_mag", "temperature"]
+
+
+class FrameError(Exception):
+    pass
+
+
+def crc16_ccitt(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, polynomial 0x1021."""
+    return binascii.crc_hqx(data, crc)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise FrameError("malformed COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            out += bytes([len(block) + 1]) + block
+            block = bytearray()
+            continue
+        block.append(byte)
+        if len(block) == 0xFE:
+            out += b"\xff" + block
+            block = bytearray()
+    out += bytes([len(block) + 1]) + block
+    return bytes(out)
+
+
+def encode_command(seq, command, args=b""):
+    """One FRAME_TYPE_COMMAND frame, COBS encoded with its 0x00 delimiter."""
+    body = HEADER.pack(FRAME_VERSION, FRAME_TYPE_COMMAND, seq & 0xFFFF, 0, 0) + bytes([command]) + args
+    return cobs_encode(body + struct.pack("<H", crc16_ccitt(body))) + b"\x00"
+
+
+def parse_command(text):
+    """Command line argument -> (command id, arguments)."""
+    name, _, value = text.partition("=")
+    if name in ("start", "stop", "stats", "config", "profile", "profile_reset", "log_stats") and not value:
+        return {"start": COMMAND_START, "stop": COMMAND_STOP, "stats": COMMAND_GET_STATS,
+                "config": COMMAND_GET_CONFIG, "profile": COMMAND_PROFILE,
+                "profile_reset": COMMAND_PROFILE_RESET, "log_stats": COMMAND_GET_LOG_STATS}[name], b""
+    if name == "sync" and not value:
+        # the time is taken again when it is sent
+        return COMMAND_SYNC_TIME, None
+    if name == "odr":
+        return COMMAND_SET_ODR, struct.pack("<I", round(float(value) * 1000))
+    if name == "scale":
+        accel, gyro = (0xFF if v in ("", "-") else int(v) for v in value.split(","))
+        return COMMAND_SET_SCALE, bytes([accel, gyro])
+    if name == "bw":
+        gyro, accel = (0xFFFFFFFF if v in ("", "-") else round(float(v) * 1000) for v in value.split(","))
+        return COMMAND_SET_BANDWIDTH, struct.pack("<II", gyro, accel)
+    if name == "format" and value in OUTPUT_FORMATS:
+        return COMMAND_SET_FORMAT, bytes([OUTPUT_FORMATS[value]])
+    if name == "log" and value in ("on", "off"):
+        return COMMAND_SET_LOGGING, bytes([value == "on"])
+    if name == "find" and value.count(",") == 1:
+        return COMMAND_FIND_LOG, struct.pack("<II", *(parse_seconds(v) for v in value.split(",")))
+    if name == "dump" and value.count(",") == 1:
+        return COMMAND_DUMP, struct.pack("<II", *(int(v, 0) for v in value.split(",")))
+    if name == "tz" and value:
+        return COMMAND_SET_TIME_ZONE, value.encode("ascii")
+    raise ValueError("unknown command %r" % text)
+
+
+def parse_seconds(text):
+    """Unix seconds, or a UTC time as YYYY-MM-DDTHH:MM:SS."""
+    if text.isdigit():
+        return int(text)
+    return calendar.timegm(time.strptime(text, "%Y-%m-%dT%H:%M:%S"))
+
+
+def format_response(command, status, result):
+    text = "response to command 0x%02x: %s" % (command, COMMAND_STATUS.get(status, status))
+    if status != 0:
+        return text
+    if command == COMMAND_SET_ODR and len(result) == 4:
+        text += ", %.3f Hz" % (struct.unpack("<I", result)[0] / 1000.0)
+    elif command == COMMAND_SET_BANDWIDTH and len(result) == 8:
+        text += ", gyro %.1f Hz, accel %.1f Hz" % tuple(v / 1000.0 for v in struct.unpack("<II", result))
+    elif command == COMMAND_GET_CONFIG and len(result) >= 2 * CONFIG.size:
+        for i, sensor in enumerate(("gyro", "accel")):
+            odr, scale, bandwidth = CONFIG.unpack_from(result, i * CONFIG.size)
+            text += "\n  %-5s %.3f Hz, full scale %d, bandwidth %.1f Hz" % (sensor, odr / 1000.0, scale,
+                                                                         bandwidth / 1000.0)
+    elif command == COMMAND_GET_STATS and len(result) >= STATS.size:
+        text += "".join("\n  %-18s %d" % item
+                        for item in zip(STATS_FIELDS, STATS.unpack_from(result)))
+    elif command == COMMAND_GET_LOG_STATS and len(result) >= LOG_STATS.size:
+        text += "".join("\n  %-18s %d" % item
+                        for item in zip(LOG_STATS_FIELDS, LOG_STATS.unpack_from(result)))
+    elif command == COMMAND_FIND_LOG and len(result) >= LOG_RANGE.size:
+        block, seq, blocks, first_s, last_s = LOG_RANGE.unpack_from(result)
+        if blocks:
+            text += ", %d blocks from block %d (sequence %d), %s to %s UTC" % (
+                blocks, block, seq, time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(first_s)),
+                time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(last_s)))
+        else:
+            text += ", no block"
+    elif command == COMMAND_DUMP and len(result) >= DUMP_RESULT.size:
+        address, length = DUMP_RESULT.unpack_from(result)
+        text += ", %d bytes from 0x%08x" % (length, address) if length else ", stopped"
+    return text
+
+
+def decode_frame(encoded):
+    """Decode one frame without its 0x00 delimiter, returns a dict of physical values.
+
+    A text frame (diagnostics, e.g. the profiling results) returns {"text": ...} instead,
+    a log frame {"log": <records>}, a time sync request
+    {"sync": (seq, t1_us, offset_us, delay_us, calib_ppb)},
+    a command response {"response": (seq, command, status, result)},
+    flash dump data {"dump": (seq, address, data)} and the end of a dump block
+    {"dump_crc": (address, length, crc, bytes left)}.
+    """
+    frame = cobs_decode(encoded)
+    if len(frame) < HEADER.size + 2:
+        raise FrameError("frame too short")
+    body, (crc,) = frame[:-2], struct.unpack("<H", frame[-2:])
+    if crc16_ccitt(body) != crc:
+        raise FrameError("CRC mismatch")
+
+    version, ftype, seq, mask, timestamp_us = HEADER.unpack_from(body)
+    if version != FRAME_VERSION:
+        raise FrameError("unsupported frame version %d" % version)
+    if ftype == FRAME_TYPE_TEXT:
+        return {"text": body[HEADER.size:].decode("ascii", "replace")}
+    if ftype == FRAME_TYPE_LOG:
+        return {"log": body[HEADER.size:]}
+    if ftype == FRAME_TYPE_SYNC:
+        if len(body) < HEADER.size + SYNC_PAYLOAD.size:
+            raise FrameError("sync frame too short")
+        return {"sync": (seq, timestamp_us) + SYNC_PAYLOAD.unpack_from(body, HEADER.size)}
+    if ftype == FRAME_TYPE_RESPONSE:
+        if len(body) < HEADER.size + 2:
+            raise FrameError("response frame too short")
+        return {"response": (seq, body[HEADER.size], body[HEADER.size + 1], body[HEADER.size + 2:])}
+    if ftype == FRAME_TYPE_DUMP:
+        if len(body) < HEADER.size + 4:
+            raise FrameError("dump frame too short")
+        return {"dump": (seq, struct.unpack_from("<I", body, HEADER.size)[0], body[HEADER.size + 4:])}
+    if ftype == FRAME_TYPE_DUMP_CRC:
+        if len(body) < HEADER.size + DUMP_CRC.size:
+            raise FrameError("dump CRC frame too short")
+        return {"dump_crc": DUMP_CRC.unpack_from(body, HEADER.size)}
+    if ftype != FRAME_TYPE_SAMPLE:
+        raise FrameError("unknown frame type 0x%02x" % ftype)
+
+    pos = HEADER.size
+    fields = {}
+    for bit, name, fmt in ((FIELD_ACCEL, "accel", "<3h"), (FIELD_GYRO, "gyro", "<3h"),
+                           (FIELD_MAG, "mag", "<3h"), (FIELD_TEMP, "temp", "<h"),
+                           (FIELD_SCALE, "scale", "<B")):
+        if mask & bit:
+            size = struct.calcsize(fmt)
+            if pos + size > len(body):
+                raise FrameError("payload shorter than field mask")
+            fields[name] = struct.unpack_from(fmt, body, pos)
+            pos += size
+
+    scale = fields.get("scale", (0,))[0]
+    accel_lsb = ACCEL_LSB_PER_G[scale >> 4 & 0x03]
+    gyro_lsb = GYRO_LSB_PER_DPS[scale & 0x03]
+
+    sample = {"seq": seq, "timestamp_us": timestamp_us}
+    for axis, value in zip("xyz", fields.get("accel", ())):
+        sample[axis + "_accel"] = value / accel_lsb
+    for axis, value in zip("xyz", fields.get("gyro", ())):
+        sample[axis + "_gyro"] = value / gyro_lsb
+    for axis, value in zip("xyz", fields.get("mag", ())):
+        sample[axis + "_mag"] = value * MAG_UT_PER_LSB
+    if "temp" in fields:
+        sample["temperature"] = fields["temp"][0] / TEMP_LSB_PER_DEGC + TEMP_OFFSET_DEGC
+    return sample
+
+
+def load_log_messages(path=LOG_H):
+    """Message formats in id order, from the X(id, "format") entries of LOG_MESSAGES."""
+    try:
+        with open(path) as f:
+            return re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', f.read())
+    except OSError:
+        return []
+
+
+def format_log(payload, messages):
+    """Format the log.c records of one log frame, returns a list of lines."""
+    lines = []
+    pos = 0
+    while pos + LOG_HEADER.size <= len(payload):
+        msg_id, level, nargs, tick = LOG_HEADER.unpack_from(payload, pos)
+        pos += LOG_HEADER.size
+        args = list(struct.unpack_from("<%dI" % nargs, payload, pos))
+        pos += 4 * nargs
+        if msg_id < len(messages):
+            fmt = messages[msg_id][1]
+            # %d/%i arguments are signed
+            for i, conv in enumerate(re.findall(r"%[-+ #0-9.]*l*([diuxXc])", fmt)[:nargs]):
+                if conv in "di" and args[i] & 0x80000000:
+                    args[i] -= 1 << 32
+            try:
+                text = fmt.replace("%l", "%") % tuple(args)
+            except (TypeError, ValueError):
+                text = "%s %s" % (fmt, args)
+        else:
+            text = "message %d %s" % (msg_id, args)
+        lines.append("[%10.3f] %-5s %s" % (tick / 1000.0, LOG_LEVELS.get(level, level), text))
+    return lines
+
+
+class FlashDump:
+    """The flash dump being received, a block is written to the image file once its CRC matched."""
+
+    def __init__(self, path):
+        self.path = path
+        self.file = None
+        self.block = bytearray()
+        self.address = None     # of the block being received
+        self.broken = False     # a frame is missing
+        self.waiting = False    # the rest was asked for again, the frames before its first one are dropped
+        self.resume = None      # end of the last block kept
+        self.left = 0
+        self.good = self.bad = 0
+
+    def data(self, seq, address, data):
+        # a dump starts, resumed or asked for again: the block being received is not finished
+        if seq == 0:
+            self.block = bytearray()
+            self.address = None
+            self.broken = False
+            self.waiting = False
+        if self.waiting:
+            return
+        if self.address is None:
+            self.address = address
+        if address != self.address + len(self.block):
+            self.broken = True
+        self.block += data
+
+    def end_block(self, address, length, crc, left):
+        """Returns the dump= arguments to ask for the rest again if the block is bad, None if it was kept."""
+        if self.waiting:
+            return None
+        block, self.block = bytes(self.block), bytearray()
+        ok = (not self.broken and address == self.address and length == len(block)
+              and crc16_ccitt(block) == crc)
+        self.address = None
+        self.broken = False
+        if not ok:
+            self.bad += 1
+            self.waiting = True
+            return address, length + left
+        if self.file is None:
+            self.file = open(self.path, "r+b" if os.path.exists(self.path) else "w+b")
+        self.file.seek(address)
+        self.file.write(block)
+        self.good += 1
+        self.resume, self.left = address + length, left
+        return None
+
+    def close(self):
+        if self.file is not None:
+            self.file.close()
+
+    def summary(self):
+        text = "dump: %d blocks kept, %d bad, written to %s" % (self.good, self.bad, self.path)
+        if self.left:
+            text += ", resume with dump=0x%x,0x%x" % (self.resume, self.left)
+        return text
+
+
+def now_us():
+    return time.time_ns() // 1000
+
+
+def iter_frames(chunks):
+    """Split a byte stream of (bytes, read time) chunks on 0x00, yields the encoded frames and their read time."""
+    pending = bytearray()
+    for chunk, read_us in chunks:
+        pending += chunk
+        while True:
+            end = pending.find(b"\x00")
+            if end < 0:
+                break
+            if end:
+                yield bytes(pending[:end]), read_us
+            del pending[:end + 1]
+
+
+def until_closed(chunks):
+    """The chunks until the port goes away, e.g. the cable is pulled, or Ctrl-C."""
+    try:
+        yield from chunks
+    except (KeyboardInterrupt, OSError) as e:
+        print("stopped: %s" % (e or "interrupted"), file=sys.stderr)
+
+
+def open_source(name):
+    """Returns the chunks of the stream and the serial port, None for a capture file."""
+    try:
+        with open(name, "rb") as f:
+            data = f.read()
+        return iter([(data, None)]), None
+    except OSError:
+        import serial  # pyserial, only needed for a live port
+        port = serial.Serial(name, timeout=1)
+
+        def read():
+            data = port.read(port.in_waiting or 1)
+            # t2 of the time sync requests in this chunk, before any decoding
+            return data, now_us()
+        return iter(read, None), port
+
+
+def answer_sync(port, seq, t2):
+    """Time sync reply: the request was read at t2, the reply leaves at t3."""
+    port.write(encode_command(seq, COMMAND_SYNC_REPLY, SYNC_REPLY_ARGS.pack(seq, t2, now_us())))
+
+
+def send_commands(port, commands):
+    for seq, (command, args) in enumerate(commands, 1):
+        if command == COMMAND_SYNC_TIME:
+            args = struct.pack("<Q", now_us())
+        port.write(encode_command(seq, command, args))
+
+
+def main(argv):
+    if len(argv) < 3:
+        print(__doc__)
+        return 1
+    try:
+        commands = [parse_command(arg) for arg in argv[3:]]
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        return 1
+
+    errors = lost = 0
+    messages = load_log_messages()
+    last_seq = None
+    last_sync = None
+    dump = FlashDump(os.path.splitext(argv[2])[0] + ".flash")
+    chunks, port = open_source(argv[1])
+    if port is not None:
+        send_commands(port, commands)
+    with open(argv[2], "w", newline="") as out:
+        writer = csv.DictWriter(out, fieldnames=CSV_COLUMNS)
+        writer.writeheader()
+        for encoded, read_us in iter_frames(until_closed(chunks)):
+            try:
+                sample = decode_frame(encoded)
+            except FrameError as e:
+                errors += 1
+                print("dropped frame: %s" % e, file=sys.stderr)
+                continue
+            if "dump" in sample:
+                dump.data(*sample["dump"])
+                continue
+            if "dump_crc" in sample:
+                again = dump.end_block(*sample["dump_crc"])
+                if again is not None:
+                    print("dump: bad block at 0x%08x, sent again" % again[0], file=sys.stderr)
+                    if port is not None:
+                        port.write(encode_command(0, COMMAND_DUMP, DUMP_RESULT.pack(*again)))
+                elif dump.good % 16 == 0 or not dump.left:
+                    print("dump: 0x%08x, %d bytes left" % (dump.resume, dump.left), file=sys.stderr)
+                continue
+            if "text" in sample:
+                print(sample["text"].rstrip(), file=sys.stderr)
+                continue
+            if "log" in sample:
+                for line in format_log(sample["log"], messages):
+                    print(line, file=sys.stderr)
+                continue
+            if "response" in sample:
+                print(format_response(*sample["response"][1:]), file=sys.stderr)
+                continue
+            if "sync" in sample:
+                seq, _, offset_us, delay_us, calib_ppb = sample["sync"]
+                if port is not None:
+                    answer_sync(port, seq, read_us)
+                # the result of the last round, printed once per round
+                if (offset_us, delay_us, calib_ppb) != last_sync:
+                    last_sync = (offset_us, delay_us, calib_ppb)
+                    print("time sync: offset %d us, round trip %d us, RTC calibration %d ppb" % last_sync,
+                          file=sys.stderr)
+                continue
+            if last_seq is not None:
+                lost += (sample["seq"] - last_seq - 1) & 0xFFFF
+            last_seq = sample["seq"]
+            writer.writerow(sample)
+
+    print("%d bad frames, %d lost frames" % (errors, lost), file=sys.stderr)
+    dump.close()
+    if dump.good or dump.bad:
+        print(dump.summary(), file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))